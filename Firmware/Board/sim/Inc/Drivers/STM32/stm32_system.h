@@ -0,0 +1,36 @@
+/*
+* @brief Host simulator replacement for Drivers/STM32/stm32_system.h
+*
+* This file shadows the real header because Board/sim/Inc comes first in the
+* include path. Interrupts don't exist on the host so critical sections are
+* no-ops.
+*/
+
+#ifndef __STM32_SYSTEM_H
+#define __STM32_SYSTEM_H
+
+#include <sim_hal.h>
+
+#define COUNT_IRQ(irqn) ((void)0)
+#define GET_IRQ_COUNTER(irqn) 0
+
+static inline uint32_t cpu_enter_critical() {
+    return 0;
+}
+
+static inline void cpu_exit_critical(uint32_t priority_mask) {
+    (void)priority_mask;
+}
+
+#ifdef __cplusplus
+
+struct CriticalSectionContext {
+    operator bool() { return true; };
+    bool exit_ = false;
+};
+
+#define CRITICAL_SECTION() if ([[maybe_unused]] CriticalSectionContext __critical_section_context{})
+
+#endif
+
+#endif // __STM32_SYSTEM_H
@@ -0,0 +1,6 @@
+#ifndef __SIM_ADC_H
+#define __SIM_ADC_H
+
+#include "sim_hal.h"
+
+#endif // __SIM_ADC_H
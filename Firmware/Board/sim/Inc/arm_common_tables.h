@@ -0,0 +1,23 @@
+/*
+* @brief Host simulator replacement for CMSIS-DSP arm_common_tables.h
+*
+* On hardware the sine table comes from the precompiled CMSIS-DSP library. The
+* simulator fills it in at startup (see Board/sim/sin_table.cpp).
+*/
+
+#ifndef __SIM_ARM_COMMON_TABLES_H
+#define __SIM_ARM_COMMON_TABLES_H
+
+#include "arm_math.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern float32_t sinTable_f32[FAST_MATH_TABLE_SIZE + 1];
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SIM_ARM_COMMON_TABLES_H
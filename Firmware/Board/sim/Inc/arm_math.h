@@ -0,0 +1,15 @@
+/*
+* @brief Host simulator replacement for the parts of CMSIS-DSP arm_math.h that
+* are used by MotorControl/arm_sin_f32.c and MotorControl/arm_cos_f32.c.
+*/
+
+#ifndef __SIM_ARM_MATH_H
+#define __SIM_ARM_MATH_H
+
+#include <stdint.h>
+
+typedef float float32_t;
+
+#define FAST_MATH_TABLE_SIZE  512
+
+#endif // __SIM_ARM_MATH_H
@@ -0,0 +1,158 @@
+/*
+* @brief Contains board specific configuration for the host simulator
+*
+* The simulator mimics an ODrive v3.6 closely enough that the motor control
+* code compiles unmodified. Peripheral registers are plain memory which is
+* read and written by the simulated plant (see Board/sim/sim_plant.hpp).
+*/
+
+#ifndef __BOARD_CONFIG_H
+#define __BOARD_CONFIG_H
+
+#include <stdbool.h>
+
+#ifndef HW_VERSION_MAJOR
+#define HW_VERSION_MAJOR 3
+#endif
+#ifndef HW_VERSION_MINOR
+#define HW_VERSION_MINOR 6
+#endif
+#ifndef HW_VERSION_VOLTAGE
+#define HW_VERSION_VOLTAGE 56
+#endif
+
+#include <sim_hal.h>
+#include <gpio.h>
+#include <spi.h>
+#include <adc.h>
+#include <usart.h>
+#include <main.h>
+#include "cmsis_os.h"
+
+#include <arm_math.h>
+
+#include <Drivers/STM32/stm32_system.h>
+
+#define SHUNT_RESISTANCE (500e-6f)
+
+#define AXIS_COUNT (2)
+#define GPIO_COUNT  (17)
+
+#define CAN_FREQ (2000000UL)
+
+#define DEFAULT_BRAKE_RESISTANCE (2.0f) // [ohm]
+
+#define DEFAULT_ERROR_PIN 0
+#define DEFAULT_MIN_DC_VOLTAGE 8.0f
+
+#define DEFAULT_GPIO_MODES \
+    ODriveIntf::GPIO_MODE_DIGITAL, \
+    ODriveIntf::GPIO_MODE_UART_A, \
+    ODriveIntf::GPIO_MODE_UART_A, \
+    ODriveIntf::GPIO_MODE_ANALOG_IN, \
+    ODriveIntf::GPIO_MODE_ANALOG_IN, \
+    ODriveIntf::GPIO_MODE_ANALOG_IN, \
+    ODriveIntf::GPIO_MODE_DIGITAL, \
+    ODriveIntf::GPIO_MODE_DIGITAL, \
+    ODriveIntf::GPIO_MODE_DIGITAL, \
+    ODriveIntf::GPIO_MODE_ENC0, \
+    ODriveIntf::GPIO_MODE_ENC0, \
+    ODriveIntf::GPIO_MODE_DIGITAL_PULL_DOWN, \
+    ODriveIntf::GPIO_MODE_ENC1, \
+    ODriveIntf::GPIO_MODE_ENC1, \
+    ODriveIntf::GPIO_MODE_DIGITAL_PULL_DOWN, \
+    ODriveIntf::GPIO_MODE_CAN_A, \
+    ODriveIntf::GPIO_MODE_CAN_A,
+
+#define TIM_TIME_BASE TIM14
+
+// Run control loop at the same frequency as the current measurements.
+#define CONTROL_TIMER_PERIOD_TICKS  (2 * TIM_1_8_PERIOD_CLOCKS * (TIM_1_8_RCR + 1))
+
+#define TIM1_INIT_COUNT (TIM_1_8_PERIOD_CLOCKS / 2 - 1 * 128)
+
+#define MAX_CONTROL_LOOP_UPDATE_TO_CURRENT_UPDATE_DELTA (TIM_1_8_PERIOD_CLOCKS / 2 + 1 * 128)
+
+#ifdef __cplusplus
+
+// On hardware TIM13 restarts at the beginning of every control period and is
+// used by TaskTimer to timestamp the individual tasks. On the host the counter
+// is derived from the wall clock, relative to the start of the current
+// simulated period (see sim_start_period()).
+struct SimTim13 {
+    struct Counter {
+        operator uint32_t() const;
+    } CNT;
+};
+extern SimTim13 sim_tim13;
+#define TIM13 (&sim_tim13)
+
+void sim_start_period();
+
+// Ideal gate driver and current sense amplifier.
+class SimGateDriver {
+public:
+    bool config(float requested_gain, float* actual_gain) {
+        if (actual_gain) {
+            *actual_gain = requested_gain;
+        }
+        return true;
+    }
+    bool init() { return true; }
+    void do_checks() {}
+    bool is_ready() { return true; }
+    bool set_enabled(bool enabled) { enabled_ = enabled; return true; }
+    uint32_t get_error() { return 0; }
+
+    bool enabled_ = false;
+};
+
+#include <Drivers/STM32/stm32_gpio.hpp>
+#include <Drivers/STM32/stm32_spi_arbiter.hpp>
+#include <MotorControl/thermistor.hpp>
+
+using TGateDriver = SimGateDriver;
+using TOpAmp = SimGateDriver;
+
+#include <MotorControl/motor.hpp>
+#include <MotorControl/encoder.hpp>
+
+extern std::array<Axis, AXIS_COUNT> axes;
+extern Motor motors[AXIS_COUNT];
+extern OnboardThermistorCurrentLimiter fet_thermistors[AXIS_COUNT];
+extern Encoder encoders[AXIS_COUNT];
+extern Stm32Gpio gpios[GPIO_COUNT];
+
+struct GpioFunction { int mode = 0; uint8_t alternate_function = 0xff; };
+extern std::array<GpioFunction, 3> alternate_functions[GPIO_COUNT];
+
+extern Stm32SpiArbiter& ext_spi_arbiter;
+
+extern UART_HandleTypeDef* uart_a;
+extern UART_HandleTypeDef* uart_b;
+extern UART_HandleTypeDef* uart_c;
+
+// [HCLK ticks] Advanced twice per simulated control period like on hardware
+extern volatile uint32_t timestamp_;
+#endif
+
+// Period in [s]
+#define CURRENT_MEAS_PERIOD ( (float)2*TIM_1_8_PERIOD_CLOCKS*(TIM_1_8_RCR+1) / (float)TIM_1_8_CLOCK_HZ )
+static const float current_meas_period = CURRENT_MEAS_PERIOD;
+
+// Frequency in [Hz]
+#define CURRENT_MEAS_HZ ( (float)(TIM_1_8_CLOCK_HZ) / (float)(2*TIM_1_8_PERIOD_CLOCKS*(TIM_1_8_RCR+1)) )
+static const int current_meas_hz = CURRENT_MEAS_HZ;
+
+#define VBUS_S_DIVIDER_RATIO 19.0f
+
+#define CURRENT_SENSE_MIN_VOLT  0.3f
+#define CURRENT_SENSE_MAX_VOLT  3.0f
+
+// This board has no board-specific user configurations
+static inline bool board_read_config() { return true; }
+static inline bool board_write_config() { return true; }
+static inline void board_clear_config() { }
+static inline bool board_apply_config() { return true; }
+
+#endif // __BOARD_CONFIG_H
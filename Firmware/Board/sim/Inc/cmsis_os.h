@@ -0,0 +1,98 @@
+/*
+* @brief Single-threaded stand-in for the CMSIS-RTOS API on the host simulator.
+*
+* The simulator runs the control loop callbacks synchronously from one thread
+* so all waiting functions return immediately. Thread creation is not
+* supported.
+*/
+
+#ifndef __SIM_CMSIS_OS_H
+#define __SIM_CMSIS_OS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    osPriorityIdle = -3,
+    osPriorityLow = -2,
+    osPriorityBelowNormal = -1,
+    osPriorityNormal = 0,
+    osPriorityAboveNormal = +1,
+    osPriorityHigh = +2,
+    osPriorityRealtime = +3,
+    osPriorityError = 0x84
+} osPriority;
+
+typedef enum {
+    osOK = 0,
+    osEventSignal = 0x08,
+    osErrorOS = 0xFF
+} osStatus;
+
+typedef struct {
+    osStatus status;
+    union {
+        uint32_t v;
+        void* p;
+        int32_t signals;
+    } value;
+} osEvent;
+
+typedef void* osThreadId;
+typedef void* osSemaphoreId;
+typedef void* osMessageQId;
+typedef void (*os_pthread)(void const* argument);
+typedef uint32_t StackType_t;
+
+typedef struct {
+    const char* name;
+    os_pthread pthread;
+    osPriority tpriority;
+    uint32_t instances;
+    uint32_t stacksize;
+} osThreadDef_t;
+
+#define osWaitForever 0xFFFFFFFF
+#define osKernelSysTickFrequency 1000
+
+#define osThreadDef(name, thread, priority, instances, stacksz) \
+    const osThreadDef_t os_thread_def_##name = { #name, (os_pthread)(thread), (priority), (instances), (stacksz) }
+#define osThread(name) &os_thread_def_##name
+
+uint32_t HAL_GetTick(void);
+
+static inline osThreadId osThreadCreate(const osThreadDef_t* thread_def, void* argument) {
+    (void)thread_def; (void)argument;
+    return 0;
+}
+
+static inline osStatus osDelay(uint32_t millisec) {
+    (void)millisec;
+    return osOK;
+}
+
+static inline osEvent osSignalWait(int32_t signals, uint32_t millisec) {
+    (void)millisec;
+    osEvent evt;
+    evt.status = osEventSignal;
+    evt.value.signals = signals;
+    return evt;
+}
+
+static inline int32_t osSignalSet(osThreadId thread_id, int32_t signals) {
+    (void)thread_id;
+    return signals;
+}
+
+static inline uint32_t osKernelSysTick(void) {
+    return HAL_GetTick();
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SIM_CMSIS_OS_H
@@ -0,0 +1,6 @@
+#ifndef __SIM_GPIO_H
+#define __SIM_GPIO_H
+
+#include "sim_hal.h"
+
+#endif // __SIM_GPIO_H
@@ -0,0 +1,19 @@
+/*
+* @brief Timer and pin definitions of the host simulator. These mirror
+* Board/v3/Inc/main.h for ODrive v3.5 and later.
+*/
+
+#ifndef __SIM_MAIN_H
+#define __SIM_MAIN_H
+
+#include "sim_hal.h"
+
+#define TIM_1_8_CLOCK_HZ 168000000
+#define TIM_1_8_PERIOD_CLOCKS 3500
+#define TIM_1_8_DEADTIME_CLOCKS 20
+#define TIM_APB1_CLOCK_HZ 84000000
+#define TIM_APB1_PERIOD_CLOCKS 4096
+#define TIM_APB1_DEADTIME_CLOCKS 40
+#define TIM_1_8_RCR 2
+
+#endif // __SIM_MAIN_H
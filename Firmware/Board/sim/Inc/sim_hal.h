@@ -0,0 +1,191 @@
+/*
+* @brief Minimal stand-in for the STM32 HAL on the host simulator.
+*
+* Only the types, registers and functions that are touched by the motor
+* control code are provided. Peripheral registers are plain memory so that
+* the simulated plant (see sim_plant.hpp) can read the PWM compare values and
+* write the encoder counter.
+*/
+
+#ifndef __SIM_HAL_H
+#define __SIM_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    HAL_OK = 0x00U,
+    HAL_ERROR = 0x01U,
+    HAL_BUSY = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+/* GPIO --------------------------------------------------------------------- */
+
+typedef struct {
+    volatile uint32_t IDR;
+    volatile uint32_t ODR;
+} GPIO_TypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct {
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+    uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+#define GPIO_PIN_0    ((uint16_t)0x0001)
+#define GPIO_PIN_1    ((uint16_t)0x0002)
+#define GPIO_PIN_2    ((uint16_t)0x0004)
+#define GPIO_PIN_3    ((uint16_t)0x0008)
+#define GPIO_PIN_4    ((uint16_t)0x0010)
+#define GPIO_PIN_5    ((uint16_t)0x0020)
+#define GPIO_PIN_6    ((uint16_t)0x0040)
+#define GPIO_PIN_7    ((uint16_t)0x0080)
+#define GPIO_PIN_8    ((uint16_t)0x0100)
+#define GPIO_PIN_9    ((uint16_t)0x0200)
+#define GPIO_PIN_10   ((uint16_t)0x0400)
+#define GPIO_PIN_11   ((uint16_t)0x0800)
+#define GPIO_PIN_12   ((uint16_t)0x1000)
+#define GPIO_PIN_13   ((uint16_t)0x2000)
+#define GPIO_PIN_14   ((uint16_t)0x4000)
+#define GPIO_PIN_15   ((uint16_t)0x8000)
+
+#define GPIO_MODE_INPUT           0x00000000U
+#define GPIO_MODE_OUTPUT_PP       0x00000001U
+#define GPIO_MODE_OUTPUT_OD       0x00000011U
+#define GPIO_MODE_AF_PP           0x00000002U
+#define GPIO_MODE_AF_OD           0x00000012U
+#define GPIO_MODE_ANALOG          0x00000003U
+
+#define GPIO_NOPULL               0x00000000U
+#define GPIO_PULLUP               0x00000001U
+#define GPIO_PULLDOWN             0x00000002U
+
+#define GPIO_SPEED_FREQ_LOW       0x00000000U
+#define GPIO_SPEED_FREQ_MEDIUM    0x00000001U
+#define GPIO_SPEED_FREQ_HIGH      0x00000002U
+#define GPIO_SPEED_FREQ_VERY_HIGH 0x00000003U
+
+extern GPIO_TypeDef sim_gpioa, sim_gpiob, sim_gpioc;
+#define GPIOA (&sim_gpioa)
+#define GPIOB (&sim_gpiob)
+#define GPIOC (&sim_gpioc)
+
+static inline void HAL_GPIO_WritePin(GPIO_TypeDef* port, uint16_t pin, GPIO_PinState state) {
+    if (state == GPIO_PIN_SET) {
+        port->ODR |= pin;
+    } else {
+        port->ODR &= ~(uint32_t)pin;
+    }
+}
+
+/* Timers ------------------------------------------------------------------- */
+
+typedef struct {
+    volatile uint32_t CR1;
+    volatile uint32_t CNT;
+    volatile uint32_t ARR;
+    volatile uint32_t CCR1;
+    volatile uint32_t CCR2;
+    volatile uint32_t CCR3;
+    volatile uint32_t CCR4;
+    volatile uint32_t BDTR;
+    volatile uint32_t SR;
+} TIM_TypeDef;
+
+typedef struct {
+    TIM_TypeDef* Instance;
+} TIM_HandleTypeDef;
+
+#define TIM_BDTR_MOE_Pos          (15U)
+#define TIM_BDTR_MOE_Msk          (0x1UL << TIM_BDTR_MOE_Pos)
+#define TIM_BDTR_MOE              TIM_BDTR_MOE_Msk
+#define TIM_BDTR_AOE_Pos          (14U)
+#define TIM_BDTR_AOE_Msk          (0x1UL << TIM_BDTR_AOE_Pos)
+#define TIM_BDTR_AOE              TIM_BDTR_AOE_Msk
+#define TIM_CR1_DIR               (0x1UL << 4U)
+#define TIM_SR_UIF                (0x1UL << 0U)
+#define TIM_FLAG_UPDATE           TIM_SR_UIF
+#define TIM_CHANNEL_ALL           0x0000003CU
+
+#define __HAL_TIM_GET_FLAG(__HANDLE__, __FLAG__) (((__HANDLE__)->Instance->SR & (__FLAG__)) == (__FLAG__))
+#define __HAL_TIM_MOE_DISABLE_UNCONDITIONALLY(__HANDLE__) ((__HANDLE__)->Instance->BDTR &= ~(TIM_BDTR_MOE))
+
+static inline HAL_StatusTypeDef HAL_TIM_Encoder_Start(TIM_HandleTypeDef* htim, uint32_t channel) {
+    (void)htim; (void)channel;
+    return HAL_OK;
+}
+
+extern TIM_HandleTypeDef htim1, htim3, htim4, htim8, htim14;
+#define TIM1 (htim1.Instance)
+#define TIM8 (htim8.Instance)
+#define TIM14 (htim14.Instance)
+
+/* Other peripheral handles (only used as opaque pointers) ------------------ */
+
+typedef struct {
+    uint32_t Mode;
+    uint32_t Direction;
+    uint32_t DataSize;
+    uint32_t CLKPolarity;
+    uint32_t CLKPhase;
+    uint32_t NSS;
+    uint32_t BaudRatePrescaler;
+    uint32_t FirstBit;
+    uint32_t TIMode;
+    uint32_t CRCCalculation;
+    uint32_t CRCPolynomial;
+} SPI_InitTypeDef;
+
+typedef struct {
+    SPI_InitTypeDef Init;
+} SPI_HandleTypeDef;
+
+#define SPI_MODE_MASTER              0x00000104U
+#define SPI_DIRECTION_2LINES         0x00000000U
+#define SPI_DATASIZE_8BIT            0x00000000U
+#define SPI_DATASIZE_16BIT           0x00000800U
+#define SPI_POLARITY_LOW             0x00000000U
+#define SPI_POLARITY_HIGH            0x00000002U
+#define SPI_PHASE_1EDGE              0x00000000U
+#define SPI_PHASE_2EDGE              0x00000001U
+#define SPI_NSS_SOFT                 0x00000200U
+#define SPI_BAUDRATEPRESCALER_32     0x00000020U
+#define SPI_FIRSTBIT_MSB             0x00000000U
+#define SPI_TIMODE_DISABLE           0x00000000U
+#define SPI_CRCCALCULATION_DISABLE   0x00000000U
+
+typedef struct { int dummy; } ADC_HandleTypeDef;
+typedef struct { int dummy; } CAN_HandleTypeDef;
+typedef struct { int dummy; } UART_HandleTypeDef;
+typedef struct { int dummy; } I2C_HandleTypeDef;
+typedef struct { int dummy; } USBD_HandleTypeDef;
+
+/* System ------------------------------------------------------------------- */
+
+uint32_t HAL_GetTick(void);
+void NVIC_SystemReset(void);
+
+static inline uint32_t __get_PRIMASK(void) { return 0; }
+static inline void __set_PRIMASK(uint32_t primask) { (void)primask; }
+static inline void __disable_irq(void) {}
+static inline void __enable_irq(void) {}
+static inline void __NOP(void) {}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SIM_HAL_H
@@ -0,0 +1,6 @@
+#ifndef __SIM_SPI_H
+#define __SIM_SPI_H
+
+#include "sim_hal.h"
+
+#endif // __SIM_SPI_H
@@ -0,0 +1,6 @@
+#ifndef __SIM_USART_H
+#define __SIM_USART_H
+
+#include "sim_hal.h"
+
+#endif // __SIM_USART_H
@@ -0,0 +1,187 @@
+/*
+* @brief Host benchmark for the ASCII protocol
+*
+* Feeds streaming setpoint and feedback commands into an AsciiProtocol
+* instance, once as ASCII lines and once as binary frames, and reports the
+* number of commands that are handled per second.
+*
+* Every command is delivered as a separate chunk, like a UART that is polled
+* faster than the host sends commands.
+*
+* Usage: bench_ascii.exe [--iterations N]
+*
+* The program fails if the binary commands don't have the same effect as the
+* ASCII commands.
+*/
+
+#include <odrive_main.h>
+#include <communication/ascii_protocol.hpp>
+#include <fibre/simple_serdes.hpp>
+#include <fibre/../../crc.hpp>
+
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using bench_clock = std::chrono::steady_clock;
+
+class ChunkSource : public fibre::AsyncStreamSource {
+public:
+    void start_read(fibre::bufptr_t buffer, fibre::TransferHandle* handle, fibre::Callback<void, fibre::ReadResult> completer) final {
+        buffer_ = buffer;
+        completer_ = completer;
+    }
+    void cancel_read(fibre::TransferHandle transfer_handle) final {}
+
+    void feed(const uint8_t* data, size_t length) {
+        size_t chunk = std::min(length, buffer_.size());
+        memcpy(buffer_.begin(), data, chunk);
+        completer_.invoke_and_clear({fibre::kStreamOk, buffer_.begin() + chunk});
+    }
+
+private:
+    fibre::bufptr_t buffer_;
+    fibre::Callback<void, fibre::ReadResult> completer_;
+};
+
+// Completes every write right away and keeps the last response
+class CaptureSink : public fibre::AsyncStreamSink {
+public:
+    void start_write(fibre::cbufptr_t buffer, fibre::TransferHandle* handle, fibre::Callback<void, fibre::WriteResult> completer) final {
+        last_response_.assign(buffer.begin(), buffer.end());
+        n_bytes_ += buffer.size();
+        completer.invoke({fibre::kStreamOk, buffer.end()});
+    }
+    void cancel_write(fibre::TransferHandle transfer_handle) final {}
+
+    std::vector<uint8_t> last_response_;
+    size_t n_bytes_ = 0;
+};
+
+static std::vector<uint8_t> binary_frame(uint8_t cmd, std::vector<uint8_t> payload) {
+    std::vector<uint8_t> frame = {ASCII_BINARY_SYNC_BYTE, cmd, (uint8_t)payload.size()};
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    frame.push_back(calc_crc8<ASCII_BINARY_CRC8_POLYNOMIAL>(ASCII_BINARY_CRC8_INIT, frame.data() + 1, frame.size() - 1));
+    return frame;
+}
+
+static std::vector<uint8_t> float_args(uint8_t axis, std::initializer_list<float> values) {
+    std::vector<uint8_t> payload = {axis};
+    for (float value: values) {
+        uint8_t buf[4];
+        write_le<float>(value, buf);
+        payload.insert(payload.end(), buf, buf + 4);
+    }
+    return payload;
+}
+
+struct Workload {
+    const char* name;
+    std::vector<uint8_t> command;
+};
+
+static float run_commands_per_s(const Workload& workload, uint32_t n_iterations, size_t* n_response_bytes) {
+    ChunkSource source;
+    CaptureSink sink;
+    AsciiProtocol protocol{&source, &sink};
+    protocol.start();
+
+    auto start = bench_clock::now();
+    for (uint32_t i = 0; i < n_iterations; ++i) {
+        source.feed(workload.command.data(), workload.command.size());
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - start);
+    *n_response_bytes = sink.n_bytes_ / n_iterations;
+    return (float)n_iterations / ((float)elapsed.count() * 1e-9f);
+}
+
+static std::vector<uint8_t> ascii_line(const char* line) {
+    return std::vector<uint8_t>(line, line + strlen(line));
+}
+
+// Runs a command once and returns the response
+static std::vector<uint8_t> run_once(const std::vector<uint8_t>& command) {
+    ChunkSource source;
+    CaptureSink sink;
+    AsciiProtocol protocol{&source, &sink};
+    protocol.start();
+    source.feed(command.data(), command.size());
+    return sink.last_response_;
+}
+
+static bool check_equivalence() {
+    Controller& controller = axes[0].controller_;
+    bool ok = true;
+
+    run_once(ascii_line("p 0 1.25 -0.5 0.125\n"));
+    float ascii_pos = controller.input_pos_, ascii_vel = controller.input_vel_, ascii_torque = controller.input_torque_;
+    controller.input_pos_ = controller.input_vel_ = controller.input_torque_ = 0.0f;
+    run_once(binary_frame('p', float_args(0, {1.25f, -0.5f, 0.125f})));
+    ok = ok && controller.input_pos_ == ascii_pos && controller.input_vel_ == ascii_vel && controller.input_torque_ == ascii_torque;
+
+    run_once(ascii_line("v 0 3.5 0.25\n"));
+    ascii_vel = controller.input_vel_;
+    ascii_torque = controller.input_torque_;
+    controller.input_vel_ = controller.input_torque_ = 0.0f;
+    run_once(binary_frame('v', float_args(0, {3.5f, 0.25f})));
+    ok = ok && controller.input_vel_ == ascii_vel && controller.input_torque_ == ascii_torque;
+
+    run_once(ascii_line("c 0 0.75\n"));
+    ascii_torque = controller.input_torque_;
+    controller.input_torque_ = 0.0f;
+    run_once(binary_frame('c', float_args(0, {0.75f})));
+    ok = ok && controller.input_torque_ == ascii_torque;
+
+    // A frame with a bad CRC must be ignored
+    std::vector<uint8_t> corrupted = binary_frame('c', float_args(0, {-1.0f}));
+    corrupted.back() ^= 1;
+    run_once(corrupted);
+    ok = ok && controller.input_torque_ == ascii_torque;
+
+    std::vector<uint8_t> response = run_once(binary_frame('f', {0}));
+    ok = ok && response == binary_frame('f', float_args(0, {axes[0].encoder_.pos_estimate_.any().value_or(0.0f),
+                                                            axes[0].encoder_.vel_estimate_.any().value_or(0.0f)}));
+
+    return ok;
+}
+
+int main(int argc, const char** argv) {
+    uint32_t n_iterations = 1000000;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--iterations") && i + 1 < argc) {
+            n_iterations = std::max<uint32_t>(strtoul(argv[++i], nullptr, 10), 1);
+        } else {
+            fprintf(stderr, "usage: %s [--iterations N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (!check_equivalence()) {
+        fprintf(stderr, "binary commands don't match the ASCII commands\n");
+        return 1;
+    }
+
+    axes[0].encoder_.pos_estimate_ = 12.345678f;
+    axes[0].encoder_.vel_estimate_ = -0.987654f;
+
+    const Workload workloads[] = {
+        {"ASCII p 0 1.2345 0.5 0.25", ascii_line("p 0 1.2345 0.5 0.25\n")},
+        {"binary p", binary_frame('p', float_args(0, {1.2345f, 0.5f, 0.25f}))},
+        {"ASCII v 0 2.5 0.1", ascii_line("v 0 2.5 0.1\n")},
+        {"binary v", binary_frame('v', float_args(0, {2.5f, 0.1f}))},
+        {"ASCII f 0", ascii_line("f 0\n")},
+        {"binary f", binary_frame('f', {0})},
+    };
+
+    printf("%-28s %14s %10s %10s\n", "", "commands/s", "RX bytes", "TX bytes");
+    for (const Workload& workload: workloads) {
+        size_t n_response_bytes;
+        float rate = run_commands_per_s(workload, n_iterations, &n_response_bytes);
+        printf("%-28s %14.0f %10zu %10zu\n", workload.name, rate, workload.command.size(), n_response_bytes);
+    }
+
+    return 0;
+}
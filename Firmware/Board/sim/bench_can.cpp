@@ -0,0 +1,265 @@
+/*
+* @brief Host benchmark for the CANSimple message dispatch
+*
+* Connects a CANSimple instance to a simulated bus (see sim_can.hpp) that is
+* flooded at line rate with a mix of setpoint commands and RTR requests for
+* `--nodes` node IDs. The ODrive under test owns node IDs 0 and 1 so most of
+* the traffic is for other nodes and is dropped by the acceptance filters.
+*
+* The CAN thread is modelled as draining the RX FIFO `--thread-latency-us`
+* after a frame arrived in an empty FIFO. The benchmark runs once with zero
+* latency and once with the given latency and reports for each run:
+*  - the host time spent per frame in the acceptance filter and per
+*    dispatched frame in CANSimple::handle_can_message()
+*  - the number of frames that were lost because the 3 frame RX FIFO
+*    overflowed
+*  - the number of responses that were lost because all TX mailboxes were
+*    occupied
+*
+* Usage: bench_can.exe [--frames N] [--nodes N] [--baud-rate BPS] [--thread-latency-us US]
+*        bench_can.exe --socketcan IFNAME [--frames N]
+*
+* With --socketcan the simulated bus is replaced by a SocketCAN interface,
+* e.g. vcan0, and the program handles the first N frames it receives there.
+*
+* The program fails if frames are lost in the zero latency run.
+*/
+
+#include <odrive_main.h>
+#include "sim_can.hpp"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using bench_clock = std::chrono::steady_clock;
+
+/**
+ * @brief Generates a deterministic mix of the messages that a master
+ * typically sends to a bus of ODrives.
+ */
+class TrafficGenerator {
+public:
+    TrafficGenerator(uint32_t n_nodes) : n_nodes_(n_nodes) {}
+
+    can_Message_t next() {
+        struct MsgType { uint8_t cmd; bool rtr; uint8_t len; };
+        static const MsgType mix[] = {
+            {CANSimple::MSG_SET_INPUT_POS, false, 8},
+            {CANSimple::MSG_SET_INPUT_POS, false, 8},
+            {CANSimple::MSG_SET_INPUT_VEL, false, 8},
+            {CANSimple::MSG_SET_INPUT_TORQUE, false, 4},
+            {CANSimple::MSG_SET_LIMITS, false, 8},
+            {CANSimple::MSG_GET_ENCODER_ESTIMATES, true, 8},
+            {CANSimple::MSG_GET_IQ, true, 8},
+            {CANSimple::MSG_GET_VBUS_VOLTAGE, true, 8},
+        };
+        const MsgType& type = mix[rand() % (sizeof(mix) / sizeof(mix[0]))];
+
+        can_Message_t msg;
+        msg.id = ((rand() % n_nodes_) << 5) | type.cmd;
+        msg.isExt = false;
+        msg.rtr = type.rtr;
+        msg.len = type.len;
+        if (!type.rtr) {
+            can_setSignal<float>(msg, (float)(rand() % 2000) * 0.01f - 10.0f, 0, 32, true);
+            can_setSignal<float>(msg, (float)(rand() % 2000) * 0.01f + 1.0f, 32, 32, true);
+        }
+        return msg;
+    }
+
+private:
+    uint32_t rand() {
+        state_ = state_ * 1664525u + 1013904223u;
+        return state_ >> 8;
+    }
+
+    uint32_t n_nodes_;
+    uint32_t state_ = 1;
+};
+
+// Length of a frame on the bus without stuff bits, including the 3 bit
+// intermission
+static uint32_t frame_bits(const can_Message_t& msg) {
+    return (msg.isExt ? 67 : 47) + (msg.rtr ? 0 : 8 * msg.len);
+}
+
+// Time that it takes to read the clock twice, which is subtracted from the
+// measurements of individual calls.
+static bench_clock::duration measure_clock_overhead() {
+    const uint32_t n = 100000;
+    bench_clock::duration sum{0};
+    for (uint32_t i = 0; i < n; ++i) {
+        auto start = bench_clock::now();
+        sum += bench_clock::now() - start;
+    }
+    return sum / n;
+}
+
+static const bench_clock::duration clock_overhead = measure_clock_overhead();
+
+struct RunResult {
+    SimCanBus::Stats stats;
+    uint32_t n_master_frames = 0;
+    float duration_s = 0.0f; // simulated bus time
+    float filter_ns_per_frame = 0.0f;
+    float dispatch_ns_per_frame = 0.0f;
+};
+
+static RunResult run(uint32_t n_frames, uint32_t n_nodes, uint32_t baud_rate, float thread_latency_s) {
+    SimCanBus bus;
+    CANSimple can_simple{&bus};
+    if (!can_simple.init()) {
+        fprintf(stderr, "failed to subscribe\n");
+        exit(1);
+    }
+
+    TrafficGenerator generator{n_nodes};
+    RunResult result;
+
+    const double s_per_bit = 1.0 / (double)baud_rate;
+    double t = 0.0;
+    double wake_time = 0.0;
+    bool wake_pending = false;
+    bench_clock::duration filter_time{0};
+    bench_clock::duration dispatch_time{0};
+
+    can_Message_t master_msg = generator.next();
+
+    while (result.n_master_frames < n_frames) {
+        // Arbitration: the lower ID wins and a data frame wins over a
+        // remote frame with the same ID.
+        const can_Message_t* node_msg = bus.peek_tx();
+        bool node_wins = node_msg && ((node_msg->id < master_msg.id)
+                                   || (node_msg->id == master_msg.id && master_msg.rtr));
+
+        if (node_wins) {
+            t += frame_bits(*node_msg) * s_per_bit;
+            bus.pop_tx(nullptr);
+        } else {
+            t += frame_bits(master_msg) * s_per_bit;
+            bool fifo_was_empty = !bus.rx_fill_level();
+
+            auto start = bench_clock::now();
+            bool accepted = bus.receive(master_msg);
+            filter_time += bench_clock::now() - start - clock_overhead;
+
+            if (accepted && fifo_was_empty && !wake_pending) {
+                wake_time = t + thread_latency_s;
+                wake_pending = true;
+            }
+            master_msg = generator.next();
+            result.n_master_frames++;
+        }
+
+        if (wake_pending && t >= wake_time) {
+            auto start = bench_clock::now();
+            bus.process_rx();
+            dispatch_time += bench_clock::now() - start - clock_overhead;
+            wake_pending = false;
+        }
+    }
+
+    result.stats = bus.stats_;
+    result.duration_s = (float)t;
+    result.filter_ns_per_frame = (float)std::chrono::duration_cast<std::chrono::nanoseconds>(filter_time).count() / (float)result.n_master_frames;
+    result.dispatch_ns_per_frame = (float)std::chrono::duration_cast<std::chrono::nanoseconds>(dispatch_time).count() / (float)std::max<uint32_t>(result.stats.n_dispatched, 1);
+    return result;
+}
+
+static void print_result(const char* name, const RunResult& result) {
+    const SimCanBus::Stats& s = result.stats;
+    printf("%s:\n", name);
+    printf("  %u frames from the master and %u responses in %.3f s (%.0f frames/s)\n",
+           result.n_master_frames, s.n_tx, result.duration_s, (float)(result.n_master_frames + s.n_tx) / result.duration_s);
+    printf("  filtered out: %u, accepted: %u, lost in RX FIFO: %u (%.2f%% of the frames for this node)\n",
+           s.n_rx_filtered, s.n_rx_accepted, s.n_rx_overrun,
+           100.0f * (float)s.n_rx_overrun / (float)std::max<uint32_t>(s.n_rx_accepted + s.n_rx_overrun, 1));
+    printf("  responses lost because the TX mailboxes were full: %u\n", s.n_tx_refused);
+    printf("  acceptance filter: %6.2f ns/frame, dispatch: %6.2f ns/frame\n",
+           result.filter_ns_per_frame, result.dispatch_ns_per_frame);
+}
+
+#ifdef __linux__
+static int run_socketcan(const char* interface_name, uint32_t n_frames) {
+    SocketCanBus bus;
+    if (!bus.open(interface_name)) {
+        fprintf(stderr, "failed to open %s: %s\n", interface_name, strerror(errno));
+        return 1;
+    }
+
+    CANSimple can_simple{&bus};
+    if (!can_simple.init()) {
+        fprintf(stderr, "failed to subscribe\n");
+        return 1;
+    }
+
+    printf("handling CANSimple messages for node IDs %u and %u on %s\n",
+           (unsigned)axes[0].config_.can.node_id, (unsigned)axes[1].config_.can.node_id, interface_name);
+
+    while (bus.stats_.n_rx_accepted + bus.stats_.n_rx_filtered < n_frames) {
+        if (!bus.poll(100)) {
+            fprintf(stderr, "failed to read from %s: %s\n", interface_name, strerror(errno));
+            return 1;
+        }
+    }
+
+    const SimCanBus::Stats& s = bus.stats_;
+    printf("filtered out: %u, dispatched: %u, responses sent: %u, responses failed: %u\n",
+           s.n_rx_filtered, s.n_dispatched, s.n_tx, s.n_tx_refused);
+    return 0;
+}
+#endif
+
+int main(int argc, const char** argv) {
+    uint32_t n_frames = 1000000;
+    uint32_t n_nodes = 8;
+    uint32_t baud_rate = 1000000;
+    float thread_latency_us = 200.0f;
+    const char* socketcan_interface = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            n_frames = strtoul(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--nodes") && i + 1 < argc) {
+            n_nodes = std::max<uint32_t>(strtoul(argv[++i], nullptr, 10), 1);
+        } else if (!strcmp(argv[i], "--baud-rate") && i + 1 < argc) {
+            baud_rate = std::max<uint32_t>(strtoul(argv[++i], nullptr, 10), 1);
+        } else if (!strcmp(argv[i], "--thread-latency-us") && i + 1 < argc) {
+            thread_latency_us = strtof(argv[++i], nullptr);
+        } else if (!strcmp(argv[i], "--socketcan") && i + 1 < argc) {
+            socketcan_interface = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--frames N] [--nodes N] [--baud-rate BPS] [--thread-latency-us US]\n"
+                            "       %s --socketcan IFNAME [--frames N]\n", argv[0], argv[0]);
+            return 2;
+        }
+    }
+
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        axes[i].config_.can.node_id = i;
+        axes[i].config_.can.is_extended = false;
+    }
+
+    if (socketcan_interface) {
+#ifdef __linux__
+        return run_socketcan(socketcan_interface, n_frames);
+#else
+        fprintf(stderr, "SocketCAN is only available on Linux\n");
+        return 2;
+#endif
+    }
+
+    printf("%u nodes at %u bit/s\n", n_nodes, baud_rate);
+
+    RunResult immediate = run(n_frames, n_nodes, baud_rate, 0.0f);
+    print_result("CAN thread runs immediately", immediate);
+
+    char name[64];
+    snprintf(name, sizeof(name), "CAN thread runs after %.0f us", thread_latency_us);
+    RunResult delayed = run(n_frames, n_nodes, baud_rate, thread_latency_us * 1e-6f);
+    print_result(name, delayed);
+
+    return immediate.stats.n_rx_overrun ? 1 : 0;
+}
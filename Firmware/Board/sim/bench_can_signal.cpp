@@ -0,0 +1,144 @@
+/*
+* @brief Host micro-benchmark for the CAN signal codec
+*
+* Compares the runtime helpers can_getSignal() / can_setSignal(), which take
+* the message by value and reverse the buffer for Motorola byte order, against
+* the compile-time can_SignalDesc<> from can_helpers.hpp.
+*
+* Each case decodes or encodes all signals of one message:
+*  - decode: the Set Input Pos message of CANSimple (float32 and two scaled
+*    int16, Intel byte order)
+*  - encode: the Get Encoder Estimates message of CANSimple (two float32,
+*    Intel byte order)
+*  - decode Motorola: two 16-bit and one 32-bit signal in Motorola byte order
+*
+* Usage: bench_can_signal.exe [--iterations N]
+*/
+
+#include <communication/can/can_helpers.hpp>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using bench_clock = std::chrono::steady_clock;
+
+using InputPos = can_SignalDesc<float, 0, 32>;
+using VelFF = can_SignalDesc<int16_t, 32, 16, true, std::milli>;
+using TorqueFF = can_SignalDesc<int16_t, 48, 16, true, std::milli>;
+using PosEstimate = can_SignalDesc<float, 0, 32>;
+using VelEstimate = can_SignalDesc<float, 32, 32>;
+using MotorolaA = can_SignalDesc<uint16_t, 0, 16, false>;
+using MotorolaB = can_SignalDesc<uint16_t, 16, 16, false>;
+using MotorolaC = can_SignalDesc<uint32_t, 32, 32, false>;
+
+// Kept out of line so that the compiler can't hoist the decoding out of the
+// benchmark loop.
+__attribute__((noinline)) static float decode_runtime(const can_Message_t& msg) {
+    return can_getSignal<float>(msg, 0, 32, true)
+         + can_getSignal<int16_t>(msg, 32, 16, true, 0.001f, 0)
+         + can_getSignal<int16_t>(msg, 48, 16, true, 0.001f, 0);
+}
+
+__attribute__((noinline)) static float decode_constexpr(const can_Message_t& msg) {
+    return InputPos::get(msg) + VelFF::get(msg) + TorqueFF::get(msg);
+}
+
+__attribute__((noinline)) static void encode_runtime(can_Message_t& msg, float pos, float vel) {
+    can_setSignal<float>(msg, pos, 0, 32, true);
+    can_setSignal<float>(msg, vel, 32, 32, true);
+}
+
+__attribute__((noinline)) static void encode_constexpr(can_Message_t& msg, float pos, float vel) {
+    PosEstimate::set(msg, pos);
+    VelEstimate::set(msg, vel);
+}
+
+__attribute__((noinline)) static float decode_motorola_runtime(const can_Message_t& msg) {
+    return (float)can_getSignal<uint16_t>(msg, 0, 16, false)
+         + (float)can_getSignal<uint16_t>(msg, 16, 16, false)
+         + (float)can_getSignal<uint32_t>(msg, 32, 32, false);
+}
+
+__attribute__((noinline)) static float decode_motorola_constexpr(const can_Message_t& msg) {
+    return (float)MotorolaA::get(msg) + (float)MotorolaB::get(msg) + (float)MotorolaC::get(msg);
+}
+
+// Puts a float32 into the first four bytes and arbitrary bits into the others
+static void fill(can_Message_t& msg, uint32_t i) {
+    float pos = (float)i * 0.25f;
+    memcpy(&msg.buf[0], &pos, sizeof(pos));
+    uint32_t val = i * 2654435761u;
+    memcpy(&msg.buf[4], &val, sizeof(val));
+}
+
+template<typename TFunc>
+static float run_decode(uint32_t n_iterations, TFunc decode, double* checksum) {
+    can_Message_t msg;
+    double acc = 0.0;
+    auto start = bench_clock::now();
+    for (uint32_t i = 0; i < n_iterations; ++i) {
+        fill(msg, i);
+        acc += decode(msg);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - start);
+    *checksum = acc;
+    return (float)elapsed.count() / (float)n_iterations;
+}
+
+template<typename TFunc>
+static float run_encode(uint32_t n_iterations, TFunc encode, double* checksum) {
+    can_Message_t msg;
+    uint64_t acc = 0;
+    auto start = bench_clock::now();
+    for (uint32_t i = 0; i < n_iterations; ++i) {
+        encode(msg, (float)i, (float)i * 0.5f);
+        acc += msg.buf[i & 7];
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - start);
+    *checksum = (double)acc;
+    return (float)elapsed.count() / (float)n_iterations;
+}
+
+int main(int argc, const char** argv) {
+    uint32_t n_iterations = 10000000;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--iterations") && i + 1 < argc) {
+            n_iterations = strtoul(argv[++i], nullptr, 10);
+        } else {
+            fprintf(stderr, "usage: %s [--iterations N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    struct Result { const char* name; float runtime_ns; float constexpr_ns; bool match; };
+    Result results[3];
+    double a, b;
+
+    results[0].name = "decode Set Input Pos";
+    results[0].runtime_ns = run_decode(n_iterations, decode_runtime, &a);
+    results[0].constexpr_ns = run_decode(n_iterations, decode_constexpr, &b);
+    results[0].match = (a == b);
+
+    results[1].name = "encode Get Encoder Estimates";
+    results[1].runtime_ns = run_encode(n_iterations, encode_runtime, &a);
+    results[1].constexpr_ns = run_encode(n_iterations, encode_constexpr, &b);
+    results[1].match = (a == b);
+
+    results[2].name = "decode Motorola";
+    results[2].runtime_ns = run_decode(n_iterations, decode_motorola_runtime, &a);
+    results[2].constexpr_ns = run_decode(n_iterations, decode_motorola_constexpr, &b);
+    results[2].match = (a == b);
+
+    printf("%-30s %12s %12s\n", "", "runtime", "constexpr");
+    bool ok = true;
+    for (const Result& result: results) {
+        printf("%-30s %9.2f ns %9.2f ns%s\n", result.name, result.runtime_ns, result.constexpr_ns,
+               result.match ? "" : "  (results differ!)");
+        ok = ok && result.match;
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,225 @@
+/*
+* @brief Host benchmark for the Linux event loop
+*
+* Runs fibre::EpollEventLoop and measures:
+*  - the cost of call_later() and cancel_timer() with many timers pending.
+*    The delays range from 1 ms to several hours so that all levels of the
+*    timer wheel are used.
+*  - how late timers with delays of up to 200 ms fire.
+*  - the throughput of post() with 1, 2, 4 and 8 threads posting
+*    concurrently to the event loop thread.
+*
+* Usage: bench_event_loop.exe [--timers N] [--posts N]
+*
+* The program fails if a timer fires early, a timer doesn't fire, a
+* cancelled timer fires or a posted callback is lost.
+*/
+
+#include <fibre/../../platform_support/epoll_event_loop.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using bench_clock = std::chrono::steady_clock;
+
+static constexpr size_t kLatenessTimers = 200;
+
+static float elapsed_us(bench_clock::time_point start, bench_clock::time_point end) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-3f;
+}
+
+struct Bench;
+
+struct LatenessTimer {
+    Bench* bench;
+    bench_clock::time_point deadline;
+    bench_clock::time_point fired;
+    bool has_fired;
+    void on_timer();
+};
+
+struct Bench {
+    fibre::EpollEventLoop event_loop_;
+    std::mt19937 rng_{1234};
+    size_t n_timers_ = 100000;
+
+    float schedule_ns_ = 0.0f;
+    float cancel_ns_ = 0.0f;
+    size_t n_cancelled_fired_ = 0;
+    size_t n_fired_ = 0;
+    std::vector<LatenessTimer> lateness_timers_;
+
+    void on_started() {
+        // Schedule/cancel cost. None of these timers must fire.
+        std::uniform_real_distribution<float> log_delay(-3.0f, 4.5f); // 1 ms to ~9 hours
+        std::vector<float> delays(n_timers_);
+        for (float& delay: delays) {
+            delay = powf(10.0f, log_delay(rng_));
+        }
+        std::vector<fibre::EventLoopTimer*> timers(n_timers_);
+
+        auto start = bench_clock::now();
+        for (size_t i = 0; i < n_timers_; ++i) {
+            timers[i] = event_loop_.call_later(delays[i], MEMBER_CB(this, on_cancelled_timer));
+        }
+        auto end = bench_clock::now();
+        schedule_ns_ = elapsed_us(start, end) * 1e3f / n_timers_;
+
+        std::shuffle(timers.begin(), timers.end(), rng_);
+        start = bench_clock::now();
+        for (fibre::EventLoopTimer* timer: timers) {
+            event_loop_.cancel_timer(timer);
+        }
+        end = bench_clock::now();
+        cancel_ns_ = elapsed_us(start, end) * 1e3f / n_timers_;
+
+        // Lateness. Each timer is paired with one that is cancelled right away.
+        std::uniform_int_distribution<int> delay_ms(1, 200);
+        lateness_timers_.resize(kLatenessTimers);
+        for (LatenessTimer& timer: lateness_timers_) {
+            float delay = delay_ms(rng_) * 1e-3f;
+            timer = {this, bench_clock::now() + std::chrono::microseconds((int64_t)(delay * 1e6f)), {}, false};
+            event_loop_.call_later(delay, MEMBER_CB(&timer, on_timer));
+            fibre::EventLoopTimer* cancelled = event_loop_.call_later(delay, MEMBER_CB(this, on_cancelled_timer));
+            event_loop_.cancel_timer(cancelled);
+        }
+    }
+
+    void on_cancelled_timer() {
+        n_cancelled_fired_++;
+    }
+};
+
+void LatenessTimer::on_timer() {
+    fired = bench_clock::now();
+    has_fired = true;
+    bench->n_fired_++;
+}
+
+/**
+ * @brief Posts callbacks from several threads and counts them on the event
+ * loop thread.
+ *
+ * A long timer keeps the event loop running until all posts arrived.
+ */
+struct PostBench {
+    fibre::EpollEventLoop event_loop_;
+    size_t n_producers_;
+    size_t n_posts_; // per producer
+    size_t n_received_ = 0;
+    size_t n_failed_ = 0;
+    fibre::EventLoopTimer* keepalive_timer_ = nullptr;
+    std::vector<std::thread> producers_;
+    bench_clock::time_point start_;
+    bench_clock::time_point end_;
+
+    void on_started() {
+        keepalive_timer_ = event_loop_.call_later(3600.0f, MEMBER_CB(this, on_timeout));
+        start_ = bench_clock::now();
+        for (size_t i = 0; i < n_producers_; ++i) {
+            producers_.push_back(std::thread([this]() {
+                for (size_t j = 0; j < n_posts_; ++j) {
+                    if (!event_loop_.post(MEMBER_CB(this, on_post))) {
+                        n_failed_++; // not exact under contention but good enough to detect failures
+                    }
+                }
+            }));
+        }
+    }
+
+    void on_post() {
+        if (++n_received_ == n_producers_ * n_posts_) {
+            end_ = bench_clock::now();
+            event_loop_.cancel_timer(keepalive_timer_);
+            keepalive_timer_ = nullptr;
+        }
+    }
+
+    void on_timeout() {
+        keepalive_timer_ = nullptr;
+    }
+};
+
+static bool run_post_bench(size_t n_producers, size_t n_posts) {
+    PostBench* bench = new PostBench();
+    bench->n_producers_ = n_producers;
+    bench->n_posts_ = n_posts;
+
+    bool ok = bench->event_loop_.start(MEMBER_CB(bench, on_started));
+    for (std::thread& producer: bench->producers_) {
+        producer.join();
+    }
+
+    size_t n_expected = n_producers * n_posts;
+    ok = ok && !bench->n_failed_ && bench->n_received_ == n_expected;
+    float time_us = elapsed_us(bench->start_, bench->end_);
+    printf("%10zu %14.2f %14.0f\n", n_producers, n_expected / time_us, time_us * 1e3f / n_expected);
+    delete bench;
+    return ok;
+}
+
+int main(int argc, const char** argv) {
+    Bench* bench = new Bench();
+    size_t n_posts = 1000000;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--timers") && i + 1 < argc) {
+            bench->n_timers_ = std::max<size_t>(strtoul(argv[++i], nullptr, 10), 1);
+        } else if (!strcmp(argv[i], "--posts") && i + 1 < argc) {
+            n_posts = std::max<size_t>(strtoul(argv[++i], nullptr, 10), 1);
+        } else {
+            fprintf(stderr, "usage: %s [--timers N] [--posts N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // The event loop returns once all timers have fired.
+    if (!bench->event_loop_.start(MEMBER_CB(bench, on_started))) {
+        fprintf(stderr, "event loop failed\n");
+        return 1;
+    }
+
+    float max_lateness_us = 0.0f;
+    float total_lateness_us = 0.0f;
+    size_t n_early = 0;
+    for (LatenessTimer& timer: bench->lateness_timers_) {
+        float lateness_us = elapsed_us(timer.deadline, timer.fired);
+        n_early += !timer.has_fired || lateness_us < 0.0f;
+        max_lateness_us = std::max(max_lateness_us, lateness_us);
+        total_lateness_us += lateness_us;
+    }
+
+    printf("%zu timers pending\n", bench->n_timers_);
+    printf("%14s %14s %18s %18s\n", "schedule [ns]", "cancel [ns]", "avg lateness [us]", "max lateness [us]");
+    printf("%14.0f %14.0f %18.0f %18.0f\n", bench->schedule_ns_, bench->cancel_ns_,
+           total_lateness_us / kLatenessTimers, max_lateness_us);
+
+    if (n_early || bench->n_fired_ != kLatenessTimers) {
+        fprintf(stderr, "%zu timers fired early or not at all\n", n_early);
+        return 1;
+    }
+    if (bench->n_cancelled_fired_) {
+        fprintf(stderr, "%zu cancelled timers fired\n", bench->n_cancelled_fired_);
+        return 1;
+    }
+
+    delete bench;
+
+    printf("\n%zu posts per thread\n", n_posts);
+    printf("%10s %14s %14s\n", "threads", "posts/us", "ns per post");
+    for (size_t n_producers: {1, 2, 4, 8}) {
+        if (!run_post_bench(n_producers, n_posts)) {
+            fprintf(stderr, "posted callbacks were lost\n");
+            return 1;
+        }
+    }
+
+    return 0;
+}
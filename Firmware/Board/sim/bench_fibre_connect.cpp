@@ -0,0 +1,288 @@
+/*
+* @brief Host benchmark for the connection setup of the Fibre client
+*
+* Connects a LegacyObjectClient to a simulated ODrive that serves the real
+* JSON interface definition (see embedded_json_template.j2) over a USB-like
+* link with a 64 byte MTU. The time is measured from starting the protocol
+* until the first function call (a read of vbus_voltage) returns.
+*
+* The benchmark runs three times:
+*  - without the interface cache
+*  - with an empty cache (the JSON is downloaded and stored)
+*  - with a populated cache (the JSON download is skipped)
+*
+* For each run it reports the number of request/response round-trips on the
+* link, the host time and the estimated latency on a real link, which is the
+* host time plus `--rtt-us` per round-trip.
+*
+* Usage: bench_fibre_connect.exe [--iterations N] [--rtt-us US]
+*
+* The program fails if the cached run doesn't skip the JSON download or if
+* the first call doesn't return the expected value.
+*/
+
+#include <fibre/../../legacy_protocol.hpp>
+#include <fibre/../../crc.hpp>
+#include <fibre/simple_serdes.hpp>
+#include <autogen/embedded_json.hpp>
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using bench_clock = std::chrono::steady_clock;
+
+static constexpr size_t kMtu = 64;
+static constexpr float kVbusVoltage = 24.5f;
+
+/**
+ * @brief Simulated server side of a packet based link.
+ *
+ * Requests are answered like the firmware's endpoint0_handler() does for
+ * endpoint 0. Every other endpoint returns vbus_voltage. All completions are
+ * deferred to run() so that nothing recurses into the protocol.
+ */
+class SimDevice : public fibre::AsyncStreamSink, public fibre::AsyncStreamSource {
+public:
+    SimDevice() {
+        json_crc_ = calc_crc16<fibre::CANONICAL_CRC16_POLYNOMIAL>(fibre::PROTOCOL_VERSION, fibre::embedded_json, fibre::embedded_json_length);
+        json_version_id_ = ((uint32_t)json_crc_ << 16) | calc_crc16<fibre::CANONICAL_CRC16_POLYNOMIAL>(json_crc_, fibre::embedded_json, fibre::embedded_json_length);
+    }
+
+    void start_write(fibre::cbufptr_t buffer, fibre::TransferHandle* handle, fibre::Callback<void, fibre::WriteResult> completer) final {
+        if (handle) {
+            *handle = 1;
+        }
+        handle_request(buffer);
+        tasks_.push_back([=]() { completer.invoke({fibre::kStreamOk, buffer.end()}); });
+    }
+    void cancel_write(fibre::TransferHandle transfer_handle) final {}
+
+    void start_read(fibre::bufptr_t buffer, fibre::TransferHandle* handle, fibre::Callback<void, fibre::ReadResult> completer) final {
+        if (handle) {
+            *handle = 1;
+        }
+        read_buf_ = buffer;
+        read_completer_ = completer;
+        deliver();
+    }
+    void cancel_read(fibre::TransferHandle transfer_handle) final {}
+
+    void run() {
+        while (!tasks_.empty()) {
+            std::function<void()> task = tasks_.front();
+            tasks_.pop_front();
+            task();
+        }
+    }
+
+    uint16_t json_crc_;
+    uint32_t json_version_id_;
+    size_t n_round_trips_ = 0;
+    size_t n_json_reads_ = 0;
+
+private:
+    void handle_request(fibre::cbufptr_t request) {
+        if (request.size() < 8) {
+            return;
+        }
+        n_round_trips_++;
+
+        uint16_t seqno = *read_le<uint16_t>(&request);
+        uint16_t endpoint_id = *read_le<uint16_t>(&request) & 0x7fff;
+        size_t response_length = std::min<size_t>(*read_le<uint16_t>(&request), kMtu - 2);
+        uint16_t trailer = *(request.end() - 2) | (*(request.end() - 1) << 8);
+        request = request.take(request.size() - 2);
+
+        if (trailer != (endpoint_id ? json_crc_ : fibre::PROTOCOL_VERSION)) {
+            return;
+        }
+
+        std::vector<uint8_t> response(2);
+        write_le<uint16_t>(seqno | 0x8000, response.data());
+
+        if (endpoint_id == 0) {
+            uint32_t offset = *read_le<uint32_t>(&request);
+            if (offset == 0xffffffff) {
+                uint8_t buf[4];
+                write_le<uint32_t>(json_version_id_, buf);
+                response.insert(response.end(), buf, buf + 4);
+            } else if (offset < fibre::embedded_json_length) {
+                n_json_reads_++;
+                size_t n_copy = std::min(response_length, fibre::embedded_json_length - offset);
+                response.insert(response.end(), fibre::embedded_json + offset, fibre::embedded_json + offset + n_copy);
+            }
+        } else {
+            uint8_t buf[4];
+            write_le<float>(kVbusVoltage, buf);
+            response.insert(response.end(), buf, buf + std::min<size_t>(4, response_length));
+        }
+
+        responses_.push_back(response);
+        deliver();
+    }
+
+    void deliver() {
+        if (!read_completer_ || responses_.empty()) {
+            return;
+        }
+        std::vector<uint8_t> response = responses_.front();
+        responses_.pop_front();
+        size_t n_copy = std::min(response.size(), read_buf_.size());
+        memcpy(read_buf_.begin(), response.data(), n_copy);
+        fibre::Callback<void, fibre::ReadResult> completer = read_completer_;
+        uint8_t* end = read_buf_.begin() + n_copy;
+        read_completer_ = nullptr;
+        tasks_.push_back([=]() { completer.invoke({fibre::kStreamOk, end}); });
+    }
+
+    std::deque<std::function<void()>> tasks_;
+    std::deque<std::vector<uint8_t>> responses_;
+    fibre::bufptr_t read_buf_;
+    fibre::Callback<void, fibre::ReadResult> read_completer_;
+};
+
+/**
+ * @brief Connects to a SimDevice and reads vbus_voltage as soon as the root
+ * object was found.
+ */
+struct Connection {
+    Connection() : protocol_(&device_, &device_, kMtu) {}
+
+    bool run() {
+        protocol_.start(MEMBER_CB(this, on_found_root_object), MEMBER_CB(this, on_lost_root_object), MEMBER_CB(this, on_stopped));
+        device_.run();
+        return done_;
+    }
+
+    void on_found_root_object(fibre::LegacyObjectClient* client, std::shared_ptr<fibre::LegacyObject> obj) {
+        auto attr = obj->intf->attributes.find("vbus_voltage");
+        if (attr == obj->intf->attributes.end()) {
+            return;
+        }
+        auto func = attr->second.object->intf->functions.find("read");
+        if (func == attr->second.object->intf->functions.end()) {
+            return;
+        }
+
+        void* call_handle = nullptr;
+        obj_arg_ = reinterpret_cast<uintptr_t>(attr->second.object.get());
+        auto result = func->second.call(&call_handle,
+                {fibre::kFibreOk, {reinterpret_cast<const uint8_t*>(&obj_arg_), sizeof(obj_arg_)}, {reinterpret_cast<uint8_t*>(&value_), sizeof(value_)}},
+                MEMBER_CB(this, on_call_finished));
+        if (result.has_value()) {
+            on_call_finished(*result);
+        }
+    }
+
+    std::optional<fibre::CallBuffers> on_call_finished(fibre::CallBufferRelease result) {
+        done_ = result.status == fibre::kFibreClosed && value_ == kVbusVoltage;
+        return fibre::CallBuffers{fibre::kFibreClosed, {}, {}};
+    }
+
+    void on_lost_root_object(fibre::LegacyObjectClient* client, std::shared_ptr<fibre::LegacyObject> obj) {}
+    void on_stopped(fibre::LegacyProtocolPacketBased* protocol, fibre::StreamStatus status) {}
+
+    SimDevice device_;
+    fibre::LegacyProtocolPacketBased protocol_;
+    uintptr_t obj_arg_;
+    float value_ = 0.0f;
+    bool done_ = false;
+};
+
+struct RunResult {
+    bool ok;
+    size_t n_round_trips;
+    size_t n_json_reads;
+    float host_time_us;
+};
+
+static RunResult run_connect(uint32_t n_iterations, const char* cache_dir, bool clear_cache) {
+    setenv("FIBRE_CACHE_DIR", cache_dir, 1);
+    RunResult result = {true, 0, 0, 0.0f};
+
+    for (uint32_t i = 0; i < n_iterations; ++i) {
+        Connection* connection = new Connection();
+        if (clear_cache) {
+            char path[256];
+            snprintf(path, sizeof(path), "%s/interface-%08x.json", cache_dir, (unsigned)connection->device_.json_version_id_);
+            remove(path);
+        }
+
+        auto start = bench_clock::now();
+        result.ok = connection->run() && result.ok;
+        result.host_time_us += std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - start).count() * 1e-3f;
+        result.n_round_trips += connection->device_.n_round_trips_;
+        result.n_json_reads += connection->device_.n_json_reads_;
+        delete connection;
+    }
+
+    result.n_round_trips /= n_iterations;
+    result.n_json_reads /= n_iterations;
+    result.host_time_us /= n_iterations;
+    return result;
+}
+
+int main(int argc, const char** argv) {
+    uint32_t n_iterations = 20;
+    float rtt_us = 1000.0f;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--iterations") && i + 1 < argc) {
+            n_iterations = std::max<uint32_t>(strtoul(argv[++i], nullptr, 10), 1);
+        } else if (!strcmp(argv[i], "--rtt-us") && i + 1 < argc) {
+            rtt_us = strtof(argv[++i], nullptr);
+        } else {
+            fprintf(stderr, "usage: %s [--iterations N] [--rtt-us US]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    char cache_dir[] = "/tmp/bench_fibre_connect.XXXXXX";
+    if (!mkdtemp(cache_dir)) {
+        fprintf(stderr, "can't create cache directory\n");
+        return 1;
+    }
+
+    struct {
+        const char* name;
+        const char* cache_dir;
+        bool clear_cache;
+    } runs[] = {
+        {"no cache", "", false},
+        {"cache miss", cache_dir, true},
+        {"cache hit", cache_dir, false},
+    };
+
+    printf("JSON: %zu bytes, link RTT: %.0f us\n", fibre::embedded_json_length, rtt_us);
+    printf("%-12s %12s %12s %14s %14s\n", "", "round-trips", "JSON reads", "host time [us]", "latency [ms]");
+    RunResult results[3];
+    for (size_t i = 0; i < 3; ++i) {
+        results[i] = run_connect(n_iterations, runs[i].cache_dir, runs[i].clear_cache);
+        printf("%-12s %12zu %12zu %14.0f %14.1f\n", runs[i].name, results[i].n_round_trips, results[i].n_json_reads,
+               results[i].host_time_us, (results[i].host_time_us + results[i].n_round_trips * rtt_us) * 1e-3f);
+    }
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s/interface-%08x.json", cache_dir, (unsigned)SimDevice{}.json_version_id_);
+    remove(path);
+    rmdir(cache_dir);
+
+    for (RunResult& result: results) {
+        if (!result.ok) {
+            fprintf(stderr, "first call failed\n");
+            return 1;
+        }
+    }
+    if (results[2].n_json_reads) {
+        fprintf(stderr, "cache hit didn't skip the JSON download\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,83 @@
+/*
+* @brief Host benchmark for loading the JSON interface definition
+*
+* Builds the object tree of the real ODrive JSON interface definition (see
+* embedded_json_template.j2) with LegacyObjectClient::load_interface() and
+* reports the time and the number of heap allocations per load.
+*
+* Usage: bench_json_parse.exe [--iterations N]
+*
+* The program fails if the JSON can't be loaded.
+*/
+
+#include <fibre/../../legacy_protocol.hpp>
+#include <autogen/embedded_json.hpp>
+
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using bench_clock = std::chrono::steady_clock;
+
+static size_t n_allocations = 0;
+
+void* operator new(size_t size) {
+    n_allocations++;
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t size) noexcept {
+    free(ptr);
+}
+
+int main(int argc, const char** argv) {
+    uint32_t n_iterations = 200;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--iterations") && i + 1 < argc) {
+            n_iterations = std::max<uint32_t>(strtoul(argv[++i], nullptr, 10), 1);
+        } else {
+            fprintf(stderr, "usage: %s [--iterations N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    fibre::cbufptr_t json = {fibre::embedded_json, fibre::embedded_json_length};
+    size_t n_objects = 0;
+    size_t total_allocations = 0;
+    float total_time_us = 0.0f;
+
+    for (uint32_t i = 0; i < n_iterations; ++i) {
+        fibre::LegacyObjectClient* client = new fibre::LegacyObjectClient{nullptr};
+
+        size_t allocations_before = n_allocations;
+        auto start = bench_clock::now();
+        std::shared_ptr<fibre::LegacyObject> root_obj = client->load_interface(json);
+        total_time_us += std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - start).count() * 1e-3f;
+        total_allocations += n_allocations - allocations_before;
+
+        if (!root_obj) {
+            fprintf(stderr, "failed to load the JSON\n");
+            return 1;
+        }
+        n_objects = client->objects_.size();
+        root_obj = nullptr;
+        delete client;
+    }
+
+    printf("JSON: %zu bytes, %zu objects\n", fibre::embedded_json_length, n_objects);
+    printf("%14s %14s\n", "time [us]", "allocations");
+    printf("%14.0f %14zu\n", total_time_us / n_iterations, total_allocations / n_iterations);
+
+    return 0;
+}
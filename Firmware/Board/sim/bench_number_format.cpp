@@ -0,0 +1,113 @@
+/*
+* @brief Host micro-benchmark for the number conversion of the ASCII protocol
+*
+* Compares sscanf() / snprintf(), which the ASCII protocol used before, and
+* strtof() against fibre::parse_number() / fibre::format_number() from
+* fibre/number_format.hpp on a set of typical setpoint and feedback values.
+*
+* Usage: bench_number_format.exe [--iterations N]
+*
+* The program fails if a formatted float doesn't parse back to the exact same
+* value.
+*/
+
+#include <fibre/number_format.hpp>
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using bench_clock = std::chrono::steady_clock;
+
+static std::vector<float> make_values(size_t n) {
+    std::vector<float> values(n);
+    uint32_t state = 1;
+    for (float& value: values) {
+        state = state * 1664525u + 1013904223u;
+        value = ((float)(state >> 8) / (float)(1 << 24) - 0.5f) * 200.0f;
+    }
+    return values;
+}
+
+template<typename TFunc>
+static float run_ns(uint32_t n_iterations, size_t n_values, TFunc func) {
+    auto start = bench_clock::now();
+    for (uint32_t i = 0; i < n_iterations; ++i) {
+        func(i % n_values);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - start);
+    return (float)elapsed.count() / (float)n_iterations;
+}
+
+int main(int argc, const char** argv) {
+    uint32_t n_iterations = 1000000;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--iterations") && i + 1 < argc) {
+            n_iterations = std::max<uint32_t>(strtoul(argv[++i], nullptr, 10), 1);
+        } else {
+            fprintf(stderr, "usage: %s [--iterations N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    const size_t n_values = 4096;
+    std::vector<float> values = make_values(n_values);
+
+    // Text as the host would send it and as the ODrive would send it
+    std::vector<std::string> printf_strs, shortest_strs;
+    for (float value: values) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%f", (double)value);
+        printf_strs.push_back(buf);
+        fibre::format_number(value, buf, sizeof(buf));
+        shortest_strs.push_back(buf);
+    }
+
+    size_t n_failed = 0;
+    for (size_t i = 0; i < n_values; ++i) {
+        float parsed;
+        const char* str = shortest_strs[i].c_str();
+        if (!fibre::parse_number(str, str + strlen(str), &parsed) || parsed != values[i]) {
+            n_failed++;
+        }
+    }
+
+    volatile float sink_f = 0.0f;
+    volatile size_t sink_n = 0;
+    char buf[32];
+
+    printf("%-24s %10s\n", "", "ns/value");
+    printf("%-24s %10.1f\n", "sscanf(\"%f\")", run_ns(n_iterations, n_values, [&](size_t i) {
+        float value;
+        sscanf(printf_strs[i].c_str(), "%f", &value);
+        sink_f = value;
+    }));
+    printf("%-24s %10.1f\n", "strtof()", run_ns(n_iterations, n_values, [&](size_t i) {
+        sink_f = strtof(printf_strs[i].c_str(), nullptr);
+    }));
+    printf("%-24s %10.1f\n", "parse_number()", run_ns(n_iterations, n_values, [&](size_t i) {
+        const std::string& str = printf_strs[i];
+        float value;
+        fibre::parse_number(str.data(), str.data() + str.size(), &value);
+        sink_f = value;
+    }));
+    printf("%-24s %10.1f\n", "snprintf(\"%f\")", run_ns(n_iterations, n_values, [&](size_t i) {
+        sink_n = snprintf(buf, sizeof(buf), "%f", (double)values[i]);
+    }));
+    printf("%-24s %10.1f\n", "snprintf(\"%.9g\")", run_ns(n_iterations, n_values, [&](size_t i) {
+        sink_n = snprintf(buf, sizeof(buf), "%.9g", (double)values[i]);
+    }));
+    printf("%-24s %10.1f\n", "format_number()", run_ns(n_iterations, n_values, [&](size_t i) {
+        sink_n = fibre::format_number(values[i], buf, sizeof(buf));
+    }));
+
+    if (n_failed) {
+        fprintf(stderr, "%zu values didn't survive the round trip\n", n_failed);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+/*
+* @brief Host micro-benchmark for our_arm_sincos_f32()
+*
+* Compares the fused sin/cos lookup that is used for the Park and inverse Park
+* transforms in foc.cpp against separate calls to our_arm_sin_f32() and
+* our_arm_cos_f32() and checks that the results agree.
+*
+* Usage: bench_sincos.exe [--iterations N]
+*/
+
+#include <MotorControl/utils.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using bench_clock = std::chrono::steady_clock;
+
+template<typename TFunc>
+static float run_ns_per_call(const std::vector<float>& phases, uint32_t n_iterations, TFunc func) {
+    volatile float sink = 0.0f;
+    auto start = bench_clock::now();
+    for (uint32_t i = 0; i < n_iterations; ++i) {
+        float acc = 0.0f;
+        for (float phase: phases) {
+            auto [s, c] = func(phase);
+            acc += s + c;
+        }
+        sink = sink + acc;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - start);
+    return (float)elapsed.count() / ((float)n_iterations * (float)phases.size());
+}
+
+int main(int argc, const char** argv) {
+    uint32_t n_iterations = 2000;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--iterations") && i + 1 < argc) {
+            n_iterations = strtoul(argv[++i], nullptr, 10);
+        } else {
+            fprintf(stderr, "usage: %s [--iterations N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // Phases as seen by the current controller: wrapped to [-pi, pi) plus
+    // a small extrapolation offset.
+    std::vector<float> phases;
+    for (size_t i = 0; i < 4096; ++i) {
+        phases.push_back(wrap_pm_pi(0.01f * (float)i * (float)i) + 0.05f);
+    }
+
+    float max_err_sin = 0.0f;
+    float max_err_cos = 0.0f;
+    for (float phase: phases) {
+        float s, c;
+        our_arm_sincos_f32(phase, &s, &c);
+        max_err_sin = std::max(max_err_sin, std::abs(s - our_arm_sin_f32(phase)));
+        max_err_cos = std::max(max_err_cos, std::abs(c - our_arm_cos_f32(phase)));
+    }
+
+    float separate_ns = run_ns_per_call(phases, n_iterations, [](float phase) {
+        return std::make_pair(our_arm_sin_f32(phase), our_arm_cos_f32(phase));
+    });
+    float fused_ns = run_ns_per_call(phases, n_iterations, [](float phase) {
+        float s, c;
+        our_arm_sincos_f32(phase, &s, &c);
+        return std::make_pair(s, c);
+    });
+
+    printf("our_arm_sin_f32 + our_arm_cos_f32: %6.2f ns/call\n", separate_ns);
+    printf("our_arm_sincos_f32:                %6.2f ns/call (%.0f%% saved)\n", fused_ns, 100.0f * (1.0f - fused_ns / separate_ns));
+    printf("max deviation: sin %g, cos %g\n", max_err_sin, max_err_cos);
+
+    // Both variants interpolate between the same table entries so they may
+    // only differ by float rounding.
+    return (max_err_sin <= 1e-6f && max_err_cos <= 1e-6f) ? 0 : 1;
+}
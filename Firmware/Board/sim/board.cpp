@@ -0,0 +1,342 @@
+/*
+* @brief Contains board specific variables and initialization functions for
+* the host simulator
+*/
+
+#include <board.h>
+
+#include <odrive_main.h>
+#include <low_level.h>
+
+#include "sim_plant.hpp"
+
+#include <chrono>
+#include <cmath>
+
+// this should technically be in task_timer.cpp but let's not make a one-line file
+bool TaskTimer::enabled = false;
+
+
+/* Peripherals -------------------------------------------------------------- */
+
+GPIO_TypeDef sim_gpioa, sim_gpiob, sim_gpioc;
+
+static TIM_TypeDef sim_tim1, sim_tim3, sim_tim4, sim_tim8, sim_tim14;
+TIM_HandleTypeDef htim1{&sim_tim1};
+TIM_HandleTypeDef htim3{&sim_tim3};
+TIM_HandleTypeDef htim4{&sim_tim4};
+TIM_HandleTypeDef htim8{&sim_tim8};
+TIM_HandleTypeDef htim14{&sim_tim14};
+
+static SPI_HandleTypeDef hspi3;
+static UART_HandleTypeDef huart4;
+
+SimTim13 sim_tim13;
+
+using sim_clock = std::chrono::steady_clock;
+static sim_clock::time_point sim_period_start = sim_clock::now();
+static uint32_t sim_tick = 0; // simulated time in [ms]
+
+SimTim13::Counter::operator uint32_t() const {
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(sim_clock::now() - sim_period_start);
+    uint64_t cnt = (uint64_t)elapsed.count() * (TIM_APB1_CLOCK_HZ / 1000000) / 1000ULL;
+
+    // sample_TIM13() truncates the result to 16 bits. On hardware the counter
+    // never gets there because it's reloaded every control period. If the host
+    // process is preempted we saturate instead so that the affected task shows
+    // up as very long rather than wrapping around to a bogus value.
+    const uint64_t max_cnt = UINT16_MAX / (TIM_1_8_CLOCK_HZ / TIM_APB1_CLOCK_HZ);
+    return (uint32_t)std::min(cnt, max_cnt);
+}
+
+void sim_start_period() {
+    sim_period_start = sim_clock::now();
+}
+
+extern "C" uint32_t HAL_GetTick(void) {
+    return sim_tick;
+}
+
+extern "C" void NVIC_SystemReset(void) {
+    abort();
+}
+
+
+/* Board objects ------------------------------------------------------------ */
+
+Stm32SpiArbiter spi3_arbiter{&hspi3};
+Stm32SpiArbiter& ext_spi_arbiter = spi3_arbiter;
+
+UART_HandleTypeDef* uart_a = &huart4;
+UART_HandleTypeDef* uart_b = nullptr;
+UART_HandleTypeDef* uart_c = nullptr;
+
+SimGateDriver m0_gate_driver;
+SimGateDriver m1_gate_driver;
+
+const float fet_thermistor_poly_coeffs[] =
+    {363.93910201f, -462.15369634f, 307.55129571f, -27.72569531f};
+const size_t fet_thermistor_num_coeffs = sizeof(fet_thermistor_poly_coeffs)/sizeof(fet_thermistor_poly_coeffs[1]);
+
+OnboardThermistorCurrentLimiter fet_thermistors[AXIS_COUNT] = {
+    {
+        15, // adc_channel
+        &fet_thermistor_poly_coeffs[0], // coefficients
+        fet_thermistor_num_coeffs // num_coeffs
+    }, {
+        4, // adc_channel
+        &fet_thermistor_poly_coeffs[0], // coefficients
+        fet_thermistor_num_coeffs // num_coeffs
+    }
+};
+
+OffboardThermistorCurrentLimiter motor_thermistors[AXIS_COUNT];
+
+Motor motors[AXIS_COUNT] = {
+    {
+        &htim1, // timer
+        0b110, // current_sensor_mask
+        1.0f / SHUNT_RESISTANCE, // shunt_conductance [S]
+        m0_gate_driver, // gate_driver
+        m0_gate_driver, // opamp
+        fet_thermistors[0],
+        motor_thermistors[0]
+    },
+    {
+        &htim8, // timer
+        0b110, // current_sensor_mask
+        1.0f / SHUNT_RESISTANCE, // shunt_conductance [S]
+        m1_gate_driver, // gate_driver
+        m1_gate_driver, // opamp
+        fet_thermistors[1],
+        motor_thermistors[1]
+    }
+};
+
+Encoder encoders[AXIS_COUNT] = {
+    {
+        &htim3, // timer
+        {}, // index_gpio
+        {}, // hallA_gpio
+        {}, // hallB_gpio
+        {}, // hallC_gpio
+        &spi3_arbiter // spi_arbiter
+    },
+    {
+        &htim4, // timer
+        {}, // index_gpio
+        {}, // hallA_gpio
+        {}, // hallB_gpio
+        {}, // hallC_gpio
+        &spi3_arbiter // spi_arbiter
+    }
+};
+
+Endstop endstops[2 * AXIS_COUNT];
+MechanicalBrake mechanical_brakes[AXIS_COUNT];
+
+SensorlessEstimator sensorless_estimators[AXIS_COUNT];
+Controller controllers[AXIS_COUNT];
+TrapezoidalTrajectory trap[AXIS_COUNT];
+
+std::array<Axis, AXIS_COUNT> axes{{
+    {
+        0, // axis_num
+        1, // step_gpio_pin
+        2, // dir_gpio_pin
+        (osPriority)(osPriorityHigh + (osPriority)1), // thread_priority
+        encoders[0], // encoder
+        sensorless_estimators[0], // sensorless_estimator
+        controllers[0], // controller
+        motors[0], // motor
+        trap[0], // trap
+        endstops[0], endstops[1], // min_endstop, max_endstop
+        mechanical_brakes[0], // mechanical brake
+    },
+    {
+        1, // axis_num
+        7, // step_gpio_pin
+        8, // dir_gpio_pin
+        osPriorityHigh, // thread_priority
+        encoders[1], // encoder
+        sensorless_estimators[1], // sensorless_estimator
+        controllers[1], // controller
+        motors[1], // motor
+        trap[1], // trap
+        endstops[2], endstops[3], // min_endstop, max_endstop
+        mechanical_brakes[1], // mechanical brake
+    },
+}};
+
+Stm32Gpio gpios[GPIO_COUNT];
+std::array<GpioFunction, 3> alternate_functions[GPIO_COUNT];
+
+ODrive odrv{};
+
+
+/* Stubs for hardware dependent functions ----------------------------------- */
+
+const Stm32Gpio Stm32Gpio::none{nullptr, 0};
+
+bool Stm32Gpio::config(uint32_t mode, uint32_t pull, uint32_t speed) {
+    return port_;
+}
+
+bool Stm32Gpio::subscribe(bool rising_edge, bool falling_edge, void (*callback)(void*), void* ctx) {
+    return false;
+}
+
+void Stm32Gpio::unsubscribe() {}
+
+bool Stm32SpiArbiter::acquire_task(SpiTask* task) {
+    return !__atomic_exchange_n(&task->is_in_use, true, __ATOMIC_SEQ_CST);
+}
+
+void Stm32SpiArbiter::release_task(SpiTask* task) {
+    task->is_in_use = false;
+}
+
+void Stm32SpiArbiter::transfer_async(SpiTask* task) {
+    // No SPI devices are simulated
+    if (task->on_complete) {
+        (*task->on_complete)(task->on_complete_ctx, false);
+    }
+}
+
+float vbus_voltage = 24.0f;
+float ibus_ = 0.0f;
+bool brake_resistor_armed = false;
+bool brake_resistor_saturated = false;
+uint16_t adc_measurements_[ADC_CHANNEL_COUNT] = { 0 };
+
+void safety_critical_arm_brake_resistor() {
+    brake_resistor_armed = true;
+}
+
+void safety_critical_disarm_brake_resistor() {
+    brake_resistor_armed = false;
+}
+
+void update_brake_current() {
+    float Ibus_sum = 0.0f;
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        if (axes[i].motor_.is_armed_) {
+            Ibus_sum += axes[i].motor_.I_bus_;
+        }
+    }
+    ibus_ = Ibus_sum;
+}
+
+uint16_t channel_from_gpio(Stm32Gpio gpio) {
+    return UINT16_MAX;
+}
+
+float get_adc_voltage(Stm32Gpio gpio) {
+    return 0.0f;
+}
+
+float get_adc_relative_voltage(Stm32Gpio gpio) {
+    return 0.0f;
+}
+
+float get_adc_relative_voltage_ch(uint16_t channel) {
+    // Report a plausible value for the FET thermistors (~25°C)
+    return 0.5f;
+}
+
+void usb_notify_telemetry() {}
+
+USBStats_t usb_stats_;
+I2CStats_t i2c_stats_;
+uint64_t serial_number = 0;
+char serial_number_str[13] = "000000000000";
+
+extern "C" {
+const unsigned char fw_version_major_ = 0;
+const unsigned char fw_version_minor_ = 0;
+const unsigned char fw_version_revision_ = 0;
+const unsigned char fw_version_unreleased_ = 1;
+}
+
+// No CAN bus is simulated
+bool ODriveCAN::apply_config() { return true; }
+bool ODriveCAN::set_baud_rate(uint32_t baud_rate) { return false; }
+bool ODriveCAN::send_message(const can_Message_t& message) { return false; }
+bool ODriveCAN::send_latest(const can_Message_t& message) { return false; }
+bool ODriveCAN::send_heartbeat(const can_Message_t& message) { return false; }
+bool ODriveCAN::subscribe(const MsgIdFilterSpecs& filter, on_can_message_cb_t callback, void* ctx, CanSubscription** handle) { return false; }
+bool ODriveCAN::unsubscribe(CanSubscription* handle) { return false; }
+bool ODriveCAN::set_isr_callback(CanSubscription* handle, on_can_message_isr_cb_t callback) { return false; }
+bool ODriveCAN::start_cyclic_messages() { return cyclic_tx_.start(config_.cyclic_messages); }
+void ODriveCAN::stop_cyclic_messages() { cyclic_tx_.stop(); }
+void ODriveCAN::notify_tx() {}
+
+// The protocol endpoints are not compiled into the simulator
+bool fibre::get_float_readable_endpoint(endpoint_ref_t endpoint_ref, Introspectable* property) { return false; }
+
+bool ODrive::save_configuration(void) { return false; }
+void ODrive::erase_configuration(void) {}
+void ODrive::enter_dfu_mode() {}
+uint64_t ODrive::get_drv_fault() { return 0; }
+uint32_t ODrive::get_interrupt_status(int32_t irqn) { return 0; }
+uint32_t ODrive::get_dma_status(uint8_t stream_num) { return 0; }
+uint32_t ODrive::get_gpio_states() { return 0; }
+
+
+/* Control loop ------------------------------------------------------------- */
+
+volatile uint32_t timestamp_ = 0;
+
+/**
+ * @brief Runs one control period in the same sequence as the TIM8 update and
+ * control loop interrupts on ODrive v3 (see Board/v3/board.cpp).
+ *
+ * The plant is advanced by one control period in between the current
+ * measurement and the PWM update, which approximates the one period delay
+ * between measurement and actuation on the real hardware.
+ */
+void sim_control_loop_irq(SimPlant plants[AXIS_COUNT]) {
+    timestamp_ += TIM_1_8_PERIOD_CLOCKS * (TIM_1_8_RCR + 1);
+
+    // TIM8 update handler (counting up)
+    sim_start_period();
+    TaskTimer::enabled = odrv.task_timers_armed_;
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        plants[i].sample_encoder();
+    }
+    odrv.sampling_cb();
+
+    // Control loop handler
+    uint32_t timestamp = timestamp_;
+
+    std::optional<Iph_ABC_t> current0 = plants[0].get_current();
+    std::optional<Iph_ABC_t> current1 = plants[1].get_current();
+
+    motors[0].current_meas_cb(timestamp - TIM1_INIT_COUNT, current0);
+    motors[1].current_meas_cb(timestamp, current1);
+
+    odrv.control_loop_cb(timestamp);
+
+    // DC calibration samples are taken in SVM vector 7 where no current flows
+    Iph_ABC_t zero_current = {0.0f, 0.0f, 0.0f};
+    motors[0].dc_calib_cb(timestamp + TIM_1_8_PERIOD_CLOCKS * (TIM_1_8_RCR + 1) - TIM1_INIT_COUNT, zero_current);
+    motors[1].dc_calib_cb(timestamp + TIM_1_8_PERIOD_CLOCKS * (TIM_1_8_RCR + 1), zero_current);
+
+    motors[0].pwm_update_cb(timestamp + 3 * TIM_1_8_PERIOD_CLOCKS * (TIM_1_8_RCR + 1) - TIM1_INIT_COUNT);
+    motors[1].pwm_update_cb(timestamp + 3 * TIM_1_8_PERIOD_CLOCKS * (TIM_1_8_RCR + 1));
+
+    odrv.task_timers_armed_ = odrv.task_timers_armed_ && !TaskTimer::enabled;
+    TaskTimer::enabled = false;
+
+    // TIM8 update handler (counting down)
+    timestamp_ += TIM_1_8_PERIOD_CLOCKS * (TIM_1_8_RCR + 1);
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        plants[i].step(current_meas_period);
+    }
+
+    static uint32_t sub_ms = 0;
+    if (++sub_ms >= (uint32_t)current_meas_hz / 1000) {
+        sub_ms = 0;
+        sim_tick++;
+    }
+}
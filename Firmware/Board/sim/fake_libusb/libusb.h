@@ -0,0 +1,154 @@
+#ifndef __FAKE_LIBUSB_H
+#define __FAKE_LIBUSB_H
+
+/*
+* @brief Minimal stand-in for libusb.h
+*
+* Declares the subset of the libusb API that fibre's libusb backend uses so
+* that the backend can be compiled and tested on a host without libusb and
+* without a device. The test program defines the functions and decides when
+* submitted transfers complete (see test_libusb_endpoint.cpp).
+*/
+
+#include <limits.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/time.h>
+#include <sys/types.h>
+
+struct libusb_context;
+struct libusb_device;
+struct libusb_device_handle { int unused; };
+typedef int libusb_hotplug_callback_handle;
+
+typedef enum {
+    LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED = 1,
+    LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT = 2,
+} libusb_hotplug_event;
+
+enum {
+    LIBUSB_SUCCESS = 0,
+    LIBUSB_ERROR_NO_DEVICE = -4,
+    LIBUSB_ERROR_NOT_FOUND = -5,
+};
+
+enum {
+    LIBUSB_HOTPLUG_ENUMERATE = 1,
+    LIBUSB_HOTPLUG_MATCH_ANY = -1,
+    LIBUSB_CAP_HAS_HOTPLUG = 1,
+    LIBUSB_ENDPOINT_IN = 0x80,
+    LIBUSB_ENDPOINT_OUT = 0x00,
+    LIBUSB_TRANSFER_TYPE_BULK = 2,
+};
+
+enum libusb_transfer_status {
+    LIBUSB_TRANSFER_COMPLETED,
+    LIBUSB_TRANSFER_ERROR,
+    LIBUSB_TRANSFER_TIMED_OUT,
+    LIBUSB_TRANSFER_CANCELLED,
+    LIBUSB_TRANSFER_STALL,
+    LIBUSB_TRANSFER_NO_DEVICE,
+    LIBUSB_TRANSFER_OVERFLOW,
+};
+
+struct libusb_transfer;
+typedef void (*libusb_transfer_cb_fn)(struct libusb_transfer* transfer);
+
+struct libusb_transfer {
+    libusb_device_handle* dev_handle;
+    unsigned char endpoint;
+    unsigned int timeout;
+    enum libusb_transfer_status status;
+    int length;
+    int actual_length;
+    libusb_transfer_cb_fn callback;
+    void* user_data;
+    unsigned char* buffer;
+};
+
+struct libusb_endpoint_descriptor {
+    uint8_t bEndpointAddress;
+    uint8_t bmAttributes;
+    uint16_t wMaxPacketSize;
+};
+
+struct libusb_interface_descriptor {
+    uint8_t bNumEndpoints;
+    uint8_t bInterfaceClass;
+    uint8_t bInterfaceSubClass;
+    uint8_t bInterfaceProtocol;
+    const libusb_endpoint_descriptor* endpoint;
+};
+
+struct libusb_interface {
+    const libusb_interface_descriptor* altsetting;
+    int num_altsetting;
+};
+
+struct libusb_config_descriptor {
+    uint8_t bNumInterfaces;
+    const libusb_interface* interface;
+};
+
+struct libusb_device_descriptor {
+    uint16_t idVendor;
+    uint16_t idProduct;
+};
+
+struct libusb_pollfd {
+    int fd;
+    short events;
+};
+
+typedef void (*libusb_pollfd_added_cb)(int fd, short events, void* user_data);
+typedef void (*libusb_pollfd_removed_cb)(int fd, void* user_data);
+typedef int (*libusb_hotplug_callback_fn)(libusb_context* ctx, libusb_device* device, libusb_hotplug_event event, void* user_data);
+
+static inline void libusb_fill_bulk_transfer(libusb_transfer* transfer,
+        libusb_device_handle* dev_handle, unsigned char endpoint,
+        unsigned char* buffer, int length, libusb_transfer_cb_fn callback,
+        void* user_data, unsigned int timeout) {
+    transfer->dev_handle = dev_handle;
+    transfer->endpoint = endpoint;
+    transfer->buffer = buffer;
+    transfer->length = length;
+    transfer->callback = callback;
+    transfer->user_data = user_data;
+    transfer->timeout = timeout;
+}
+
+libusb_transfer* libusb_alloc_transfer(int iso_packets);
+void libusb_free_transfer(libusb_transfer* transfer);
+int libusb_submit_transfer(libusb_transfer* transfer);
+int libusb_cancel_transfer(libusb_transfer* transfer);
+const char* libusb_error_name(int error_code);
+
+int libusb_init(libusb_context** ctx);
+void libusb_exit(libusb_context* ctx);
+int libusb_has_capability(uint32_t capability);
+int libusb_handle_events(libusb_context* ctx);
+int libusb_handle_events_timeout(libusb_context* ctx, timeval* tv);
+int libusb_get_next_timeout(libusb_context* ctx, timeval* tv);
+void libusb_interrupt_event_handler(libusb_context* ctx);
+const libusb_pollfd** libusb_get_pollfds(libusb_context* ctx);
+void libusb_free_pollfds(const libusb_pollfd** pollfds);
+int libusb_pollfds_handle_timeouts(libusb_context* ctx);
+void libusb_set_pollfd_notifiers(libusb_context* ctx, libusb_pollfd_added_cb added_cb, libusb_pollfd_removed_cb removed_cb, void* user_data);
+int libusb_hotplug_register_callback(libusb_context* ctx, int events, int flags, int vendor_id, int product_id, int dev_class, libusb_hotplug_callback_fn cb_fn, void* user_data, libusb_hotplug_callback_handle* callback_handle);
+void libusb_hotplug_deregister_callback(libusb_context* ctx, libusb_hotplug_callback_handle callback_handle);
+
+ssize_t libusb_get_device_list(libusb_context* ctx, libusb_device*** list);
+void libusb_free_device_list(libusb_device** list, int unref_devices);
+libusb_device* libusb_ref_device(libusb_device* dev);
+void libusb_unref_device(libusb_device* dev);
+libusb_device* libusb_get_device(libusb_device_handle* dev_handle);
+uint8_t libusb_get_bus_number(libusb_device* dev);
+uint8_t libusb_get_device_address(libusb_device* dev);
+int libusb_get_device_descriptor(libusb_device* dev, libusb_device_descriptor* desc);
+int libusb_get_active_config_descriptor(libusb_device* dev, libusb_config_descriptor** config);
+void libusb_free_config_descriptor(libusb_config_descriptor* config);
+int libusb_open(libusb_device* dev, libusb_device_handle** dev_handle);
+void libusb_close(libusb_device_handle* dev_handle);
+int libusb_claim_interface(libusb_device_handle* dev_handle, int interface_number);
+
+#endif // __FAKE_LIBUSB_H
@@ -0,0 +1,200 @@
+
+#include "sim_can.hpp"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <errno.h>
+#include <linux/can.h>
+#include <net/if.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+bool SimCanBus::send_message(const can_Message_t& message) {
+    for (size_t i = 0; i < kNumTxMailboxes; ++i) {
+        if (!tx_mailbox_used_[i]) {
+            tx_mailboxes_[i] = message;
+            tx_mailbox_used_[i] = true;
+            return true;
+        }
+    }
+    stats_.n_tx_refused++;
+    return false;
+}
+
+bool SimCanBus::subscribe(const MsgIdFilterSpecs& filter, on_can_message_cb_t callback, void* ctx, CanSubscription** handle) {
+    auto it = std::find_if(subscriptions_.begin(), subscriptions_.end(), [](auto& subscription) {
+        return !subscription.in_use;
+    });
+
+    if (it == subscriptions_.end()) {
+        return false; // all subscription slots in use
+    }
+
+    it->in_use = true;
+    it->filter = filter;
+    it->callback = callback;
+    it->ctx = ctx;
+    if (handle) {
+        *handle = &*it;
+    }
+    return true;
+}
+
+bool SimCanBus::unsubscribe(CanSubscription* handle) {
+    SimCanSubscription* subscription = static_cast<SimCanSubscription*>(handle);
+    if (subscription < subscriptions_.begin() || subscription >= subscriptions_.end()) {
+        return false;
+    }
+    if (!subscription->in_use) {
+        return false;
+    }
+    subscription->in_use = false;
+    return true;
+}
+
+bool SimCanBus::matches(const MsgIdFilterSpecs& filter, const can_Message_t& msg) {
+    bool is_extended = filter.id.index() == 1;
+    uint32_t id = is_extended ? std::get<1>(filter.id) : std::get<0>(filter.id);
+    return (msg.isExt == is_extended) && !((msg.id ^ id) & filter.mask);
+}
+
+bool SimCanBus::receive(const can_Message_t& msg) {
+    // Like the hardware the filter with the lowest index wins
+    auto it = std::find_if(subscriptions_.begin(), subscriptions_.end(), [&](auto& subscription) {
+        return subscription.in_use && matches(subscription.filter, msg);
+    });
+
+    if (it == subscriptions_.end()) {
+        stats_.n_rx_filtered++;
+        return false;
+    }
+
+    if (rx_fill_level_ >= kRxFifoDepth) {
+        stats_.n_rx_overrun++;
+        return false;
+    }
+
+    size_t write_idx = (rx_read_idx_ + rx_fill_level_) % kRxFifoDepth;
+    rx_fifo_[write_idx] = {msg, &*it};
+    rx_fill_level_++;
+    stats_.n_rx_accepted++;
+    return true;
+}
+
+size_t SimCanBus::process_rx() {
+    size_t n_dispatched = 0;
+    while (rx_fill_level_) {
+        RxFifoEntry entry = rx_fifo_[rx_read_idx_];
+        rx_read_idx_ = (rx_read_idx_ + 1) % kRxFifoDepth;
+        rx_fill_level_--;
+
+        // The subscription might have been cancelled in the meantime
+        if (entry.subscription->in_use) {
+            entry.subscription->callback(entry.subscription->ctx, entry.msg);
+            n_dispatched++;
+        }
+    }
+    stats_.n_dispatched += n_dispatched;
+    return n_dispatched;
+}
+
+const can_Message_t* SimCanBus::peek_tx() const {
+    const can_Message_t* next = nullptr;
+    for (size_t i = 0; i < kNumTxMailboxes; ++i) {
+        if (tx_mailbox_used_[i] && (!next || tx_mailboxes_[i].id < next->id)) {
+            next = &tx_mailboxes_[i];
+        }
+    }
+    return next;
+}
+
+bool SimCanBus::pop_tx(can_Message_t* msg) {
+    const can_Message_t* next = peek_tx();
+    if (!next) {
+        return false;
+    }
+    size_t idx = next - tx_mailboxes_;
+    if (msg) {
+        *msg = *next;
+    }
+    tx_mailbox_used_[idx] = false;
+    stats_.n_tx++;
+    return true;
+}
+
+
+#ifdef __linux__
+
+SocketCanBus::~SocketCanBus() {
+    if (socket_ >= 0) {
+        close(socket_);
+    }
+}
+
+bool SocketCanBus::open(const char* interface_name) {
+    socket_ = socket(PF_CAN, SOCK_RAW | SOCK_NONBLOCK, CAN_RAW);
+    if (socket_ < 0) {
+        return false;
+    }
+
+    struct ifreq ifr = {};
+    strncpy(ifr.ifr_name, interface_name, IFNAMSIZ - 1);
+    if (ioctl(socket_, SIOCGIFINDEX, &ifr) < 0) {
+        return false;
+    }
+
+    struct sockaddr_can addr = {};
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+    return bind(socket_, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+}
+
+bool SocketCanBus::send_message(const can_Message_t& message) {
+    struct can_frame frame = {};
+    frame.can_id = message.isExt ? ((message.id & CAN_EFF_MASK) | CAN_EFF_FLAG) : (message.id & CAN_SFF_MASK);
+    frame.can_id |= message.rtr ? CAN_RTR_FLAG : 0;
+    frame.can_dlc = std::min<uint8_t>(message.len, 8);
+    memcpy(frame.data, message.buf, sizeof(frame.data));
+
+    if (write(socket_, &frame, sizeof(frame)) != sizeof(frame)) {
+        stats_.n_tx_refused++;
+        return false;
+    }
+    stats_.n_tx++;
+    return true;
+}
+
+bool SocketCanBus::poll(int timeout_ms) {
+    struct pollfd pfd = {socket_, POLLIN, 0};
+    if (::poll(&pfd, 1, timeout_ms) < 0) {
+        return false;
+    }
+
+    for (;;) {
+        struct can_frame frame;
+        ssize_t n_read = read(socket_, &frame, sizeof(frame));
+        if (n_read < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        } else if (n_read != sizeof(frame)) {
+            return false;
+        }
+
+        can_Message_t msg;
+        msg.isExt = frame.can_id & CAN_EFF_FLAG;
+        msg.rtr = frame.can_id & CAN_RTR_FLAG;
+        msg.id = frame.can_id & (msg.isExt ? CAN_EFF_MASK : CAN_SFF_MASK);
+        msg.len = frame.can_dlc;
+        memcpy(msg.buf, frame.data, sizeof(msg.buf));
+
+        // The socket buffers the frames so the RX FIFO never overflows here
+        receive(msg);
+        process_rx();
+    }
+}
+
+#endif
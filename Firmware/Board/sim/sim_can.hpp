@@ -0,0 +1,121 @@
+#ifndef __SIM_CAN_HPP
+#define __SIM_CAN_HPP
+
+#include <communication/can/canbus.hpp>
+
+#include <array>
+#include <stddef.h>
+
+/**
+ * @brief In-memory CAN bus endpoint that behaves like one node's bxCAN
+ * peripheral.
+ *
+ * The node's side uses the CanBusBase interface just like on hardware. The
+ * bus side injects frames with receive() and takes the node's frames with
+ * pop_tx().
+ *
+ * Like the hardware, received frames that pass one of the subscription
+ * filters are queued in an RX FIFO with room for kRxFifoDepth frames and
+ * frames that arrive while the FIFO is full are lost. The FIFO is drained by
+ * process_rx() which corresponds to the CAN thread. send_message() fails if
+ * all kNumTxMailboxes transmit mailboxes are occupied.
+ */
+class SimCanBus : public CanBusBase {
+public:
+    static constexpr size_t kNumTxMailboxes = 3;
+    static constexpr size_t kRxFifoDepth = 3;
+    static constexpr size_t kMaxSubscriptions = 28;
+
+    struct Stats {
+        uint32_t n_rx_accepted = 0; // Frames that passed a filter and were queued
+        uint32_t n_rx_filtered = 0; // Frames that didn't match any filter
+        uint32_t n_rx_overrun = 0; // Frames that were lost because the RX FIFO was full
+        uint32_t n_dispatched = 0; // Frames handed to a subscription callback
+        uint32_t n_tx = 0; // Frames taken from the TX mailboxes by the bus
+        uint32_t n_tx_refused = 0; // send_message() calls that failed because all mailboxes were full
+    };
+
+    bool send_message(const can_Message_t& message) override;
+    bool subscribe(const MsgIdFilterSpecs& filter, on_can_message_cb_t callback, void* ctx, CanSubscription** handle) final;
+    bool unsubscribe(CanSubscription* handle) final;
+
+    /**
+     * @brief Puts a frame from the bus into the RX FIFO.
+     * @returns false if the frame was filtered out or lost.
+     */
+    bool receive(const can_Message_t& msg);
+
+    /**
+     * @brief Dispatches all frames in the RX FIFO to their subscriptions.
+     * @returns the number of dispatched frames.
+     */
+    size_t process_rx();
+
+    size_t rx_fill_level() const { return rx_fill_level_; }
+
+    /**
+     * @brief Returns the pending TX frame with the highest priority (lowest
+     * ID), i.e. the one that the node would put on the bus next.
+     */
+    const can_Message_t* peek_tx() const;
+
+    /**
+     * @brief Removes the frame returned by peek_tx() from its mailbox.
+     */
+    bool pop_tx(can_Message_t* msg);
+
+    Stats stats_;
+
+private:
+    struct SimCanSubscription : CanSubscription {
+        bool in_use = false;
+        MsgIdFilterSpecs filter;
+        on_can_message_cb_t callback;
+        void* ctx;
+    };
+
+    struct RxFifoEntry {
+        can_Message_t msg;
+        SimCanSubscription* subscription;
+    };
+
+    static bool matches(const MsgIdFilterSpecs& filter, const can_Message_t& msg);
+
+    std::array<SimCanSubscription, kMaxSubscriptions> subscriptions_;
+    RxFifoEntry rx_fifo_[kRxFifoDepth];
+    size_t rx_read_idx_ = 0;
+    size_t rx_fill_level_ = 0;
+    can_Message_t tx_mailboxes_[kNumTxMailboxes];
+    bool tx_mailbox_used_[kNumTxMailboxes] = {};
+};
+
+#ifdef __linux__
+
+/**
+ * @brief SimCanBus that is connected to a Linux SocketCAN interface such as
+ * vcan0 instead of an in-memory bus.
+ *
+ * Frames that the node sends are written to the socket right away. Frames
+ * from the socket are picked up by poll().
+ */
+class SocketCanBus : public SimCanBus {
+public:
+    ~SocketCanBus();
+
+    bool open(const char* interface_name);
+    bool send_message(const can_Message_t& message) final;
+
+    /**
+     * @brief Reads all frames that are available on the socket within
+     * timeout_ms and dispatches them.
+     * @returns false if the socket failed.
+     */
+    bool poll(int timeout_ms);
+
+private:
+    int socket_ = -1;
+};
+
+#endif
+
+#endif // __SIM_CAN_HPP
@@ -0,0 +1,87 @@
+/*
+* @brief Host test for the lock-in spin
+*
+* Runs Axis::run_lockin_spin() on a simulated motor after the control loop
+* has been running for a while and checks that the open-loop controller
+* ramps up the current and velocity from the very first control loop
+* iteration instead of stepping to the target values.
+*
+* Usage: sim_lockin.exe
+*
+* The program exits with a non-zero status if a ramp is violated.
+*/
+
+#include <odrive_main.h>
+#include "sim_plant.hpp"
+
+#include <stdio.h>
+
+void sim_control_loop_irq(SimPlant plants[AXIS_COUNT]);
+
+int main() {
+    SimPlant plants[AXIS_COUNT] = {
+        {&htim1, &htim3},
+        {&htim8, &htim4},
+    };
+
+    Axis& axis = axes[0];
+    SimPlant& plant = plants[0];
+    axis.motor_.config_.pole_pairs = plant.config_.pole_pairs;
+    axis.motor_.config_.phase_resistance = plant.config_.phase_resistance;
+    axis.motor_.config_.phase_inductance = plant.config_.phase_inductance;
+    axis.motor_.config_.torque_constant = plant.config_.torque_constant;
+    axis.motor_.config_.pre_calibrated = true;
+    for (auto& ax: axes) {
+        ax.motor_.apply_config();
+        ax.motor_.motor_thermistor_.apply_config();
+        ax.apply_config();
+        ax.motor_.setup();
+    }
+    odrv.setup_component_graph();
+
+    // Let the open-loop controller sit idle for a while so that its last
+    // update lies far in the past.
+    for (uint32_t i = 0; i < 2 * current_meas_hz; ++i) {
+        sim_control_loop_irq(plants);
+    }
+
+    Axis::LockinConfig_t lockin_config;
+    float max_current_step = lockin_config.current / lockin_config.ramp_time * current_meas_period;
+    float max_vel_step = lockin_config.accel * current_meas_period;
+    uint32_t n_iterations = 0;
+    float prev_Id = 0.0f;
+    float prev_vel = 0.0f;
+    bool ok = true;
+
+    // Normally done by the state machine before running a state
+    axis.requested_state_ = Axis::AXIS_STATE_UNDEFINED;
+
+    // The simulated osSignalWait() doesn't block so the control loop is
+    // driven from the loop callback of the lock-in spin.
+    axis.run_lockin_spin(lockin_config, false, [&](bool reached_target_vel) {
+        sim_control_loop_irq(plants);
+
+        float Id = axis.open_loop_controller_.Idq_setpoint_.any()->first;
+        float vel = axis.open_loop_controller_.phase_vel_.any().value_or(0.0f);
+        if (std::abs(Id - prev_Id) > max_current_step * 1.01f
+                || std::abs(vel - prev_vel) > max_vel_step * 1.01f) {
+            fprintf(stderr, "iteration %lu: Id %.4f => %.4f A (max step %.4f A), phase_vel %.4f => %.4f rad/s (max step %.4f rad/s)\n",
+                (unsigned long)n_iterations, prev_Id, Id, max_current_step, prev_vel, vel, max_vel_step);
+            ok = false;
+        }
+        prev_Id = Id;
+        prev_vel = vel;
+
+        return ok && ++n_iterations < current_meas_hz / 10;
+    });
+
+    if (axis.error_ || axis.motor_.error_) {
+        fprintf(stderr, "axis0: error 0x%x, motor error 0x%llx\n",
+            (unsigned)axis.error_, (unsigned long long)axis.motor_.error_);
+        ok = false;
+    }
+
+    printf("%lu iterations, Id = %.3f A, phase_vel = %.3f rad/s\n",
+        (unsigned long)n_iterations, prev_Id, prev_vel);
+    return ok ? 0 : 1;
+}
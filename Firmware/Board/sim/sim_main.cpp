@@ -0,0 +1,219 @@
+/*
+* @brief Host benchmark for the control loop
+*
+* Runs ODrive::control_loop_cb() and the surrounding current measurement and
+* PWM update callbacks against two simulated motors (see sim_plant.hpp) and
+* reports the per-task execution times as measured by the TaskTimers that are
+* also exposed on the protocol as `task_times`.
+*
+* Usage: simulator.exe [--iterations N] [--budget-ns NS] [--run-sensorless]
+*
+* If a budget is given the program exits with a non-zero status if the mean
+* time per control loop iteration exceeds the budget. The program also fails
+* if any axis reports an error.
+*
+* With --run-sensorless the sensorless estimators run alongside the encoders
+* (the axes are still controlled based on the encoders). This is useful to
+* measure the sensorless estimator, e.g. with and without BATCHED_AXES.
+*/
+
+#include <odrive_main.h>
+#include "sim_plant.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+void sim_control_loop_irq(SimPlant plants[AXIS_COUNT]);
+
+struct TimerStats {
+    std::string name;
+    TaskTimer* timer;
+    uint64_t sum = 0;
+    uint32_t min = UINT32_MAX;
+    uint32_t max = 0;
+
+    void sample() {
+        sum += timer->length_;
+        min = std::min(min, timer->length_);
+        max = std::max(max, timer->length_);
+    }
+};
+
+static float clocks_to_ns(float clocks) {
+    return clocks * (1e9f / (float)TIM_1_8_CLOCK_HZ);
+}
+
+static void setup_axis(Axis& axis, const SimPlant& plant) {
+    axis.motor_.config_.pole_pairs = plant.config_.pole_pairs;
+    axis.motor_.config_.phase_resistance = plant.config_.phase_resistance;
+    axis.motor_.config_.phase_inductance = plant.config_.phase_inductance;
+    axis.motor_.config_.torque_constant = plant.config_.torque_constant;
+    axis.motor_.config_.pre_calibrated = true;
+
+    axis.encoder_.config_.mode = Encoder::MODE_INCREMENTAL;
+    axis.encoder_.config_.cpr = plant.config_.cpr;
+    axis.encoder_.config_.direction = 1;
+    axis.encoder_.config_.pre_calibrated = true;
+
+    axis.controller_.config_.control_mode = Controller::CONTROL_MODE_VELOCITY_CONTROL;
+    axis.controller_.config_.input_mode = Controller::INPUT_MODE_VEL_RAMP;
+    axis.controller_.config_.vel_ramp_rate = 20.0f;
+    axis.controller_.config_.vel_limit = 20.0f;
+    axis.controller_.config_.load_encoder_axis = axis.axis_num_;
+
+    axis.encoder_.apply_config(axis.motor_.config_.motor_type);
+    axis.controller_.apply_config();
+    axis.min_endstop_.apply_config();
+    axis.max_endstop_.apply_config();
+    axis.motor_.apply_config();
+    axis.motor_.motor_thermistor_.apply_config();
+    axis.apply_config();
+
+    axis.motor_.setup();
+    axis.encoder_.setup();
+
+    // The plant's encoder is perfectly aligned with the rotor (phase_offset = 0)
+    // so we skip the offset calibration.
+    axis.encoder_.is_ready_ = true;
+    axis.acim_estimator_.idq_src_.connect_to(&axis.motor_.Idq_setpoint_);
+}
+
+int main(int argc, const char** argv) {
+    uint32_t n_iterations = 8 * current_meas_hz; // 8 seconds
+    float budget_ns = 0.0f;
+    bool run_sensorless = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--iterations") && i + 1 < argc) {
+            n_iterations = strtoul(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--budget-ns") && i + 1 < argc) {
+            budget_ns = strtof(argv[++i], nullptr);
+        } else if (!strcmp(argv[i], "--run-sensorless")) {
+            run_sensorless = true;
+        } else {
+            fprintf(stderr, "usage: %s [--iterations N] [--budget-ns NS] [--run-sensorless]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    SimPlant plants[AXIS_COUNT] = {
+        {&htim1, &htim3},
+        {&htim8, &htim4},
+    };
+
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        setup_axis(axes[i], plants[i]);
+    }
+    odrv.setup_component_graph();
+
+    // Let the DC calibration of the current sensors converge and the encoder
+    // estimates become valid.
+    for (uint32_t i = 0; i < 2 * current_meas_hz; ++i) {
+        sim_control_loop_irq(plants);
+    }
+
+    for (auto& axis: axes) {
+        if (!axis.start_closed_loop_control()) {
+            fprintf(stderr, "axis%d: failed to enter closed loop control\n", axis.axis_num_);
+            return 1;
+        }
+    }
+    for (auto& axis: axes) {
+        // Only keeps the estimator alive, the mode is evaluated when entering
+        // closed loop control.
+        axis.config_.enable_sensorless_mode = run_sensorless;
+        axis.sensorless_estimator_.config_.pm_flux_linkage = plants[axis.axis_num_].config_.torque_constant / (1.5f * plants[axis.axis_num_].config_.pole_pairs);
+    }
+    axes[0].controller_.input_vel_ = 10.0f;
+    axes[1].controller_.input_vel_ = -5.0f;
+
+    std::vector<TimerStats> stats = {
+        {"sampling", &odrv.task_times_.sampling},
+        {"control_loop_misc", &odrv.task_times_.control_loop_misc},
+        {"control_loop_checks", &odrv.task_times_.control_loop_checks},
+    };
+    for (auto& axis: axes) {
+        Axis::TaskTimes& t = axis.task_times_;
+        std::pair<const char*, TaskTimer*> timers[] = {
+            {"thermistor_update", &t.thermistor_update},
+            {"encoder_update", &t.encoder_update},
+            {"sensorless_estimator_update", &t.sensorless_estimator_update},
+            {"endstop_update", &t.endstop_update},
+            {"controller_update", &t.controller_update},
+            {"open_loop_controller_update", &t.open_loop_controller_update},
+            {"acim_estimator_update", &t.acim_estimator_update},
+            {"motor_update", &t.motor_update},
+            {"current_controller_update", &t.current_controller_update},
+            {"dc_calib", &t.dc_calib},
+            {"current_sense", &t.current_sense},
+            {"pwm_update", &t.pwm_update},
+        };
+        for (auto& timer: timers) {
+            stats.push_back({"axis" + std::to_string(axis.axis_num_) + "." + timer.first, timer.second});
+        }
+    }
+
+    TimerStats total{"total", nullptr};
+    TaskTimer total_timer;
+    total.timer = &total_timer;
+
+    for (uint32_t i = 0; i < n_iterations; ++i) {
+        odrv.task_timers_armed_ = true;
+        sim_control_loop_irq(plants);
+
+        uint32_t sum = 0;
+        for (auto& s: stats) {
+            s.sample();
+            sum += s.timer->length_;
+        }
+        total_timer.length_ = sum;
+        total.sample();
+    }
+
+    printf("%-40s %10s %10s %10s\n", "task", "mean [ns]", "max [ns]", "jitter [ns]");
+    for (auto& s: stats) {
+        printf("%-40s %10.1f %10.1f %10.1f\n", s.name.c_str(),
+            clocks_to_ns((float)s.sum / (float)n_iterations),
+            clocks_to_ns((float)s.max), clocks_to_ns((float)(s.max - s.min)));
+    }
+    float mean_total_ns = clocks_to_ns((float)total.sum / (float)n_iterations);
+    printf("%-40s %10.1f %10.1f %10.1f\n", total.name.c_str(), mean_total_ns,
+        clocks_to_ns((float)total.max), clocks_to_ns((float)(total.max - total.min)));
+
+    const DeadlineMonitor& monitor = odrv.deadline_monitor_;
+    printf("deadline monitor: %lu overruns of %.1fns budget, histogram:", (unsigned long)monitor.overrun_count_,
+        clocks_to_ns((float)monitor.budget_));
+    for (uint32_t count: monitor.histogram_) {
+        printf(" %lu", (unsigned long)count);
+    }
+    printf("\n");
+
+    bool ok = true;
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        Axis& axis = axes[i];
+        printf("axis%zu: vel_estimate = %.2f turn/s (plant: %.2f turn/s)\n", i,
+            axis.encoder_.vel_estimate_.any().value_or(NAN), plants[i].vel_ / (2.0f * M_PI));
+        if (run_sensorless) {
+            printf("axis%zu: sensorless vel_estimate = %.2f turn/s\n", i,
+                axis.sensorless_estimator_.vel_estimate_.any().value_or(NAN));
+        }
+        if (!axis.motor_.is_armed_ || axis.error_ || axis.motor_.error_
+                || axis.encoder_.error_ || axis.controller_.error_
+                || axis.sensorless_estimator_.error_) {
+            fprintf(stderr, "axis%zu: error 0x%x, motor error 0x%llx, encoder error 0x%x, controller error 0x%x\n", i,
+                (unsigned)axis.error_, (unsigned long long)axis.motor_.error_,
+                (unsigned)axis.encoder_.error_, (unsigned)axis.controller_.error_);
+            ok = false;
+        }
+    }
+
+    if (budget_ns > 0.0f && mean_total_ns > budget_ns) {
+        fprintf(stderr, "mean control loop time %.1fns exceeds budget of %.1fns\n", mean_total_ns, budget_ns);
+        ok = false;
+    }
+
+    return ok ? 0 : 1;
+}
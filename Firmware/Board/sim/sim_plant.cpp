@@ -0,0 +1,80 @@
+
+#include "sim_plant.hpp"
+
+#include <low_level.h>
+#include <cmath>
+
+void SimPlant::step(float dt) {
+    TIM_TypeDef* tim = pwm_timer_->Instance;
+
+    // The Automatic Output Enable bit sets the Main Output Enable bit at the
+    // next update event.
+    if (tim->BDTR & TIM_BDTR_AOE) {
+        tim->BDTR |= TIM_BDTR_MOE;
+    }
+    outputs_enabled_ = tim->BDTR & TIM_BDTR_MOE;
+
+    // The timers run in center aligned PWM mode 2, i.e. the high side switch
+    // conducts while the counter is above the compare value.
+    float vA = (1.0f - (float)tim->CCR1 / (float)TIM_1_8_PERIOD_CLOCKS) * vbus_voltage;
+    float vB = (1.0f - (float)tim->CCR2 / (float)TIM_1_8_PERIOD_CLOCKS) * vbus_voltage;
+    float vC = (1.0f - (float)tim->CCR3 / (float)TIM_1_8_PERIOD_CLOCKS) * vbus_voltage;
+    float v_alpha = (2.0f / 3.0f) * (vA - 0.5f * vB - 0.5f * vC);
+    float v_beta = one_by_sqrt3 * (vB - vC);
+
+    // Flux linkage of the permanent magnet
+    const float psi = config_.torque_constant / (1.5f * (float)config_.pole_pairs);
+    const float L = config_.phase_inductance;
+    const float R = config_.phase_resistance;
+    const float h = dt / (float)config_.substeps;
+
+    for (uint32_t i = 0; i < config_.substeps; ++i) {
+        float phase = (float)config_.pole_pairs * pos_;
+        float omega = (float)config_.pole_pairs * vel_;
+        float c = std::cos(phase);
+        float s = std::sin(phase);
+        float vd = c * v_alpha + s * v_beta;
+        float vq = c * v_beta - s * v_alpha;
+
+        if (outputs_enabled_) {
+            // Exact discretization of the RL dynamics for a constant input
+            // over one substep keeps this stable for small inductances.
+            float decay = std::exp(-R / L * h);
+            float Id_ss = (vd + omega * L * Iq_) / R;
+            float Iq_ss = (vq - omega * L * Id_ - omega * psi) / R;
+            Id_ = Id_ss + (Id_ - Id_ss) * decay;
+            Iq_ = Iq_ss + (Iq_ - Iq_ss) * decay;
+        } else {
+            // All phases are floating
+            Id_ = 0.0f;
+            Iq_ = 0.0f;
+        }
+
+        float torque = 1.5f * (float)config_.pole_pairs * psi * Iq_;
+        float accel = (torque - config_.viscous_friction * vel_ - config_.load_torque) / config_.inertia;
+        vel_ += accel * h;
+        pos_ += vel_ * h;
+    }
+}
+
+void SimPlant::sample_encoder() {
+    float counts = pos_ / (2.0f * M_PI) * (float)config_.cpr;
+    encoder_timer_->Instance->CNT = (uint32_t)(int32_t)std::floor(counts) & 0xffff;
+}
+
+std::optional<Iph_ABC_t> SimPlant::get_current() {
+    if (!outputs_enabled_) {
+        // Mirrors the behavior of ControlLoop_IRQHandler on ODrive v3
+        return Iph_ABC_t{0.0f, 0.0f, 0.0f};
+    }
+    float phase = (float)config_.pole_pairs * pos_;
+    float c = std::cos(phase);
+    float s = std::sin(phase);
+    float I_alpha = c * Id_ - s * Iq_;
+    float I_beta = s * Id_ + c * Iq_;
+    return Iph_ABC_t{
+        I_alpha,
+        -0.5f * I_alpha + sqrt3_by_2 * I_beta,
+        -0.5f * I_alpha - sqrt3_by_2 * I_beta
+    };
+}
@@ -0,0 +1,50 @@
+#ifndef __SIM_PLANT_HPP
+#define __SIM_PLANT_HPP
+
+#include <board.h>
+#include <optional>
+
+/**
+ * @brief Synthetic permanent magnet synchronous motor with an incremental
+ * encoder attached to its shaft.
+ *
+ * The plant reads the phase voltages from the PWM compare registers of the
+ * motor's timer and writes the encoder count into the encoder timer's counter
+ * register, i.e. it sits on the other side of the same registers that the
+ * real hardware would.
+ */
+class SimPlant {
+public:
+    struct Config_t {
+        float phase_resistance = 0.05f; // [Ohm]
+        float phase_inductance = 20e-6f; // [H]
+        float torque_constant = 0.04f; // [Nm/A]
+        uint32_t pole_pairs = 7;
+        float inertia = 1e-4f; // [kg m^2]
+        float viscous_friction = 1e-4f; // [Nm/(rad/s)]
+        float load_torque = 0.0f; // [Nm]
+        int32_t cpr = 8192;
+        uint32_t substeps = 16; // number of integration steps per call to step()
+    };
+
+    SimPlant(TIM_HandleTypeDef* pwm_timer, TIM_HandleTypeDef* encoder_timer)
+        : pwm_timer_(pwm_timer), encoder_timer_(encoder_timer) {}
+
+    void step(float dt);
+    void sample_encoder();
+    std::optional<Iph_ABC_t> get_current();
+
+    Config_t config_;
+
+    float pos_ = 0.0f; // mechanical position [rad]
+    float vel_ = 0.0f; // mechanical velocity [rad/s]
+    float Id_ = 0.0f; // [A]
+    float Iq_ = 0.0f; // [A]
+
+private:
+    TIM_HandleTypeDef* pwm_timer_;
+    TIM_HandleTypeDef* encoder_timer_;
+    bool outputs_enabled_ = false;
+};
+
+#endif // __SIM_PLANT_HPP
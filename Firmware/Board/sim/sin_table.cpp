@@ -0,0 +1,17 @@
+/*
+* @brief CMSIS-DSP sine table for the host simulator. On hardware this is part
+* of the precompiled CMSIS-DSP library.
+*/
+
+#include <arm_common_tables.h>
+#include <cmath>
+
+float32_t sinTable_f32[FAST_MATH_TABLE_SIZE + 1];
+
+static struct SinTableInit {
+    SinTableInit() {
+        for (size_t i = 0; i <= FAST_MATH_TABLE_SIZE; ++i) {
+            sinTable_f32[i] = (float32_t)std::sin(2.0 * M_PI * (double)i / (double)FAST_MATH_TABLE_SIZE);
+        }
+    }
+} sin_table_init;
@@ -0,0 +1,277 @@
+/*
+* @brief Host test for the bulk endpoints of fibre's libusb backend
+*
+* Runs LibusbBulkInEndpoint and LibusbBulkOutEndpoint against a scripted
+* libusb (see fake_libusb/libusb.h) in which the test decides when and with
+* which status each submitted transfer completes. Checks that:
+*  - reads return the packets in the order in which they were submitted even
+*    if the transfers complete out of order
+*  - cancelling a read cancels the read-ahead transfers
+*  - writes complete right away while a transfer is free
+*  - cancelling a write that waits for a free transfer completes only that
+*    write and leaves the earlier, already acknowledged transfers alone
+*  - a failed transfer is reported to the next write and the device is
+*    reported as left once no transfer is in flight anymore
+*
+* Usage: test_libusb_endpoint.exe
+*
+* The program exits with a non-zero status if a check fails.
+*/
+
+#include <fibre/../../platform_support/libusb_transport.hpp>
+#include <fibre/fibre.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace fibre;
+
+static size_t n_failed = 0;
+
+#define CHECK(expr) do { \
+        if (!(expr)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr); \
+            n_failed++; \
+        } \
+    } while (0)
+
+/* Scripted libusb -----------------------------------------------------------*/
+
+static std::deque<libusb_transfer*> in_flight; // in submission order
+static std::vector<libusb_transfer*> cancel_requests;
+static size_t n_transfers = 0; // allocated and not freed
+
+libusb_transfer* libusb_alloc_transfer(int iso_packets) {
+    n_transfers++;
+    return new libusb_transfer{};
+}
+
+void libusb_free_transfer(libusb_transfer* transfer) {
+    CHECK(std::find(in_flight.begin(), in_flight.end(), transfer) == in_flight.end());
+    n_transfers--;
+    delete transfer;
+}
+
+int libusb_submit_transfer(libusb_transfer* transfer) {
+    in_flight.push_back(transfer);
+    return LIBUSB_SUCCESS;
+}
+
+int libusb_cancel_transfer(libusb_transfer* transfer) {
+    if (std::find(in_flight.begin(), in_flight.end(), transfer) == in_flight.end()) {
+        return LIBUSB_ERROR_NOT_FOUND;
+    }
+    cancel_requests.push_back(transfer);
+    return LIBUSB_SUCCESS;
+}
+
+const char* libusb_error_name(int error_code) {
+    return "LIBUSB_ERROR";
+}
+
+libusb_device* libusb_get_device(libusb_device_handle* dev_handle) {
+    return nullptr;
+}
+
+ssize_t libusb_get_device_list(libusb_context* ctx, libusb_device*** list) {
+    *list = nullptr;
+    return 0;
+}
+
+void libusb_free_device_list(libusb_device** list, int unref_devices) {}
+
+// The endpoints report a device as left once all its transfers finished
+// after an error.
+static size_t n_devices_left = 0;
+
+uint8_t libusb_get_bus_number(libusb_device* dev) {
+    return 0;
+}
+
+uint8_t libusb_get_device_address(libusb_device* dev) {
+    return 0;
+}
+
+void libusb_unref_device(libusb_device* dev) {
+    n_devices_left++;
+}
+
+// Completes the in-flight transfer with index i (in submission order)
+static void complete(size_t i, libusb_transfer_status status, std::string data = "") {
+    libusb_transfer* transfer = in_flight[i];
+    in_flight.erase(in_flight.begin() + i);
+    transfer->status = status;
+    if (transfer->endpoint & LIBUSB_ENDPOINT_IN) {
+        memcpy(transfer->buffer, data.data(), data.size());
+        transfer->actual_length = (int)data.size();
+    } else {
+        transfer->actual_length = status == LIBUSB_TRANSFER_COMPLETED ? transfer->length : 0;
+    }
+    transfer->callback(transfer);
+}
+
+static void complete_cancel_requests() {
+    std::vector<libusb_transfer*> requests;
+    std::swap(requests, cancel_requests);
+    for (libusb_transfer* transfer: requests) {
+        auto it = std::find(in_flight.begin(), in_flight.end(), transfer);
+        if (it != in_flight.end()) {
+            complete(it - in_flight.begin(), LIBUSB_TRANSFER_CANCELLED);
+        }
+    }
+}
+
+// The discovery part of the backend is not used by this test
+#define UNUSED_STUB(ret, name, ...) ret name(__VA_ARGS__) { abort(); }
+UNUSED_STUB(int, libusb_init, libusb_context**)
+UNUSED_STUB(void, libusb_exit, libusb_context*)
+UNUSED_STUB(int, libusb_has_capability, uint32_t)
+UNUSED_STUB(int, libusb_handle_events, libusb_context*)
+UNUSED_STUB(int, libusb_handle_events_timeout, libusb_context*, timeval*)
+UNUSED_STUB(int, libusb_get_next_timeout, libusb_context*, timeval*)
+UNUSED_STUB(void, libusb_interrupt_event_handler, libusb_context*)
+UNUSED_STUB(const libusb_pollfd**, libusb_get_pollfds, libusb_context*)
+UNUSED_STUB(void, libusb_free_pollfds, const libusb_pollfd**)
+UNUSED_STUB(int, libusb_pollfds_handle_timeouts, libusb_context*)
+UNUSED_STUB(void, libusb_set_pollfd_notifiers, libusb_context*, libusb_pollfd_added_cb, libusb_pollfd_removed_cb, void*)
+UNUSED_STUB(int, libusb_hotplug_register_callback, libusb_context*, int, int, int, int, int, libusb_hotplug_callback_fn, void*, libusb_hotplug_callback_handle*)
+UNUSED_STUB(void, libusb_hotplug_deregister_callback, libusb_context*, libusb_hotplug_callback_handle)
+UNUSED_STUB(libusb_device*, libusb_ref_device, libusb_device*)
+UNUSED_STUB(int, libusb_get_device_descriptor, libusb_device*, libusb_device_descriptor*)
+UNUSED_STUB(int, libusb_get_active_config_descriptor, libusb_device*, libusb_config_descriptor**)
+UNUSED_STUB(void, libusb_free_config_descriptor, libusb_config_descriptor*)
+UNUSED_STUB(int, libusb_open, libusb_device*, libusb_device_handle**)
+UNUSED_STUB(void, libusb_close, libusb_device_handle*)
+UNUSED_STUB(int, libusb_claim_interface, libusb_device_handle*, int)
+UNUSED_STUB(bool, fibre::ChannelDiscoverer::try_parse_key, const char*, const char*, const char*, int*)
+UNUSED_STUB(void, fibre::Domain::add_channels, ChannelDiscoveryResult)
+
+/* Tests ---------------------------------------------------------------------*/
+
+struct Reader {
+    LibusbBulkInEndpoint* ep;
+    uint8_t buf[64];
+    std::vector<std::string> received;
+    std::vector<StreamStatus> results;
+    bool restart = true;
+
+    void start() {
+        ep->start_read(buf, nullptr, MEMBER_CB(this, on_read_finished));
+    }
+
+    void on_read_finished(ReadResult result) {
+        results.push_back(result.status);
+        if (result.status == kStreamOk) {
+            received.push_back(std::string((char*)buf, (char*)result.end));
+            if (restart) {
+                start();
+            }
+        }
+    }
+};
+
+struct Writer {
+    LibusbBulkOutEndpoint* ep;
+    std::vector<StreamStatus> results;
+
+    void write(const char* str) {
+        ep->start_write({(const uint8_t*)str, strlen(str)}, nullptr, MEMBER_CB(this, on_write_finished));
+    }
+
+    void on_write_finished(WriteResult result) {
+        results.push_back(result.status);
+    }
+};
+
+static void test_read(LibusbDiscoverer* discoverer, libusb_device_handle* handle) {
+    LibusbBulkInEndpoint ep;
+    CHECK(ep.init(discoverer, handle, 0x81, 64, 3));
+    Reader reader{&ep};
+
+    reader.start();
+    CHECK(in_flight.size() == 3);
+
+    // The second packet arrives first but is returned second
+    complete(1, LIBUSB_TRANSFER_COMPLETED, "b");
+    CHECK(reader.received.empty());
+    complete(0, LIBUSB_TRANSFER_COMPLETED, "a");
+    CHECK((reader.received == std::vector<std::string>{"a", "b"}));
+    CHECK(in_flight.size() == 3);
+
+    // Cancelling a read cancels the read-ahead
+    ep.cancel_read(0);
+    CHECK(cancel_requests.size() == 3);
+    complete_cancel_requests();
+    CHECK(reader.results.back() == kStreamCancelled);
+    CHECK(in_flight.empty());
+
+    CHECK(ep.deinit());
+}
+
+static void test_write(LibusbDiscoverer* discoverer, libusb_device_handle* handle) {
+    LibusbBulkOutEndpoint ep;
+    CHECK(ep.init(discoverer, handle, 0x01, 64, 3));
+    Writer writer{&ep};
+
+    // Writes complete right away while transfers are free
+    writer.write("1");
+    writer.write("2");
+    writer.write("3");
+    CHECK((writer.results == std::vector<StreamStatus>{kStreamOk, kStreamOk, kStreamOk}));
+    CHECK(in_flight.size() == 3);
+
+    // The fourth write waits for a transfer. Cancelling it must not touch
+    // the acknowledged transfers.
+    writer.write("4");
+    CHECK(writer.results.size() == 3);
+    ep.cancel_write(0);
+    CHECK(writer.results.size() == 4 && writer.results.back() == kStreamCancelled);
+    CHECK(cancel_requests.empty());
+    CHECK(in_flight.size() == 3);
+
+    // The next write goes out once a transfer finished
+    writer.write("5");
+    CHECK(writer.results.size() == 4);
+    complete(0, LIBUSB_TRANSFER_COMPLETED);
+    CHECK(writer.results.size() == 5 && writer.results.back() == kStreamOk);
+    CHECK(in_flight.size() == 3 && in_flight.back()->buffer[0] == '5');
+
+    // A failed transfer is reported to the next write, the other transfers
+    // stay in flight
+    complete(0, LIBUSB_TRANSFER_STALL);
+    CHECK(cancel_requests.empty());
+    CHECK(in_flight.size() == 2);
+    writer.write("6");
+    CHECK(writer.results.size() == 6 && writer.results.back() == kStreamClosed);
+
+    // The device is only reported as left once no transfer is in flight
+    complete(0, LIBUSB_TRANSFER_COMPLETED);
+    CHECK(n_devices_left == 0);
+    complete(0, LIBUSB_TRANSFER_COMPLETED);
+    CHECK(n_devices_left == 1);
+
+    CHECK(ep.deinit());
+}
+
+int main() {
+    LibusbDiscoverer* discoverer = new LibusbDiscoverer(); // not initialized: uses the endpoints' own libusb callbacks
+    libusb_device_handle handle;
+
+    test_read(discoverer, &handle);
+    test_write(discoverer, &handle);
+    CHECK(n_transfers == 0);
+
+    delete discoverer;
+
+    if (n_failed) {
+        fprintf(stderr, "%zu checks failed\n", n_failed);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
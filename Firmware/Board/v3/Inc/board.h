@@ -107,6 +107,10 @@ extern UART_HandleTypeDef* uart_b;
 extern UART_HandleTypeDef* uart_c;
 
 extern PwmInput pwm0_input;
+
+// [HCLK ticks] Advanced by the TIM8 update interrupt at every TIM1/TIM8 update
+// event, i.e. twice per control period.
+extern "C" volatile uint32_t timestamp_;
 #endif
 
 // Period in [s]
@@ -39,6 +39,16 @@
 
 /* USER CODE BEGIN 0 */
 #include <Drivers/STM32/stm32_system.h>
+#include <communication/interface_uart.h>
+
+// The HAL doesn't handle the idle line interrupt, which the UART server uses
+// to pick up received data as soon as the sender pauses.
+static void handle_uart_idle(UART_HandleTypeDef* huart) {
+  if (__HAL_UART_GET_FLAG(huart, UART_FLAG_IDLE) && __HAL_UART_GET_IT_SOURCE(huart, UART_IT_IDLE)) {
+    __HAL_UART_CLEAR_IDLEFLAG(huart);
+    uart_idle_isr(huart);
+  }
+}
 /* USER CODE END 0 */
 
 /* External variables --------------------------------------------------------*/
@@ -359,7 +369,7 @@ void CAN1_SCE_IRQHandler(void)
 void USART2_IRQHandler(void)
 {
   /* USER CODE BEGIN USART2_IRQn 0 */
-
+  handle_uart_idle(&huart2);
   /* USER CODE END USART2_IRQn 0 */
   HAL_UART_IRQHandler(&huart2);
   /* USER CODE BEGIN USART2_IRQn 1 */
@@ -403,6 +413,7 @@ void UART4_IRQHandler(void)
 {
   /* USER CODE BEGIN UART4_IRQn 0 */
   COUNT_IRQ(UART4_IRQn);
+  handle_uart_idle(&huart4);
   /* USER CODE END UART4_IRQn 0 */
   HAL_UART_IRQHandler(&huart4);
   /* USER CODE BEGIN UART4_IRQn 1 */
@@ -0,0 +1,68 @@
+/* ----------------------------------------------------------------------
+ * Title:        arm_sincos_f32.c
+ * Description:  Fast combined sine and cosine calculation for floating-point
+ *               values, derived from arm_sin_f32.c and arm_cos_f32.c
+ * -------------------------------------------------------------------- */
+
+#include <board.h>
+#include "arm_math.h"
+#include "arm_common_tables.h"
+
+/**
+ * @brief  Fast approximation to sin(x) and cos(x) for floating-point data.
+ *
+ * Gives the same results as our_arm_sin_f32() and our_arm_cos_f32() but does
+ * the range reduction and the index calculation only once. The cosine is read
+ * from the same sine table, a quarter period (FAST_MATH_TABLE_SIZE / 4
+ * entries) further ahead.
+ *
+ * @param[in]  x        input value in radians.
+ * @param[out] sin_val  sin(x)
+ * @param[out] cos_val  cos(x)
+ */
+void our_arm_sincos_f32(
+  float32_t x,
+  float32_t * sin_val,
+  float32_t * cos_val)
+{
+  float32_t fract, in;                                   /* Temporary variables for input, output */
+  uint16_t index_s, index_c;                             /* Index variables */
+  int32_t n;
+  float32_t findex;
+
+  /* input x is in radians */
+  /* Scale the input to [0 1] range from [0 2*PI] , divide input by 2*pi */
+  in = x * 0.159154943092f;
+
+  /* Calculation of floor value of input */
+  n = (int32_t) in;
+
+  /* Make negative values towards -infinity */
+  if (x < 0.0f)
+  {
+    n--;
+  }
+
+  /* Map input value to [0 1] */
+  in = in - (float32_t) n;
+
+  /* Calculation of index of the table */
+  findex = (float32_t)FAST_MATH_TABLE_SIZE * in;
+  index_s = (uint16_t)findex;
+
+  /* when "in" is exactly 1, we need to rotate the index down to 0 */
+  if (index_s >= FAST_MATH_TABLE_SIZE) {
+    index_s = 0;
+    findex -= (float32_t)FAST_MATH_TABLE_SIZE;
+  }
+
+  /* fractional value calculation */
+  fract = findex - (float32_t) index_s;
+
+  /* cos(x) = sin(x + pi/2) */
+  index_c = (index_s + FAST_MATH_TABLE_SIZE / 4) & (FAST_MATH_TABLE_SIZE - 1);
+
+  /* Linear interpolation between the two nearest table values */
+  *sin_val = (1.0f-fract)*sinTable_f32[index_s] + fract*sinTable_f32[index_s+1];
+  *cos_val = (1.0f-fract)*sinTable_f32[index_c] + fract*sinTable_f32[index_c+1];
+}
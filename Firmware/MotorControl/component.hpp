@@ -3,7 +3,6 @@
 
 #include <stdint.h>
 #include <optional>
-#include <variant>
 
 class ComponentBase {
 public:
@@ -17,8 +16,70 @@ public:
      * is run.
      */
     virtual void update(uint32_t timestamp) = 0;
+
+    /**
+     * @brief Gets called right before the first update() after the component
+     * was added to the schedule of the ComponentGraph, i.e. when it was not
+     * running before (see ComponentGraph::run()).
+     *
+     * Components that integrate over time should reset their time reference
+     * here since they were possibly skipped for a long time.
+     *
+     * @param timestamp: The timestamp (in HCLK ticks) of the update() call
+     * that follows.
+     */
+    virtual void on_activate(uint32_t timestamp) {}
+};
+
+
+/**
+ * @brief Type independent part of OutputPort<T>.
+ */
+class OutputPortBase {
+public:
+    /**
+     * @brief Marks the contained value as outdated. The value is not actually
+     * deleted and can still be accessed through some of the member functions
+     * of OutputPort<T>.
+     */
+    void reset() {
+        // This will eventually overflow to 0 so present() could
+        // theoretically return a very old value however it is very likely that
+        // the motor will be long disarmed by then.
+        age_++;
+    }
+
+protected:
+    uint32_t age_ = 2; // Age in number of control loop iterations
 };
 
+/**
+ * @brief Type independent part of InputPort<T>.
+ * 
+ * Keeps track of the OutputPort that the input port is connected to (if any)
+ * so that the data flow between components can be inspected without knowing
+ * the value types (see ComponentGraph).
+ */
+class InputPortBase {
+public:
+    /**
+     * @brief Returns the output port to which this input port is connected or
+     * nullptr if it's connected to a plain value or not connected at all.
+     */
+    OutputPortBase* source() const { return source_; }
+
+    // Incremented whenever any input port is connected or disconnected.
+    static inline uint32_t connection_version_ = 0;
+
+protected:
+    void set_source(OutputPortBase* source) {
+        source_ = source;
+        connection_version_++;
+    }
+
+private:
+    OutputPortBase* source_ = nullptr;
+};
 
 template<typename T>
 class InputPort;
@@ -35,7 +96,7 @@ class InputPort;
  * Member functions of this class are not thread-safe unless noted otherwise.
  */
 template<typename T>
-class OutputPort {
+class OutputPort : public OutputPortBase {
 public:
     /**
      * @brief Initializes the output port with the specified value.
@@ -54,18 +115,6 @@ public:
         age_ = 0;
     }
 
-    /**
-     * @brief Marks the contained value as outdated. The value is not actually
-     * deleted and can still be accessed through some of the member functions
-     * of this class.
-     */
-    void reset() {
-        // This will eventually overflow to 0 so present() could
-        // theoretically return a very old value however it is very likely that
-        // the motor will be long disarmed by then.
-        age_++;
-    }
-
     /**
      * @brief Returns the value from this control loop iteration or std::nullopt
      * if the value was not yet set during this control loop iteration.
@@ -104,7 +153,7 @@ public:
     }
     
 private:
-    uint32_t age_ = 2; // Age in number of control loop iterations
+    friend class InputPort<T>;
     T content_;
 };
 
@@ -117,65 +166,74 @@ private:
  *  - an external OutputPort (referenced by a pointer)
  *  - none (all queries will return std::nullopt)
  * 
+ * The source is resolved when it is configured (connect_to() / disconnect())
+ * into a pointer to the value and a pointer to the age of the value. For
+ * sources other than OutputPorts the age pointer refers to a constant that is
+ * always fresh or never fresh. This way present() is only a load and a
+ * compare no matter what kind of source is configured.
+ * 
  * Member functions of this class are not thread-safe unless otherwise noted.
+ * In particular the source must not be changed while the control loop might
+ * be using this port (use a critical section).
  */
 template<typename T>
-class InputPort {
+class InputPort : public InputPortBase {
 public:
+    InputPort() = default;
+
+    InputPort(const InputPort& other) {
+        *this = other;
+    }
+
+    void operator=(const InputPort& other) {
+        InputPortBase::operator=(other);
+        value_ = other.value_;
+        value_ptr_ = (other.value_ptr_ == &other.value_) ? &value_ : other.value_ptr_;
+        age_ptr_ = other.age_ptr_;
+    }
+
     void connect_to(OutputPort<T>* input_port) {
-        content_ = input_port;
+        if (input_port) {
+            value_ptr_ = &input_port->content_;
+            age_ptr_ = &input_port->age_;
+        } else {
+            value_ptr_ = &value_;
+            age_ptr_ = &kAgeNever;
+        }
+        set_source(input_port);
     }
 
     void connect_to(T* input_ptr) {
-        content_ = input_ptr;
+        value_ptr_ = input_ptr ? input_ptr : &value_;
+        age_ptr_ = input_ptr ? &kAgeFresh : &kAgeNever;
+        set_source(nullptr);
     }
 
     void disconnect() {
-        content_ = (OutputPort<T>*)nullptr;
+        value_ptr_ = &value_;
+        age_ptr_ = &kAgeNever;
+        set_source(nullptr);
     }
 
     std::optional<T> present() {
-        if (content_.index() == 2) {
-            OutputPort<T>* ptr = std::get<2>(content_);
-            return ptr ? ptr->present() : std::nullopt;
-        } else if (content_.index() == 1) {
-            T* ptr = std::get<1>(content_);
-            return ptr ? std::make_optional(*ptr) : std::nullopt;
-        } else {
-            return std::get<0>(content_);
-        }
+        return (*age_ptr_ == 0) ? std::make_optional(*value_ptr_) : std::nullopt;
     }
 
     // TODO: probably it makes sense to let the application define that it's
     // ok for this input port to fetch the value from the last iteration.
     // This would provide a general way to resolve same-iteration data path cycles.
 
-    //std::optional<T> previous() {
-    //    if (content_.index() == 2) {
-    //        OutputPort<T>* ptr = std::get<2>(content_);
-    //        return ptr ? ptr->previous() : std::nullopt;
-    //    } else if (content_.index() == 1) {
-    //        T* ptr = std::get<1>(content_);
-    //        return ptr ? std::make_optional(*ptr) : std::nullopt;
-    //    } else {
-    //        return std::get<0>(content_);
-    //    }
-    //}
-
     std::optional<T> any() {
-        if (content_.index() == 2) {
-            OutputPort<T>* ptr = std::get<2>(content_);
-            return ptr ? ptr->any() : std::nullopt;
-        } else if (content_.index() == 1) {
-            T* ptr = std::get<1>(content_);
-            return ptr ? std::make_optional(*ptr) : std::nullopt;
-        } else {
-            return std::get<0>(content_);
-        }
+        return (age_ptr_ != &kAgeNever) ? std::make_optional(*value_ptr_) : std::nullopt;
     }
     
 private:
-    std::variant<T, T*, OutputPort<T>*> content_;
+    static inline const uint32_t kAgeFresh = 0; // age of plain values
+    static inline const uint32_t kAgeNever = UINT32_MAX; // age if no source is configured
+
+    T value_{}; // internally stored value
+    const T* value_ptr_ = &value_;
+    const uint32_t* age_ptr_ = &kAgeFresh;
 };
 
 
@@ -0,0 +1,290 @@
+#ifndef __COMPONENT_GRAPH_HPP
+#define __COMPONENT_GRAPH_HPP
+
+#include "component.hpp"
+
+#include <stddef.h>
+#include <initializer_list>
+
+struct TaskTimer;
+
+/**
+ * @brief Static registry of the components that run in the control loop.
+ *
+ * Every component is registered once together with its input and output
+ * ports. From the current connections of the input ports the graph derives an
+ * update order in which every component runs after the components that it
+ * consumes values from.
+ *
+ * Components are only scheduled if one of their outputs is consumed by another
+ * scheduled component or if they are marked as keep-alive. This way for
+ * instance the sensorless estimator doesn't consume any CPU time while the
+ * axis runs on an encoder.
+ *
+ * The schedule is recomputed lazily in update_schedule() when a port
+ * connection changed (see InputPortBase::connection_version_) or when a
+ * keep-alive condition changed. Port connections of a running control loop
+ * must therefore be changed inside a critical section, otherwise the control
+ * loop could run on a half-updated graph.
+ *
+ * All registered output ports are reset by reset_ports(), regardless of
+ * whether their component is scheduled or not.
+ *
+ * A component that becomes scheduled after it was skipped gets an
+ * on_activate() call before its next update() (see run()).
+ */
+template<size_t kMaxNodes, size_t kMaxPorts>
+class ComponentGraph {
+public:
+    struct Node {
+        ComponentBase* component;
+        TaskTimer* timer; // Timer to measure the update() call with (can be nullptr)
+        size_t keep_alive_begin;
+        size_t keep_alive_end;
+        size_t inputs_begin;
+        size_t inputs_end;
+        size_t outputs_begin;
+        size_t outputs_end;
+        bool active; // Whether this component is part of the current schedule
+        bool keep_alive_planned; // Keep-alive state when the schedule was computed
+        bool activated; // Newly scheduled, on_activate() is due before the next update()
+    };
+
+    // Can be passed as keep_alive for components that must always run, for
+    // instance because their update() has side effects.
+    static constexpr bool kAlways = true;
+
+    /**
+     * @brief Registers a component.
+     *
+     * @param component: The component to register.
+     * @param timer: The task timer that shall measure the update() call of
+     *        this component or nullptr.
+     * @param inputs: All input ports that the component reads from in its
+     *        update() function.
+     * @param outputs: All output ports that the component writes to in its
+     *        update() function.
+     * @param keep_alive: The component is also scheduled while any of these
+     *        flags is true even if none of its outputs are consumed.
+     *
+     * @returns false if the capacity of the graph is exhausted.
+     */
+    bool add(ComponentBase* component, TaskTimer* timer,
+             std::initializer_list<InputPortBase*> inputs,
+             std::initializer_list<OutputPortBase*> outputs,
+             std::initializer_list<const bool*> keep_alive = {}) {
+        if (n_nodes_ >= kMaxNodes
+                || n_inputs_ + inputs.size() > kMaxPorts
+                || n_outputs_ + outputs.size() > kMaxPorts
+                || n_keep_alive_ + keep_alive.size() > kMaxPorts) {
+            return false;
+        }
+
+        Node& node = nodes_[n_nodes_];
+        node.component = component;
+        node.timer = timer;
+        node.keep_alive_begin = n_keep_alive_;
+        for (const bool* flag: keep_alive) {
+            keep_alive_[n_keep_alive_++] = flag;
+        }
+        node.keep_alive_end = n_keep_alive_;
+        node.inputs_begin = n_inputs_;
+        for (InputPortBase* port: inputs) {
+            inputs_[n_inputs_++] = port;
+        }
+        node.inputs_end = n_inputs_;
+        node.outputs_begin = n_outputs_;
+        for (OutputPortBase* port: outputs) {
+            output_owners_[n_outputs_] = n_nodes_;
+            outputs_[n_outputs_++] = port;
+        }
+        node.outputs_end = n_outputs_;
+        node.active = false;
+        node.keep_alive_planned = false;
+        node.activated = false;
+        n_nodes_++;
+
+        is_planned_ = false;
+        return true;
+    }
+
+    /**
+     * @brief Marks the values of all registered output ports as outdated.
+     * Shall be called at the beginning of each control loop iteration.
+     */
+    void reset_ports() {
+        for (size_t i = 0; i < n_outputs_; ++i) {
+            outputs_[i]->reset();
+        }
+    }
+
+    /**
+     * @brief Recomputes the schedule if the port connections or keep-alive
+     * conditions changed since the last call.
+     *
+     * This is cheap if nothing changed so it can be called in every control
+     * loop iteration.
+     *
+     * @returns true if the schedule was recomputed.
+     */
+    bool update_schedule() {
+        bool dirty = !is_planned_ || (planned_version_ != InputPortBase::connection_version_);
+        for (size_t i = 0; i < n_nodes_; ++i) {
+            dirty = dirty || (is_kept_alive(nodes_[i]) != nodes_[i].keep_alive_planned);
+        }
+        if (dirty) {
+            plan();
+        }
+        return dirty;
+    }
+
+    /**
+     * @brief Runs update() of all scheduled components in dependency order.
+     *
+     * Only useful if no task timing is needed. The control loop iterates
+     * over begin()/end() instead.
+     */
+    void update(uint32_t timestamp) {
+        for (Node* node: *this) {
+            run(node, timestamp);
+        }
+    }
+
+    /**
+     * @brief Runs update() of a scheduled component, preceded by on_activate()
+     * if the component was not scheduled during the previous run.
+     */
+    static void run(Node* node, uint32_t timestamp) {
+        if (node->activated) {
+            node->activated = false;
+            node->component->on_activate(timestamp);
+        }
+        node->component->update(timestamp);
+    }
+
+    Node* const* begin() const { return &schedule_[0]; }
+    Node* const* end() const { return &schedule_[schedule_length_]; }
+    size_t size() const { return schedule_length_; }
+
+private:
+    static constexpr size_t kNone = SIZE_MAX;
+
+    bool is_kept_alive(const Node& node) const {
+        for (size_t i = node.keep_alive_begin; i < node.keep_alive_end; ++i) {
+            if (*keep_alive_[i]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Returns the index of the node that owns the output port to which the
+    // specified input port is connected or kNone.
+    size_t producer_of(const InputPortBase* input) const {
+        OutputPortBase* source = input->source();
+        if (!source) {
+            return kNone;
+        }
+        for (size_t i = 0; i < n_outputs_; ++i) {
+            if (outputs_[i] == source) {
+                return output_owners_[i];
+            }
+        }
+        return kNone; // connected to a port outside of the graph
+    }
+
+    void plan() {
+        planned_version_ = InputPortBase::connection_version_;
+        is_planned_ = true;
+
+        // Start with the keep-alive components and then activate everything
+        // they (transitively) consume values from.
+        bool was_active[kMaxNodes];
+        for (size_t i = 0; i < n_nodes_; ++i) {
+            was_active[i] = nodes_[i].active && !nodes_[i].activated;
+            nodes_[i].keep_alive_planned = is_kept_alive(nodes_[i]);
+            nodes_[i].active = nodes_[i].keep_alive_planned;
+        }
+
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (size_t i = 0; i < n_nodes_; ++i) {
+                if (!nodes_[i].active) {
+                    continue;
+                }
+                for (size_t j = nodes_[i].inputs_begin; j < nodes_[i].inputs_end; ++j) {
+                    size_t producer = producer_of(inputs_[j]);
+                    if (producer != kNone && !nodes_[producer].active) {
+                        nodes_[producer].active = true;
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        size_t n_active = 0;
+        for (size_t i = 0; i < n_nodes_; ++i) {
+            nodes_[i].activated = nodes_[i].active && !was_active[i];
+            n_active += nodes_[i].active ? 1 : 0;
+        }
+
+        // Topological sort. Among the components that are ready the one that
+        // was registered first goes first so that the order is deterministic.
+        // Self-loops (a component consuming its own output from the previous
+        // iteration) are ignored.
+        bool scheduled[kMaxNodes] = {};
+        schedule_length_ = 0;
+        while (schedule_length_ < n_active) {
+            size_t next = kNone;
+            size_t first_unscheduled = kNone;
+
+            for (size_t i = 0; i < n_nodes_ && next == kNone; ++i) {
+                if (!nodes_[i].active || scheduled[i]) {
+                    continue;
+                }
+                if (first_unscheduled == kNone) {
+                    first_unscheduled = i;
+                }
+
+                bool ready = true;
+                for (size_t j = nodes_[i].inputs_begin; j < nodes_[i].inputs_end; ++j) {
+                    size_t producer = producer_of(inputs_[j]);
+                    if (producer != kNone && producer != i && !scheduled[producer]) {
+                        ready = false;
+                        break;
+                    }
+                }
+                if (ready) {
+                    next = i;
+                }
+            }
+
+            // A cycle between several components can't be resolved. Break it
+            // at the component that was registered first.
+            if (next == kNone) {
+                next = first_unscheduled;
+            }
+
+            scheduled[next] = true;
+            schedule_[schedule_length_++] = &nodes_[next];
+        }
+    }
+
+    Node nodes_[kMaxNodes];
+    size_t n_nodes_ = 0;
+    InputPortBase* inputs_[kMaxPorts];
+    size_t n_inputs_ = 0;
+    OutputPortBase* outputs_[kMaxPorts];
+    size_t output_owners_[kMaxPorts];
+    size_t n_outputs_ = 0;
+    const bool* keep_alive_[kMaxPorts];
+    size_t n_keep_alive_ = 0;
+
+    Node* schedule_[kMaxNodes];
+    size_t schedule_length_ = 0;
+    uint32_t planned_version_ = 0;
+    bool is_planned_ = false;
+};
+
+#endif // __COMPONENT_GRAPH_HPP
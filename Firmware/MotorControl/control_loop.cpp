@@ -0,0 +1,265 @@
+#include "odrive_main.h"
+
+// This file contains the real-time entry points of the ODrive object, i.e.
+// everything that runs in the sampling and control loop interrupts. They are
+// kept separate from main.cpp so that they can be linked into the host
+// simulator (see Board/sim) without dragging in the RTOS startup code.
+
+bool ODrive::any_error() {
+    return error_ != ODrive::ERROR_NONE
+        || std::any_of(axes.begin(), axes.end(), [](Axis& axis){
+            return axis.error_ != Axis::ERROR_NONE
+                || axis.motor_.error_ != Motor::ERROR_NONE
+                || axis.sensorless_estimator_.error_ != SensorlessEstimator::ERROR_NONE
+                || axis.encoder_.error_ != Encoder::ERROR_NONE
+                || axis.controller_.error_ != Controller::ERROR_NONE;
+        });
+}
+
+void ODrive::clear_errors() {
+    for (auto& axis: axes) {
+        axis.motor_.error_ = Motor::ERROR_NONE;
+        axis.controller_.error_ = Controller::ERROR_NONE;
+        axis.sensorless_estimator_.error_ = SensorlessEstimator::ERROR_NONE;
+        axis.encoder_.error_ = Encoder::ERROR_NONE;
+        axis.encoder_.spi_error_rate_ = 0.0f;
+        axis.error_ = Axis::ERROR_NONE;
+    }
+    error_ = ERROR_NONE;
+    if (odrv.config_.enable_brake_resistor) {
+        safety_critical_arm_brake_resistor();
+    }
+}
+
+/**
+ * @brief Runs system-level checks that need to be as real-time as possible.
+ * 
+ * This function is called after every current measurement of every motor.
+ * It should finish as quickly as possible.
+ */
+void ODrive::do_fast_checks() {
+    if (!(vbus_voltage >= config_.dc_bus_undervoltage_trip_level))
+        disarm_with_error(ERROR_DC_BUS_UNDER_VOLTAGE);
+    if (!(vbus_voltage <= config_.dc_bus_overvoltage_trip_level))
+        disarm_with_error(ERROR_DC_BUS_OVER_VOLTAGE);
+}
+
+/**
+ * @brief Floats all power phases on the system (all motors and brake resistors).
+ *
+ * This should be called if a system level exception ocurred that makes it
+ * unsafe to run power through the system in general.
+ */
+void ODrive::disarm_with_error(Error error) {
+    CRITICAL_SECTION() {
+        for (auto& axis: axes) {
+            axis.motor_.disarm_with_error(Motor::ERROR_SYSTEM_LEVEL);
+        }
+        safety_critical_disarm_brake_resistor();
+        error_ |= error;
+    }
+}
+
+/**
+ * @brief Registers the data flow components of all axes with the component
+ * graph that is run by control_loop_cb().
+ * 
+ * Must be called once before the control loop is started. The update order
+ * is derived from the port connections which are set up later by the axis
+ * state machine (e.g. Axis::start_closed_loop_control()).
+ */
+void ODrive::setup_component_graph() {
+    // Encoders are always updated because they need to keep track of the
+    // position even when the estimates are not used.
+    for (auto& axis: axes) {
+        Encoder& enc = axis.encoder_;
+        component_graph_.add(&enc, &axis.task_times_.encoder_update,
+            {},
+            {&enc.phase_, &enc.phase_vel_, &enc.pos_estimate_, &enc.vel_estimate_, &enc.pos_circular_},
+            {&component_graph_.kAlways});
+    }
+
+    // The sensorless estimator needs to converge during the lock-in spin
+    // before its estimates are consumed so it runs as long as it's enabled.
+#ifdef BATCHED_AXES
+    // All sensorless estimators run in one pass. The execution time is
+    // reported on axis0.
+    static_assert(AXIS_COUNT == 2, "BATCHED_AXES is only implemented for two axes");
+    static SensorlessEstimatorBatch sensorless_estimator_batch;
+    SensorlessEstimator& sensorless0 = axes[0].sensorless_estimator_;
+    SensorlessEstimator& sensorless1 = axes[1].sensorless_estimator_;
+    sensorless_estimator_batch.estimators_[0] = &sensorless0;
+    sensorless_estimator_batch.estimators_[1] = &sensorless1;
+    component_graph_.add(&sensorless_estimator_batch, &axes[0].task_times_.sensorless_estimator_update,
+        {},
+        {&sensorless0.phase_, &sensorless0.phase_vel_, &sensorless0.vel_estimate_,
+         &sensorless1.phase_, &sensorless1.phase_vel_, &sensorless1.vel_estimate_},
+        {&axes[0].config_.enable_sensorless_mode, &axes[1].config_.enable_sensorless_mode});
+#endif
+
+    for (auto& axis: axes) {
+#ifndef BATCHED_AXES
+        SensorlessEstimator& sensorless = axis.sensorless_estimator_;
+        component_graph_.add(&sensorless, &axis.task_times_.sensorless_estimator_update,
+            {},
+            {&sensorless.phase_, &sensorless.phase_vel_, &sensorless.vel_estimate_},
+            {&axis.config_.enable_sensorless_mode});
+#endif
+
+        Controller& ctrl = axis.controller_;
+        component_graph_.add(&ctrl, &axis.task_times_.controller_update,
+            {&ctrl.pos_estimate_linear_src_, &ctrl.pos_estimate_circular_src_, &ctrl.vel_estimate_src_, &ctrl.pos_wrap_src_},
+            {&ctrl.torque_output_});
+
+        OpenLoopController& open_loop = axis.open_loop_controller_;
+        component_graph_.add(&open_loop, &axis.task_times_.open_loop_controller_update,
+            {},
+            {&open_loop.Idq_setpoint_, &open_loop.Vdq_setpoint_, &open_loop.phase_, &open_loop.phase_vel_, &open_loop.total_distance_});
+
+        // The ACIM estimator is updated from within Motor::update() so its
+        // ports are accounted to the motor.
+        Motor& motor = axis.motor_;
+        AcimEstimator& acim = axis.acim_estimator_;
+        component_graph_.add(&motor, &axis.task_times_.motor_update,
+            {&motor.torque_setpoint_src_, &motor.phase_vel_src_, &acim.rotor_phase_src_, &acim.rotor_phase_vel_src_, &acim.idq_src_},
+            {&motor.Vdq_setpoint_, &motor.Idq_setpoint_, &acim.slip_vel_, &acim.stator_phase_vel_, &acim.stator_phase_});
+
+        // The current controller is the sink of the data flow. It
+        // uses the output of controller_ or open_loop_contoller_ and encoder_
+        // or sensorless_estimator_ or acim_estimator_.
+        FieldOrientedController& foc = motor.current_control_;
+        component_graph_.add(&foc, &axis.task_times_.current_controller_update,
+            {&foc.Idq_setpoint_src_, &foc.Vdq_setpoint_src_, &foc.phase_src_, &foc.phase_vel_src_},
+            {},
+            {&component_graph_.kAlways});
+    }
+}
+
+/**
+ * @brief Runs the periodic sampling tasks
+ * 
+ * All components that need to sample real-world data should do it in this
+ * function as it runs on a high interrupt priority and provides lowest possible
+ * timing jitter.
+ * 
+ * All function called from this function should adhere to the following rules:
+ *  - Try to use the same number of CPU cycles in every iteration.
+ *    (reason: Tasks that run later in the function still want lowest possible timing jitter)
+ *  - Use as few cycles as possible.
+ *    (reason: The interrupt blocks other important interrupts (TODO: which ones?))
+ *  - Not call any FreeRTOS functions.
+ *    (reason: The interrupt priority is higher than the max allowed priority for syscalls)
+ * 
+ * Time consuming and undeterministic logic/arithmetic should live on
+ * control_loop_cb() instead.
+ */
+void ODrive::sampling_cb() {
+    n_evt_sampling_++;
+
+    MEASURE_TIME(task_times_.sampling) {
+        for (auto& axis: axes) {
+            axis.encoder_.sample_now();
+        }
+    }
+}
+
+/**
+ * @brief Runs the periodic control loop.
+ * 
+ * This function is executed in a low priority interrupt context and is allowed
+ * to call CMSIS functions.
+ * 
+ * Yet it runs at a higher priority than communication workloads.
+ * 
+ * @param update_cnt: The true count of update events (wrapping around at 16
+ *        bits). This is used for timestamp calculation in the face of
+ *        potentially missed timer update interrupts. Therefore this counter
+ *        must not rely on any interrupts.
+ */
+void ODrive::control_loop_cb(uint32_t timestamp) {
+    last_update_timestamp_ = timestamp;
+    n_evt_control_loop_++;
+
+    // If the previous iteration missed its deadline we skip work that is not
+    // critical for motor control to get back on track.
+    bool shed = deadline_monitor_.shedding_;
+    if (shed) {
+        deadline_monitor_.shed_count_++;
+    }
+
+    MEASURE_TIME(task_times_.control_loop_misc) {
+        // Reset all output ports so that we are certain about the freshness of
+        // all values that we use.
+        // TODO: maybe we should add a check to output ports that prevents
+        // double-setting the value.
+        component_graph_.reset_ports();
+
+        // Pick up changes of the port connections since the last iteration
+        component_graph_.update_schedule();
+
+        if (!shed) {
+            odrv.oscilloscope_.update();
+        }
+    }
+
+    MEASURE_TIME(task_times_.control_loop_checks) {
+        for (auto& axis: axes) {
+            // look for errors at axis level and also all subcomponents
+            bool checks_ok = axis.do_checks(timestamp);
+
+            // make sure the watchdog is being fed. 
+            bool watchdog_ok = axis.watchdog_check();
+
+            if (!checks_ok || !watchdog_ok) {
+                axis.motor_.disarm();
+            }
+        }
+    }
+
+    // Thermistors and endstops don't take part in the data flow between
+    // components so they run unconditionally.
+    for (auto& axis: axes) {
+        // Sub-components should use set_error which will propegate to this error_
+        // Skipping a single sample doesn't matter because the temperatures
+        // are low-pass filtered.
+        if (!shed) {
+            MEASURE_TIME(axis.task_times_.thermistor_update) {
+                axis.motor_.fet_thermistor_.update();
+                axis.motor_.motor_thermistor_.update();
+            }
+        }
+
+        MEASURE_TIME(axis.task_times_.endstop_update) {
+            axis.min_endstop_.update();
+            axis.max_endstop_.update();
+        }
+    }
+
+    // Components run in dependency order. For instance the controller of
+    // either axis might use the encoder estimate of the other axis so both
+    // encoders run before the controllers.
+    for (auto* node: component_graph_) {
+        MEASURE_TIME(*node->timer)
+            component_graph_.run(node, timestamp);
+    }
+
+    // Tell the axis threads that the control loop has finished
+    for (auto& axis: axes) {
+        if (axis.thread_id_) {
+            osSignalSet(axis.thread_id_, 0x0001);
+        }
+    }
+
+    get_gpio(odrv.config_.error_gpio_pin).write(odrv.any_error());
+
+    // Sample the telemetry values after all components ran so that they
+    // belong to this iteration.
+    if (telemetry_.update(n_evt_control_loop_)) {
+        usb_notify_telemetry();
+    }
+    if (can_.cyclic_tx_.update()) {
+        can_.notify_tx();
+    }
+
+    deadline_monitor_.check(timestamp);
+}
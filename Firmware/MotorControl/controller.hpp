@@ -1,7 +1,7 @@
 #ifndef __CONTROLLER_HPP
 #define __CONTROLLER_HPP
 
-class Controller : public ODriveIntf::ControllerIntf {
+class Controller : public ODriveIntf::ControllerIntf, public ComponentBase {
 public:
     struct Anticogging_t {
         uint32_t index = 0;
@@ -85,6 +85,7 @@ public:
 
     void update_filter_gains();
     bool update();
+    void update(uint32_t timestamp) final { update(); }
 
     Config_t config_;
     Axis* axis_ = nullptr; // set by Axis constructor
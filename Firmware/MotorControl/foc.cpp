@@ -50,6 +50,7 @@ void FieldOrientedController::reset() {
     vbus_voltage_measured_ = std::nullopt;
     Ialpha_beta_measured_ = std::nullopt;
     power_ = 0.0f;
+    mod_dq_valid_ = false;
 }
 
 Motor::Error FieldOrientedController::on_measurement(
@@ -75,10 +76,6 @@ ODriveIntf::MotorIntf::Error FieldOrientedController::get_alpha_beta_output(
         return Motor::ERROR_BAD_TIMING;
     }
 
-    // TODO: improve efficiency in case PWM updates are requested at a higher
-    // rate than current sensor updates. In this case we can reuse mod_d and
-    // mod_q from a previous iteration.
-
     if (!Vdq_setpoint_.has_value()) {
         return Motor::ERROR_UNKNOWN_VOLTAGE_COMMAND;
     } else if (!phase_.has_value() || !phase_vel_.has_value()) {
@@ -87,6 +84,42 @@ ODriveIntf::MotorIntf::Error FieldOrientedController::get_alpha_beta_output(
         return Motor::ERROR_UNKNOWN_VBUS_VOLTAGE;
     }
 
+    // The current controller only needs to run once per current measurement.
+    if (!mod_dq_valid_ || mod_timestamp_ != i_timestamp_) {
+        Motor::Error err = update_mod_dq();
+        if (err != Motor::ERROR_NONE) {
+            return err;
+        }
+    }
+
+    float phase = *phase_;
+    float phase_vel = *phase_vel_;
+
+    // Inverse park transform
+    float pwm_phase = phase + phase_vel * ((float)(int32_t)(output_timestamp - ctrl_timestamp_) / (float)TIM_1_8_CLOCK_HZ);
+    float c_p, s_p;
+    our_arm_sincos_f32(pwm_phase, &s_p, &c_p);
+    float mod_alpha = c_p * mod_d_ - s_p * mod_q_;
+    float mod_beta = c_p * mod_q_ + s_p * mod_d_;
+
+    // Report final applied voltage in stationary frame (for sensorless estimator)
+    final_v_alpha_ = mod_to_V_ * mod_alpha;
+    final_v_beta_ = mod_to_V_ * mod_beta;
+
+    *mod_alpha_beta = {mod_alpha, mod_beta};
+
+    if (ibus_.has_value()) {
+        *ibus = ibus_;
+    }
+    
+    return Motor::ERROR_NONE;
+}
+
+/**
+ * @brief Runs the Park transform and the current controller on the most
+ * recent current measurement and stores the result in mod_d_ and mod_q_.
+ */
+ODriveIntf::MotorIntf::Error FieldOrientedController::update_mod_dq() {
     auto [Vd, Vq] = *Vdq_setpoint_;
     float phase = *phase_;
     float phase_vel = *phase_vel_;
@@ -98,8 +131,8 @@ ODriveIntf::MotorIntf::Error FieldOrientedController::get_alpha_beta_output(
     if (Ialpha_beta_measured_.has_value()) {
         auto [Ialpha, Ibeta] = *Ialpha_beta_measured_;
         float I_phase = phase + phase_vel * ((float)(int32_t)(i_timestamp_ - ctrl_timestamp_) / (float)TIM_1_8_CLOCK_HZ);
-        float c_I = our_arm_cos_f32(I_phase);
-        float s_I = our_arm_sin_f32(I_phase);
+        float c_I, s_I;
+        our_arm_sincos_f32(I_phase, &s_I, &c_I);
         Idq = {
             c_I * Ialpha + s_I * Ibeta,
             c_I * Ibeta - s_I * Ialpha
@@ -159,25 +192,20 @@ ODriveIntf::MotorIntf::Error FieldOrientedController::get_alpha_beta_output(
         mod_q = V_to_mod * Vq;
     }
 
-    // Inverse park transform
-    float pwm_phase = phase + phase_vel * ((float)(int32_t)(output_timestamp - ctrl_timestamp_) / (float)TIM_1_8_CLOCK_HZ);
-    float c_p = our_arm_cos_f32(pwm_phase);
-    float s_p = our_arm_sin_f32(pwm_phase);
-    float mod_alpha = c_p * mod_d - s_p * mod_q;
-    float mod_beta = c_p * mod_q + s_p * mod_d;
-
-    // Report final applied voltage in stationary frame (for sensorless estimator)
-    final_v_alpha_ = mod_to_V * mod_alpha;
-    final_v_beta_ = mod_to_V * mod_beta;
-
-    *mod_alpha_beta = {mod_alpha, mod_beta};
+    mod_to_V_ = mod_to_V;
+    mod_d_ = mod_d;
+    mod_q_ = mod_q;
+    mod_timestamp_ = i_timestamp_;
+    mod_dq_valid_ = true;
 
     if (Idq.has_value()) {
         auto [Id, Iq] = *Idq;
-        *ibus = mod_d * Id + mod_q * Iq;
-        power_ = vbus_voltage * (*ibus).value();
+        ibus_ = mod_d * Id + mod_q * Iq;
+        power_ = vbus_voltage * (*ibus_);
+    } else {
+        ibus_ = std::nullopt;
     }
-    
+
     return Motor::ERROR_NONE;
 }
 
@@ -54,13 +54,22 @@ public:
     float Iq_measured_; // [A]
     float v_current_control_integral_d_ = 0.0f; // [V]
     float v_current_control_integral_q_ = 0.0f; // [V]
-    //float mod_to_V_ = 0.0f;
-    //float mod_d_ = 0.0f;
-    //float mod_q_ = 0.0f;
-    //float ibus_ = 0.0f;
+
+    // Output of the current controller for the measurement at mod_timestamp_.
+    // If PWM updates are requested at a higher rate than current measurements
+    // arrive, only the inverse Park transform is recalculated.
+    bool mod_dq_valid_ = false;
+    uint32_t mod_timestamp_ = 0; // [HCLK ticks] i_timestamp_ of the measurement that produced mod_{d,q}_
+    float mod_to_V_ = 0.0f;
+    float mod_d_ = 0.0f;
+    float mod_q_ = 0.0f;
+    std::optional<float> ibus_; // [A]
     float final_v_alpha_ = 0.0f; // [V]
     float final_v_beta_ = 0.0f; // [V]
     float power_ = 0.0f; // [W] dot product of Vdq and Idq
+
+private:
+    ODriveIntf::MotorIntf::Error update_mod_dq();
 };
 
 #endif // __FOC_HPP
\ No newline at end of file
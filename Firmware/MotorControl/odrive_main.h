@@ -149,6 +149,8 @@ inline ENUMTYPE operator ~ (ENUMTYPE a) { return static_cast<ENUMTYPE>(~static_c
 #include <mechanical_brake.hpp>
 #include <axis.hpp>
 #include <oscilloscope.hpp>
+#include <telemetry.hpp>
+#include <component_graph.hpp>
 #include <communication/communication.h>
 #include <communication/can/odrive_can.hpp>
 
@@ -184,6 +186,7 @@ public:
     }
 
     void do_fast_checks();
+    void setup_component_graph();
     void sampling_cb();
     void control_loop_cb(uint32_t timestamp);
 
@@ -219,12 +222,8 @@ public:
 
     SystemStats_t system_stats_;
 
-    // Edit these to suit your capture needs
-    Oscilloscope oscilloscope_{
-        nullptr, // trigger_src
-        0.5f, // trigger_threshold
-        nullptr // data_src TODO: change data type
-    };
+    Oscilloscope oscilloscope_;
+    Telemetry telemetry_;
 
     ODriveCAN can_;
 
@@ -239,6 +238,13 @@ public:
     uint32_t n_evt_control_loop_ = 0;
     bool task_timers_armed_ = false;
     TaskTimes task_times_;
+
+    // By default the control loop must be done before the ADCs sample the DC
+    // calibration values (see ControlLoop_IRQHandler()).
+    DeadlineMonitor deadline_monitor_{TIM_1_8_PERIOD_CLOCKS * (TIM_1_8_RCR + 1)};
+
+    // Components that run in control_loop_cb(), see setup_component_graph()
+    ComponentGraph<6 * AXIS_COUNT, 20 * AXIS_COUNT> component_graph_;
 };
 
 extern ODrive odrv; // defined in main.cpp
@@ -9,6 +9,10 @@ class OpenLoopController : public ComponentBase {
 public:
     void update(uint32_t timestamp) final;
 
+    // The controller is not scheduled while nothing consumes its outputs so
+    // the first update() after a pause must not integrate over the pause.
+    void on_activate(uint32_t timestamp) final { timestamp_ = timestamp; }
+
     // Config
     float max_current_ramp_ = INFINITY; // [A/s]
     float max_voltage_ramp_ = INFINITY; // [V/s]
@@ -1,27 +1,140 @@
 
 #include "oscilloscope.hpp"
 
-// if you use the oscilloscope feature you can bump up this value
-#define OSCILLOSCOPE_SIZE 4096
+#include <odrive_main.h>
+
+#include <atomic>
+
+bool Oscilloscope::arm() {
+    // Stop the current recording first. update() runs at a higher priority
+    // than this function so it won't see the half-updated settings below.
+    state_ = CAPTURE_STATE_IDLE;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+
+    length_ = 0;
+    n_channels_ = 0;
+
+    for (size_t i = 0; i < OSCILLOSCOPE_MAX_CHANNELS; ++i) {
+        if (!config_.channels[i].endpoint_id) {
+            break;
+        }
+        if (!fibre::get_float_readable_endpoint(config_.channels[i], &channels_[i])) {
+            return false;
+        }
+        channel_types_[i] = dynamic_cast<const FloatGettableTypeInfo*>(channels_[i].get_type_info());
+        n_channels_++;
+    }
+
+    bool needs_trigger_channel = (config_.trigger_mode == TRIGGER_MODE_RISING_EDGE)
+                              || (config_.trigger_mode == TRIGGER_MODE_FALLING_EDGE)
+                              || (config_.trigger_mode == TRIGGER_MODE_ABOVE_LEVEL)
+                              || (config_.trigger_mode == TRIGGER_MODE_BELOW_LEVEL);
+    if (!n_channels_ || (needs_trigger_channel && config_.trigger_channel >= n_channels_)) {
+        return false;
+    }
+
+    capacity_ = OSCILLOSCOPE_SIZE / n_channels_;
+    decimation_ = std::max<uint32_t>(config_.decimation, 1);
+    pre_trigger_ = std::min(config_.pre_trigger, capacity_ - 1);
+    trigger_mode_ = config_.trigger_mode;
+    trigger_channel_ = config_.trigger_channel;
+    trigger_level_ = config_.trigger_level;
+
+    decimation_cnt_ = 0;
+    write_pos_ = 0;
+    n_frames_ = 0;
+    start_pos_ = 0;
+    last_trigger_val_ = NAN;
+    force_trigger_ = false;
+
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    state_ = CAPTURE_STATE_PRE_TRIGGER;
+    return true;
+}
+
+void Oscilloscope::trigger() {
+    force_trigger_ = true;
+}
+
+float Oscilloscope::get_val(uint32_t index) {
+    uint32_t length = length_;
+    std::atomic_signal_fence(std::memory_order_acquire);
+
+    if (index >= length) {
+        return NAN;
+    }
+
+    uint32_t pos = start_pos_ + index / n_channels_;
+    pos = (pos >= capacity_) ? (pos - capacity_) : pos;
+    return data_[pos * n_channels_ + index % n_channels_];
+}
+
+float32x15_t Oscilloscope::get_block(uint32_t start) {
+    float32x15_t block;
+    for (float& val: block.values) {
+        val = get_val(start++);
+    }
+    return block;
+}
+
+bool Oscilloscope::is_triggered(float trigger_val) {
+    switch (trigger_mode_) {
+        case TRIGGER_MODE_IMMEDIATE: return true;
+        case TRIGGER_MODE_MANUAL: return false;
+        case TRIGGER_MODE_RISING_EDGE: return (last_trigger_val_ < trigger_level_) && (trigger_val >= trigger_level_);
+        case TRIGGER_MODE_FALLING_EDGE: return (last_trigger_val_ >= trigger_level_) && (trigger_val < trigger_level_);
+        case TRIGGER_MODE_ABOVE_LEVEL: return trigger_val >= trigger_level_;
+        case TRIGGER_MODE_BELOW_LEVEL: return trigger_val < trigger_level_;
+        case TRIGGER_MODE_ERROR: return odrv.any_error();
+        default: return false;
+    }
+}
 
 void Oscilloscope::update() {
-    float trigger_data = trigger_src_ ? *trigger_src_ : 0.0f;
-    float trigger_threshold = trigger_threshold_;
-    float sample_data = data_src_ ? **data_src_ : 0.0f;
-
-    if (trigger_data < trigger_threshold) {
-        ready_ = true;
-    }
-    if (ready_ && trigger_data >= trigger_threshold) {
-        capturing_ = true;
-        ready_ = false;
-    }
-    if (capturing_) {
-        if (pos_ < OSCILLOSCOPE_SIZE) {
-            data_[pos_++] = sample_data;
-        } else {
-            pos_ = 0;
-            capturing_ = false;
+    CaptureState state = state_;
+    if (state == CAPTURE_STATE_IDLE || state == CAPTURE_STATE_DONE) {
+        return;
+    }
+
+    if (++decimation_cnt_ < decimation_) {
+        return;
+    }
+    decimation_cnt_ = 0;
+
+    uint32_t pos = write_pos_;
+    float* frame = &data_[pos * n_channels_];
+    for (size_t i = 0; i < n_channels_; ++i) {
+        if (!channel_types_[i]->get_float(channels_[i], &frame[i])) {
+            frame[i] = NAN;
         }
     }
+    write_pos_ = (pos + 1 >= capacity_) ? 0 : (pos + 1);
+    n_frames_++;
+
+    if (state == CAPTURE_STATE_PRE_TRIGGER && n_frames_ > pre_trigger_) {
+        // Enough frames recorded to precede the trigger event
+        state = CAPTURE_STATE_WAIT_FOR_TRIGGER;
+    }
+
+    float trigger_val = (trigger_channel_ < n_channels_) ? frame[trigger_channel_] : 0.0f;
+
+    if (state == CAPTURE_STATE_WAIT_FOR_TRIGGER && (force_trigger_ || is_triggered(trigger_val))) {
+        // The current frame is the trigger event
+        start_pos_ = (pos >= pre_trigger_) ? (pos - pre_trigger_) : (pos + capacity_ - pre_trigger_);
+        n_frames_ = pre_trigger_ + 1;
+        state = CAPTURE_STATE_POST_TRIGGER;
+    }
+
+    last_trigger_val_ = trigger_val;
+
+    if (state == CAPTURE_STATE_POST_TRIGGER) {
+        // Publish the new frame to the reader
+        std::atomic_signal_fence(std::memory_order_release);
+        length_ = n_frames_ * n_channels_;
+        if (n_frames_ >= capacity_) {
+            state = CAPTURE_STATE_DONE;
+        }
+    }
+
+    state_ = state;
 }
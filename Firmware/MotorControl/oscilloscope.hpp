@@ -2,30 +2,77 @@
 #define __OSCILLOSCOPE_HPP
 
 #include <autogen/interfaces.hpp>
+#include <fibre/introspection.hpp>
 
 // if you use the oscilloscope feature you can bump up this value
 #define OSCILLOSCOPE_SIZE 4096
 
+#define OSCILLOSCOPE_MAX_CHANNELS 4
+
+/**
+ * @brief Records up to OSCILLOSCOPE_MAX_CHANNELS values in the control loop.
+ *
+ * A recording is started with arm(). From then on update() records one frame
+ * (one sample of each channel) every `config_.decimation` control loop
+ * iterations into a ring buffer. Once `config_.pre_trigger` frames are
+ * recorded the trigger condition is evaluated on every new frame. When it
+ * fires, the preceding frames are kept and the recording continues until the
+ * buffer is full.
+ *
+ * The buffer is written by update() in the control loop and read by the
+ * protocol through get_val() and get_block(). After the trigger event the
+ * frames of the recording are never overwritten, so the reader only needs to
+ * look at length_, which is published after the frame data. A recording can
+ * therefore be read while it is still in progress without stopping the
+ * control loop.
+ */
 class Oscilloscope : public ODriveIntf::OscilloscopeIntf {
 public:
-    Oscilloscope(float* trigger_src, float trigger_threshold, float** data_src)
-        : trigger_src_(trigger_src), trigger_threshold_(trigger_threshold), data_src_(data_src) {}
+    struct Config_t {
+        endpoint_ref_t channels[OSCILLOSCOPE_MAX_CHANNELS] = {}; // The first unset channel ends the list
+        uint32_t decimation = 1;
+        uint32_t pre_trigger = 0; // [frames]
+        TriggerMode trigger_mode = TRIGGER_MODE_IMMEDIATE;
+        uint8_t trigger_channel = 0;
+        float trigger_level = 0.0f;
+    };
 
-    float get_val(uint32_t index) override {
-        return index < OSCILLOSCOPE_SIZE ? data_[index] : NAN;
-    }
+    bool arm() override;
+    void trigger() override;
+    float get_val(uint32_t index) override;
+    float32x15_t get_block(uint32_t start) override;
 
     void update();
 
+    Config_t config_;
+
     const uint32_t size_ = OSCILLOSCOPE_SIZE;
-    const float* trigger_src_;
-    const float trigger_threshold_;
-    float* const * data_src_;
+    CaptureState state_ = CAPTURE_STATE_IDLE;
+    uint8_t n_channels_ = 0;
+    uint32_t length_ = 0; // Number of values that can be read
+
+private:
+    bool is_triggered(float trigger_val);
+
+    // Settings of the current recording, latched from config_ by arm()
+    Introspectable channels_[OSCILLOSCOPE_MAX_CHANNELS];
+    const FloatGettableTypeInfo* channel_types_[OSCILLOSCOPE_MAX_CHANNELS] = {};
+    uint32_t capacity_ = 0; // [frames]
+    uint32_t decimation_ = 1;
+    uint32_t pre_trigger_ = 0; // [frames]
+    TriggerMode trigger_mode_ = TRIGGER_MODE_IMMEDIATE;
+    uint8_t trigger_channel_ = 0;
+    float trigger_level_ = 0.0f;
+
+    // Only modified by update() while a recording is in progress
+    uint32_t decimation_cnt_ = 0;
+    uint32_t write_pos_ = 0; // [frames] buffer position of the next frame
+    uint32_t n_frames_ = 0; // Number of frames recorded since arm()
+    uint32_t start_pos_ = 0; // [frames] buffer position of the first frame of the recording
+    float last_trigger_val_ = NAN;
+    bool force_trigger_ = false;
 
     float data_[OSCILLOSCOPE_SIZE] = {0};
-    size_t pos_ = 0;
-    bool ready_ = false;
-    bool capturing_ = false;
 };
 
-#endif // __OSCILLOSCOPE_HPP
\ No newline at end of file
+#endif // __OSCILLOSCOPE_HPP
@@ -11,6 +11,23 @@ void SensorlessEstimator::reset() {
 }
 
 bool SensorlessEstimator::update() {
+    SensorlessEstimator* estimators[1] = {this};
+    update_batch(estimators);
+    return error_ == ERROR_NONE;
+}
+
+/**
+ * @brief Runs the update step of N sensorless estimators in one pass.
+ * 
+ * The per-axis state is gathered into structure-of-arrays form and each step
+ * of the algorithm runs as a loop over all estimators. This allows the
+ * compiler to vectorize the loops on the host and to interleave the
+ * independent computations of the axes on the Cortex-M4 FPU (which hides the
+ * latency of the divisions and of the load-use dependencies).
+ * With N = 1 this is identical to the unbatched algorithm.
+ */
+template<size_t N>
+void SensorlessEstimator::update_batch(SensorlessEstimator* const (&estimators)[N]) {
     // Algorithm based on paper: Sensorless Control of Surface-Mount Permanent-Magnet Synchronous Motors Based on a Nonlinear Observer
     // http://cas.ensmp.fr/~praly/Telechargement/Journaux/2010-IEEE_TPEL-Lee-Hong-Nam-Ortega-Praly-Astolfi.pdf
     // In particular, equation 8 (and by extension eqn 4 and 6).
@@ -19,88 +36,128 @@ bool SensorlessEstimator::update() {
     // is the one computed two cycles ago. To get the correct measurement, it was stored twice:
     // once by final_v_alpha/final_v_beta in the current control reporting, and once by V_alpha_beta_memory.
 
-    // PLL
-    // TODO: the PLL part has some code duplication with the encoder PLL
-    // Pll gains as a function of bandwidth
-    float pll_kp = 2.0f * config_.pll_bandwidth;
-    // Critically damped
-    float pll_ki = 0.25f * (pll_kp * pll_kp);
-
-    // Check that we don't get problems with discrete time approximation
-    if (!(current_meas_period * pll_kp < 1.0f)) {
-        error_ |= ERROR_UNSTABLE_GAIN;
-        reset(); // Reset state for when the next valid current measurement comes in.
-        return false;
-    }
-
-    // TODO: we read values here which are modified by a higher priority interrupt.
-    // This is not thread-safe.    
-    auto current_meas = axis_->motor_.current_meas_;
-    if (!axis_->motor_.is_armed_) {
-        // While the motor is disarmed the current is not measurable so we
-        // assume that it's zero.
-        current_meas = {0.0f, 0.0f};
-    }
-    if (!current_meas.has_value()) {
-        error_ |= ERROR_UNKNOWN_CURRENT_MEASUREMENT;
-        reset(); // Reset state for when the next valid current measurement comes in.
-        return false;
+    bool valid[N];
+    float pll_kp[N], pll_ki[N];
+    float I_alpha[N], I_beta[N];
+    float phase_resistance[N], phase_inductance[N];
+    float flux_alpha[N], flux_beta[N];
+    float V_alpha[N], V_beta[N];
+    float observer_gain[N], pm_flux_sqr[N];
+    float pll_pos[N], phase_vel[N];
+
+    // Gather inputs and state
+    for (size_t k = 0; k < N; ++k) {
+        SensorlessEstimator& est = *estimators[k];
+        Motor& motor = est.axis_->motor_;
+
+        // PLL
+        // TODO: the PLL part has some code duplication with the encoder PLL
+        // Pll gains as a function of bandwidth
+        pll_kp[k] = 2.0f * est.config_.pll_bandwidth;
+        // Critically damped
+        pll_ki[k] = 0.25f * (pll_kp[k] * pll_kp[k]);
+
+        // TODO: we read values here which are modified by a higher priority interrupt.
+        // This is not thread-safe.    
+        auto current_meas = motor.current_meas_;
+        if (!motor.is_armed_) {
+            // While the motor is disarmed the current is not measurable so we
+            // assume that it's zero.
+            current_meas = {0.0f, 0.0f};
+        }
+
+        valid[k] = true;
+        if (!(current_meas_period * pll_kp[k] < 1.0f)) {
+            // Check that we don't get problems with discrete time approximation
+            est.error_ |= ERROR_UNSTABLE_GAIN;
+            valid[k] = false;
+        } else if (!current_meas.has_value()) {
+            est.error_ |= ERROR_UNKNOWN_CURRENT_MEASUREMENT;
+            valid[k] = false;
+        }
+        if (!valid[k]) {
+            est.reset(); // Reset state for when the next valid current measurement comes in.
+            current_meas = {0.0f, 0.0f}; // the results of this lane are discarded
+        }
+
+        // Clarke transform
+        I_alpha[k] = current_meas->phA;
+        I_beta[k] = one_by_sqrt3 * (current_meas->phB - current_meas->phC);
+
+        phase_resistance[k] = motor.config_.phase_resistance;
+        phase_inductance[k] = motor.config_.phase_inductance;
+        flux_alpha[k] = est.flux_state_[0];
+        flux_beta[k] = est.flux_state_[1];
+        V_alpha[k] = est.V_alpha_beta_memory_[0];
+        V_beta[k] = est.V_alpha_beta_memory_[1];
+        observer_gain[k] = est.config_.observer_gain;
+        pm_flux_sqr[k] = est.config_.pm_flux_linkage * est.config_.pm_flux_linkage;
+        pll_pos[k] = est.pll_pos_;
+        phase_vel[k] = est.phase_vel_.previous().value_or(0.0f);
     }
 
-    // Clarke transform
-    float I_alpha_beta[2] = {
-        current_meas->phA,
-        one_by_sqrt3 * (current_meas->phB - current_meas->phC)};
-
-    // alpha-beta vector operations
-    float eta[2];
-    for (int i = 0; i <= 1; ++i) {
+    float eta_alpha[N], eta_beta[N];
+    for (size_t k = 0; k < N; ++k) {
         // y is the total flux-driving voltage (see paper eqn 4)
-        float y = -axis_->motor_.config_.phase_resistance * I_alpha_beta[i] + V_alpha_beta_memory_[i];
-        // flux dynamics (prediction)
-        float x_dot = y;
-        // integrate prediction to current timestep
-        flux_state_[i] += x_dot * current_meas_period;
+        // flux dynamics (prediction), integrated to current timestep
+        flux_alpha[k] += (-phase_resistance[k] * I_alpha[k] + V_alpha[k]) * current_meas_period;
+        flux_beta[k] += (-phase_resistance[k] * I_beta[k] + V_beta[k]) * current_meas_period;
 
         // eta is the estimated permanent magnet flux (see paper eqn 6)
-        eta[i] = flux_state_[i] - axis_->motor_.config_.phase_inductance * I_alpha_beta[i];
+        eta_alpha[k] = flux_alpha[k] - phase_inductance[k] * I_alpha[k];
+        eta_beta[k] = flux_beta[k] - phase_inductance[k] * I_beta[k];
     }
 
-    // Non-linear observer (see paper eqn 8):
-    float pm_flux_sqr = config_.pm_flux_linkage * config_.pm_flux_linkage;
-    float est_pm_flux_sqr = eta[0] * eta[0] + eta[1] * eta[1];
-    float bandwidth_factor = 1.0f / pm_flux_sqr;
-    float eta_factor = 0.5f * (config_.observer_gain * bandwidth_factor) * (pm_flux_sqr - est_pm_flux_sqr);
-
-    // alpha-beta vector operations
-    for (int i = 0; i <= 1; ++i) {
-        // add observer action to flux estimate dynamics
-        float x_dot = eta_factor * eta[i];
-        // convert action to discrete-time
-        flux_state_[i] += x_dot * current_meas_period;
-        // update new eta
-        eta[i] = flux_state_[i] - axis_->motor_.config_.phase_inductance * I_alpha_beta[i];
+    for (size_t k = 0; k < N; ++k) {
+        // Non-linear observer (see paper eqn 8):
+        float est_pm_flux_sqr = eta_alpha[k] * eta_alpha[k] + eta_beta[k] * eta_beta[k];
+        float bandwidth_factor = 1.0f / pm_flux_sqr[k];
+        float eta_factor = 0.5f * (observer_gain[k] * bandwidth_factor) * (pm_flux_sqr[k] - est_pm_flux_sqr);
+
+        // add observer action to flux estimate dynamics, convert action to
+        // discrete-time and update new eta
+        flux_alpha[k] += eta_factor * eta_alpha[k] * current_meas_period;
+        flux_beta[k] += eta_factor * eta_beta[k] * current_meas_period;
+        eta_alpha[k] = flux_alpha[k] - phase_inductance[k] * I_alpha[k];
+        eta_beta[k] = flux_beta[k] - phase_inductance[k] * I_beta[k];
     }
 
-    // Flux state estimation done, store V_alpha_beta for next timestep
-    V_alpha_beta_memory_[0] = axis_->motor_.current_control_.final_v_alpha_;
-    V_alpha_beta_memory_[1] = axis_->motor_.current_control_.final_v_beta_;
+    float phase[N];
+    for (size_t k = 0; k < N; ++k) {
+        // predict PLL phase with velocity
+        pll_pos[k] = wrap_pm_pi(pll_pos[k] + current_meas_period * phase_vel[k]);
+        // update PLL phase with observer permanent magnet phase
+        phase[k] = fast_atan2(eta_beta[k], eta_alpha[k]);
+        float delta_phase = wrap_pm_pi(phase[k] - pll_pos[k]);
+        pll_pos[k] = wrap_pm_pi(pll_pos[k] + current_meas_period * pll_kp[k] * delta_phase);
+        // update PLL velocity
+        phase_vel[k] += current_meas_period * pll_ki[k] * delta_phase;
+    }
+
+    // Scatter state and outputs
+    for (size_t k = 0; k < N; ++k) {
+        if (!valid[k]) {
+            continue;
+        }
+        SensorlessEstimator& est = *estimators[k];
+        Motor& motor = est.axis_->motor_;
+
+        est.flux_state_[0] = flux_alpha[k];
+        est.flux_state_[1] = flux_beta[k];
 
-    float phase_vel = phase_vel_.previous().value_or(0.0f);
+        // Flux state estimation done, store V_alpha_beta for next timestep
+        est.V_alpha_beta_memory_[0] = motor.current_control_.final_v_alpha_;
+        est.V_alpha_beta_memory_[1] = motor.current_control_.final_v_beta_;
 
-    // predict PLL phase with velocity
-    pll_pos_ = wrap_pm_pi(pll_pos_ + current_meas_period * phase_vel);
-    // update PLL phase with observer permanent magnet phase
-    float phase = fast_atan2(eta[1], eta[0]);
-    float delta_phase = wrap_pm_pi(phase - pll_pos_);
-    pll_pos_ = wrap_pm_pi(pll_pos_ + current_meas_period * pll_kp * delta_phase);
-    // update PLL velocity
-    phase_vel += current_meas_period * pll_ki * delta_phase;
+        est.pll_pos_ = pll_pos[k];
 
-    // set outputs
-    phase_ = phase;
-    phase_vel_ = phase_vel;
-    vel_estimate_ = phase_vel / (std::max((float)axis_->motor_.config_.pole_pairs, 1.0f) * 2.0f * M_PI);
+        // set outputs
+        est.phase_ = phase[k];
+        est.phase_vel_ = phase_vel[k];
+        est.vel_estimate_ = phase_vel[k] / (std::max((float)motor.config_.pole_pairs, 1.0f) * 2.0f * M_PI);
+    }
+}
 
-    return true;
-};
+void SensorlessEstimatorBatch::update(uint32_t timestamp) {
+    SensorlessEstimator::update_batch(estimators_);
+}
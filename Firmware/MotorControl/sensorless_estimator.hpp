@@ -3,7 +3,7 @@
 
 #include "component.hpp"
 
-class SensorlessEstimator : public ODriveIntf::SensorlessEstimatorIntf {
+class SensorlessEstimator : public ODriveIntf::SensorlessEstimatorIntf, public ComponentBase {
 public:
     struct Config_t {
         float observer_gain = 1000.0f; // [rad/s]
@@ -13,6 +13,7 @@ public:
 
     void reset();
     bool update();
+    void update(uint32_t timestamp) final { update(); }
 
     Axis* axis_ = nullptr; // set by Axis constructor
     Config_t config_;
@@ -26,6 +27,26 @@ public:
     OutputPort<float> phase_ = 0.0f;                   // [rad]
     OutputPort<float> phase_vel_ = 0.0f;               // [rad/s]
     OutputPort<float> vel_estimate_ = 0.0f;            // [turns/s]
+
+private:
+    friend class SensorlessEstimatorBatch;
+
+    template<size_t N>
+    static void update_batch(SensorlessEstimator* const (&estimators)[N]);
+};
+
+/**
+ * @brief Updates the sensorless estimators of all axes in one pass (see
+ * SensorlessEstimator::update_batch()).
+ * 
+ * Used instead of the individual estimators if the firmware is built with
+ * BATCHED_AXES.
+ */
+class SensorlessEstimatorBatch : public ComponentBase {
+public:
+    void update(uint32_t timestamp) final;
+
+    SensorlessEstimator* estimators_[AXIS_COUNT];
 };
 
 #endif /* __SENSORLESS_ESTIMATOR_HPP */
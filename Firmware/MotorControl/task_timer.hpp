@@ -62,4 +62,58 @@ struct TaskTimerContext {
 
 #define MEASURE_TIME(timer) for (TaskTimerContext __task_timer_ctx{timer}; !__task_timer_ctx.exit_; __task_timer_ctx.exit_ = true)
 
+/**
+ * @brief Checks the execution time of every control loop iteration against a
+ * budget.
+ * 
+ * The execution time is measured with TIM13, which is reloaded in sync with
+ * the PWM timers, so check() yields the time since the beginning of the
+ * control period rather than the length of a single task. An iteration that
+ * runs into the next control period would therefore look short. check()
+ * detects this from the board's timestamp_, which advances with every timer
+ * update.
+ */
+struct DeadlineMonitor {
+    static constexpr size_t kNumBins = 8;
+
+    /**
+     * @brief Shall be called at the end of each control loop iteration.
+     * 
+     * Sets shedding_ if non-critical work should be skipped in the next
+     * control loop iteration.
+     * 
+     * @param timestamp: The timestamp of the control period in which the
+     *        iteration started (see ODrive::control_loop_cb()).
+     */
+    void check(uint32_t timestamp) {
+        uint32_t length = sample_TIM13();
+
+        // TIM13 is sampled first so that a reload in between is seen here.
+        // A reload in the few cycles before the TIM8 update interrupt runs
+        // still goes unnoticed.
+        uint32_t n_periods = (timestamp_ - timestamp) / CONTROL_TIMER_PERIOD_TICKS;
+        length += n_periods * CONTROL_TIMER_PERIOD_TICKS;
+        last_length_ = length;
+
+        if (!budget_) {
+            shedding_ = false;
+        } else if (n_periods || length >= budget_) {
+            overrun_count_++;
+            shedding_ = shed_on_overrun_;
+        } else {
+            // The histogram spans the budget in kNumBins equally sized bins
+            histogram_[(uint64_t)length * kNumBins / budget_]++;
+            shedding_ = false;
+        }
+    }
+
+    uint32_t budget_ = 0; // [HCLK ticks] 0 disables the monitor
+    bool shed_on_overrun_ = false;
+    uint32_t last_length_ = 0; // [HCLK ticks]
+    uint32_t overrun_count_ = 0;
+    uint32_t histogram_[kNumBins] = {0};
+    bool shedding_ = false;
+    uint32_t shed_count_ = 0; // Number of iterations in which work was skipped
+};
+
 #endif // __TASK_TIMER_HPP
\ No newline at end of file
@@ -0,0 +1,109 @@
+
+#include "telemetry.hpp"
+
+#include <fibre/simple_serdes.hpp>
+
+#include <atomic>
+
+bool Telemetry::start() {
+    // Stop the current stream first. update() runs at a higher priority than
+    // this function so it won't see the half-updated settings below.
+    active_ = false;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+
+    n_channels_ = 0;
+
+    for (size_t i = 0; i < TELEMETRY_MAX_CHANNELS; ++i) {
+        if (!config_.channels[i].endpoint_id) {
+            break;
+        }
+        if (!fibre::get_float_readable_endpoint(config_.channels[i], &channels_[i])) {
+            return false;
+        }
+        channel_types_[i] = dynamic_cast<const FloatGettableTypeInfo*>(channels_[i].get_type_info());
+        n_channels_++;
+    }
+
+    if (!n_channels_) {
+        return false;
+    }
+
+    period_ = std::max<uint32_t>(config_.period, 1);
+    period_cnt_ = 0;
+    n_dropped_ = 0;
+
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    active_ = true;
+    return true;
+}
+
+void Telemetry::stop() {
+    active_ = false;
+}
+
+bool Telemetry::update(uint32_t timestamp) {
+    if (!active_) {
+        return false;
+    }
+
+    if (++period_cnt_ < period_) {
+        return false;
+    }
+    period_cnt_ = 0;
+
+    uint32_t write_idx = write_idx_;
+    uint32_t next_write_idx = (write_idx + 1 >= TELEMETRY_QUEUE_LENGTH) ? 0 : (write_idx + 1);
+    if (next_write_idx == read_idx_) {
+        n_dropped_++;
+        return false;
+    }
+
+    Sample& sample = samples_[write_idx];
+    sample.timestamp = timestamp;
+    sample.n_values = n_channels_;
+    for (size_t i = 0; i < n_channels_; ++i) {
+        if (!channel_types_[i]->get_float(channels_[i], &sample.values[i])) {
+            sample.values[i] = NAN;
+        }
+    }
+
+    // Publish the sample to the reader
+    std::atomic_signal_fence(std::memory_order_release);
+    write_idx_ = next_write_idx;
+    return true;
+}
+
+bool Telemetry::pop_samples(fibre::bufptr_t* buffer) {
+    uint32_t write_idx = write_idx_;
+    std::atomic_signal_fence(std::memory_order_acquire);
+
+    uint32_t read_idx = read_idx_;
+    if (read_idx == write_idx) {
+        return false;
+    }
+
+    uint8_t n_values = samples_[read_idx].n_values;
+    size_t sample_size = 4 + 4 * n_values;
+    if (buffer->size() < 1 + sample_size) {
+        return false;
+    }
+
+    *buffer->begin() = n_values;
+    *buffer = buffer->skip(1);
+
+    while (read_idx != write_idx && buffer->size() >= sample_size
+            && samples_[read_idx].n_values == n_values) {
+        Sample& sample = samples_[read_idx];
+        write_le<uint32_t>(sample.timestamp, buffer->begin());
+        for (size_t i = 0; i < n_values; ++i) {
+            write_le<float>(sample.values[i], buffer->begin() + 4 + 4 * i);
+        }
+        *buffer = buffer->skip(sample_size);
+        read_idx = (read_idx + 1 >= TELEMETRY_QUEUE_LENGTH) ? 0 : (read_idx + 1);
+    }
+
+    // Hand the slots back to the writer
+    std::atomic_signal_fence(std::memory_order_release);
+    read_idx_ = read_idx;
+    return true;
+}
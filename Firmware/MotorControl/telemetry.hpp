@@ -0,0 +1,77 @@
+#ifndef __TELEMETRY_HPP
+#define __TELEMETRY_HPP
+
+#include <autogen/interfaces.hpp>
+#include <fibre/introspection.hpp>
+
+#define TELEMETRY_MAX_CHANNELS 8
+
+// Number of samples that can be buffered until the USB link picks them up
+#define TELEMETRY_QUEUE_LENGTH 32
+
+/**
+ * @brief Samples up to TELEMETRY_MAX_CHANNELS values in the control loop so
+ * that they can be pushed to the host.
+ *
+ * update() is called at the end of every control loop iteration and puts one
+ * sample every `config_.period` iterations into a queue. The queue is drained
+ * by pop_samples() on the thread that sends the samples to the host. This is
+ * a single-producer single-consumer queue: only update() writes write_idx_
+ * and only pop_samples() writes read_idx_.
+ *
+ * If the queue is full the new sample is dropped.
+ */
+class Telemetry : public ODriveIntf::TelemetryIntf {
+public:
+    struct Config_t {
+        endpoint_ref_t channels[TELEMETRY_MAX_CHANNELS] = {}; // The first unset channel ends the list
+        uint32_t period = 8; // [control loop iterations]
+    };
+
+    bool start() override;
+    void stop() override;
+
+    /**
+     * @brief Takes a sample if one is due.
+     * @returns true if a sample was put into the queue.
+     */
+    bool update(uint32_t timestamp);
+
+    /**
+     * @brief Moves as many queued samples into the buffer as fit.
+     *
+     * The buffer is filled with the number of channels (uint8) followed by
+     * the samples. Each sample consists of the control loop timestamp
+     * (uint32) and one float32 per channel, all little endian. All samples
+     * in one buffer have the same number of channels.
+     *
+     * @returns false if no sample was pending or the buffer is too small. In
+     * this case the buffer is left untouched.
+     */
+    bool pop_samples(fibre::bufptr_t* buffer);
+
+    Config_t config_;
+
+    bool active_ = false;
+    uint8_t n_channels_ = 0;
+    uint32_t n_dropped_ = 0;
+
+private:
+    struct Sample {
+        uint32_t timestamp;
+        uint8_t n_values;
+        float values[TELEMETRY_MAX_CHANNELS];
+    };
+
+    // Settings of the current stream, latched from config_ by start()
+    Introspectable channels_[TELEMETRY_MAX_CHANNELS];
+    const FloatGettableTypeInfo* channel_types_[TELEMETRY_MAX_CHANNELS] = {};
+    uint32_t period_ = 1;
+
+    uint32_t period_cnt_ = 0;
+    Sample samples_[TELEMETRY_QUEUE_LENGTH];
+    uint32_t write_idx_ = 0; // [samples] only modified by update()
+    uint32_t read_idx_ = 0; // [samples] only modified by pop_samples()
+};
+
+#endif // __TELEMETRY_HPP
@@ -75,6 +75,7 @@ void delay_us(uint32_t us);
 extern "C" {
 float our_arm_sin_f32(float x);
 float our_arm_cos_f32(float x);
+void our_arm_sincos_f32(float x, float* sin_val, float* cos_val);
 }
 
 // ----------------
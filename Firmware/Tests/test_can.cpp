@@ -4,6 +4,7 @@
 #include <cstring>
 
 #include "communication/can/can_helpers.hpp"
+#include "communication/can/can_tx_queue.hpp"
 
 enum InputMode {
     INPUT_MODE_INACTIVE,
@@ -90,4 +91,187 @@ TEST_SUITE("CAN Functions") {
         CHECK(static_cast<InputMode>(can_getSignal<InputMode>(rxmsg, 0, 8, true, 1, 0)) == INPUT_MODE_MIX_CHANNELS);
         CHECK(static_cast<InputMode>(can_getSignal<InputMode>(rxmsg, 8, 8, true, 1, 0)) == INPUT_MODE_PASSTHROUGH);
     }
-}
\ No newline at end of file
+
+    TEST_CASE("SignalDesc matches getSignal/setSignal") {
+        uint32_t state = 1;
+        auto random_msg = [&]() {
+            can_Message_t msg;
+            for (auto& b: msg.buf) {
+                state = state * 1664525u + 1013904223u;
+                b = state >> 24;
+            }
+            return msg;
+        };
+
+        // Compares decoding and encoding of the signal on random messages
+        auto check_parity = [&](auto desc, uint8_t startBit, uint8_t length, bool isIntel) {
+            using Desc = decltype(desc);
+            using T = typename Desc::raw_type;
+            for (size_t i = 0; i < 100; ++i) {
+                can_Message_t msg = random_msg();
+                T expected = can_getSignal<T>(msg, startBit, length, isIntel);
+                T actual = Desc::get_raw(msg);
+                REQUIRE(std::memcmp(&expected, &actual, sizeof(T)) == 0);
+
+                // Use a value that fits into the signal
+                can_Message_t src = random_msg();
+                T val = can_getSignal<T>(src, startBit, length, isIntel);
+                can_Message_t expected_msg = msg;
+                can_setSignal<T>(expected_msg, val, startBit, length, isIntel);
+                Desc::set_raw(msg, val);
+                REQUIRE(std::memcmp(msg.buf, expected_msg.buf, sizeof(msg.buf)) == 0);
+            }
+        };
+
+        check_parity(can_SignalDesc<float, 0, 32>{}, 0, 32, true);
+        check_parity(can_SignalDesc<float, 32, 32>{}, 32, 32, true);
+        check_parity(can_SignalDesc<uint64_t, 0, 64>{}, 0, 64, true);
+        check_parity(can_SignalDesc<int32_t, 0, 16>{}, 0, 16, true);
+        check_parity(can_SignalDesc<uint16_t, 48, 16>{}, 48, 16, true);
+        check_parity(can_SignalDesc<uint32_t, 3, 21>{}, 3, 21, true);
+        check_parity(can_SignalDesc<uint8_t, 61, 3>{}, 61, 3, true);
+        check_parity(can_SignalDesc<uint16_t, 0, 16, false>{}, 0, 16, false);
+        check_parity(can_SignalDesc<float, 12, 32, false>{}, 12, 32, false);
+        check_parity(can_SignalDesc<uint64_t, 0, 64, false>{}, 0, 64, false);
+        check_parity(can_SignalDesc<uint32_t, 5, 27, false>{}, 5, 27, false);
+    }
+
+    TEST_CASE("SignalDesc scaling") {
+        can_Message_t msg;
+        std::memset(msg.buf, 0, sizeof(msg.buf));
+
+        using VelFF = can_SignalDesc<int16_t, 32, 16, true, std::milli>;
+        msg.buf[4] = 0x18;
+        msg.buf[5] = 0xfc; // -1000
+        CHECK(VelFF::get(msg) == can_getSignal<int16_t>(msg, 32, 16, true, 0.001f, 0.0f));
+        CHECK(VelFF::get(msg) == -1.0f);
+
+        VelFF::set(msg, 2.5f);
+        CHECK(can_getSignal<int16_t>(msg, 32, 16, true) == 2500);
+
+        using Scaled = can_SignalDesc<float, 12, 32, false, std::ratio<2>, std::ratio<11, 10>>;
+        Scaled::set(msg, 234981.0f);
+        CHECK(Scaled::get(msg) == can_getSignal<float>(msg, 12, 32, false, 2.0f, 1.1f));
+        CHECK(Scaled::get(msg) == 234981.0f);
+    }
+
+    TEST_CASE("TxQueue priority") {
+        auto make_msg = [](uint32_t id, bool isExt, bool rtr, uint8_t payload) {
+            can_Message_t msg;
+            msg.id = id;
+            msg.isExt = isExt;
+            msg.rtr = rtr;
+            msg.buf[0] = payload;
+            return msg;
+        };
+
+        using Queue = CanTxQueue<8>;
+        // Standard data < standard RTR < extended with the same base ID
+        CHECK(Queue::arbitration_key(make_msg(0x123, false, false, 0)) < Queue::arbitration_key(make_msg(0x123, false, true, 0)));
+        CHECK(Queue::arbitration_key(make_msg(0x123, false, true, 0)) < Queue::arbitration_key(make_msg(0x123 << 18, true, false, 0)));
+        CHECK(Queue::arbitration_key(make_msg(0x122 << 18 | 0x3ffff, true, true, 0)) < Queue::arbitration_key(make_msg(0x123, false, false, 0)));
+        CHECK(Queue::arbitration_key(make_msg(0x1000, true, false, 0)) < Queue::arbitration_key(make_msg(0x1000, true, true, 0)));
+
+        Queue queue;
+        queue.push(make_msg(0x021, false, false, 1), false);
+        queue.push(make_msg(0x009, false, false, 2), false);
+        queue.push(make_msg(0x021, false, false, 3), false);
+        queue.push(make_msg(0x001, false, false, 4), false);
+
+        // front() doesn't remove the frame
+        REQUIRE(queue.front());
+        CHECK(queue.front()->buf[0] == 4);
+        CHECK(queue.size() == 4);
+
+        can_Message_t msg;
+        uint8_t order[4];
+        for (auto& payload: order) {
+            REQUIRE(queue.pop(&msg));
+            payload = msg.buf[0];
+        }
+        CHECK(order[0] == 4);
+        CHECK(order[1] == 2);
+        CHECK(order[2] == 1); // same ID: first in, first out
+        CHECK(order[3] == 3);
+        CHECK(!queue.pop(&msg));
+        CHECK(!queue.front());
+    }
+
+    TEST_CASE("TxQueue coalescing and overflow") {
+        auto make_msg = [](uint32_t id, uint8_t payload) {
+            can_Message_t msg;
+            msg.id = id;
+            msg.buf[0] = payload;
+            return msg;
+        };
+
+        CanTxQueue<3> queue;
+        CHECK(queue.push(make_msg(0x009, 1), true));
+        CHECK(queue.push(make_msg(0x009, 2), false)); // not coalesced
+        CHECK(queue.push(make_msg(0x009, 3), true)); // replaces 1, goes after 2
+        CHECK(queue.size() == 2);
+        CHECK(queue.n_coalesced_ == 1);
+
+        // The lowest priority frame is dropped when the queue is full
+        CHECK(queue.push(make_msg(0x041, 4), false));
+        CHECK(queue.full());
+        CHECK(!queue.push(make_msg(0x041, 5), false));
+        CHECK(queue.push(make_msg(0x001, 6), false));
+        CHECK(queue.n_dropped_ == 2);
+
+        can_Message_t msg;
+        uint8_t order[3];
+        for (auto& payload: order) {
+            REQUIRE(queue.pop(&msg));
+            payload = msg.buf[0];
+        }
+        CHECK(order[0] == 6);
+        CHECK(order[1] == 2);
+        CHECK(order[2] == 3);
+        CHECK(queue.size() == 0);
+    }
+
+    TEST_CASE("TxQueue keeps heartbeats") {
+        auto make_msg = [](uint32_t id, uint8_t payload) {
+            can_Message_t msg;
+            msg.id = id;
+            msg.buf[0] = payload;
+            return msg;
+        };
+
+        // Axis1's heartbeat (node 1) has a lower priority than axis0's
+        // responses (node 0)
+        CanTxQueue<16> queue;
+        CHECK(queue.push(make_msg(0x021, 1), true, true));
+        for (uint8_t i = 0; i < 15; ++i) {
+            CHECK(queue.push(make_msg(0x009, 10 + i), false));
+        }
+        CHECK(queue.full());
+        CHECK(!queue.push(make_msg(0x014, 30), false));
+        CHECK(queue.push(make_msg(0x021, 2), true, true)); // coalesced
+        CHECK(queue.push(make_msg(0x001, 3), true, true)); // axis0's heartbeat evicts a response
+        CHECK(queue.n_coalesced_ == 1);
+        CHECK(queue.n_dropped_ == 2);
+
+        // A cyclic message with the heartbeat's ID neither evicts nor
+        // replaces it
+        CHECK(!queue.push(make_msg(0x021, 4), true));
+
+        can_Message_t msg;
+        REQUIRE(queue.pop(&msg));
+        CHECK(msg.buf[0] == 3);
+        for (uint8_t i = 0; i < 14; ++i) {
+            REQUIRE(queue.pop(&msg));
+            CHECK(msg.buf[0] == 10 + i);
+        }
+        REQUIRE(queue.pop(&msg));
+        CHECK(msg.buf[0] == 2);
+        CHECK(queue.size() == 0);
+
+        // Heartbeats are only dropped if there's nothing else to drop
+        CanTxQueue<2> small_queue;
+        CHECK(small_queue.push(make_msg(0x181, 1), true, true));
+        CHECK(small_queue.push(make_msg(0x021, 2), true, true));
+        CHECK(!small_queue.push(make_msg(0x001, 3), true, true));
+    }
+}
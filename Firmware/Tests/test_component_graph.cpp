@@ -0,0 +1,151 @@
+#include <doctest.h>
+#include "MotorControl/component_graph.hpp"
+
+#include <vector>
+
+static std::vector<int> update_log;
+static std::vector<int> activate_log;
+
+struct TestComponent : ComponentBase {
+    TestComponent(int id) : id_(id) {}
+
+    void update(uint32_t timestamp) final {
+        update_log.push_back(id_);
+        std::optional<float> in = input_src_.present();
+        if (in.has_value()) {
+            output_ = *in + 1.0f;
+        }
+    }
+
+    void on_activate(uint32_t timestamp) final {
+        activate_log.push_back(id_);
+    }
+
+    int id_;
+    InputPort<float> input_src_;
+    OutputPort<float> output_ = 0.0f;
+};
+
+static std::vector<int> run(ComponentGraph<4, 4>& graph) {
+    update_log.clear();
+    graph.reset_ports();
+    graph.update_schedule();
+    graph.update(0);
+    return update_log;
+}
+
+TEST_CASE("ComponentGraph") {
+    TestComponent sink{0}, middle{1}, source{2}, unused{3};
+    ComponentGraph<4, 4> graph;
+
+    // Registered in reverse data flow order
+    REQUIRE(graph.add(&sink, nullptr, {&sink.input_src_}, {&sink.output_}, {&graph.kAlways}));
+    REQUIRE(graph.add(&middle, nullptr, {&middle.input_src_}, {&middle.output_}));
+    REQUIRE(graph.add(&source, nullptr, {}, {&source.output_}));
+    REQUIRE(graph.add(&unused, nullptr, {}, {&unused.output_}));
+    CHECK(!graph.add(&unused, nullptr, {}, {}));
+
+    // Nothing connected: only the sink runs
+    CHECK(run(graph) == std::vector<int>{0});
+
+    SUBCASE("sorted by data flow") {
+        middle.input_src_.connect_to(&source.output_);
+        sink.input_src_.connect_to(&middle.output_);
+        CHECK(run(graph) == std::vector<int>{2, 1, 0});
+        CHECK(sink.output_.present() == 3.0f);
+
+        // Values from the previous iteration are outdated after reset_ports()
+        graph.reset_ports();
+        CHECK(!sink.output_.present().has_value());
+        CHECK(sink.output_.previous() == 3.0f);
+    }
+
+    SUBCASE("unconsumed components are skipped") {
+        sink.input_src_.connect_to(&source.output_);
+        CHECK(run(graph) == std::vector<int>{2, 0});
+
+        sink.input_src_.disconnect();
+        CHECK(run(graph) == std::vector<int>{0});
+        CHECK(!graph.update_schedule());
+    }
+
+    SUBCASE("keep-alive") {
+        bool keep_alive[2] = {false, false};
+        TestComponent extra{4};
+        ComponentGraph<4, 4> graph2;
+        graph2.add(&extra, nullptr, {&extra.input_src_}, {&extra.output_}, {&keep_alive[0], &keep_alive[1]});
+        graph2.add(&source, nullptr, {}, {&source.output_});
+        extra.input_src_.connect_to(&source.output_);
+        CHECK(run(graph2) == std::vector<int>{});
+
+        keep_alive[1] = true;
+        CHECK(run(graph2) == std::vector<int>{2, 4});
+    }
+
+    SUBCASE("on_activate") {
+        activate_log.clear();
+        sink.input_src_.connect_to(&source.output_);
+        CHECK(run(graph) == std::vector<int>{2, 0});
+        CHECK(activate_log == std::vector<int>{2});
+
+        // Only called again after the component was skipped
+        activate_log.clear();
+        CHECK(run(graph) == std::vector<int>{2, 0});
+        sink.input_src_.disconnect();
+        CHECK(run(graph) == std::vector<int>{0});
+        sink.input_src_.connect_to(&source.output_);
+        CHECK(run(graph) == std::vector<int>{2, 0});
+        CHECK(activate_log == std::vector<int>{2});
+
+        // Replanning without running in between keeps the call pending
+        activate_log.clear();
+        sink.input_src_.connect_to(&middle.output_);
+        middle.input_src_.connect_to(&source.output_);
+        graph.update_schedule();
+        middle.input_src_.disconnect();
+        CHECK(run(graph) == std::vector<int>{1, 0});
+        CHECK(activate_log == std::vector<int>{1});
+    }
+
+    SUBCASE("self-loop") {
+        sink.input_src_.connect_to(&sink.output_);
+        CHECK(run(graph) == std::vector<int>{0});
+    }
+}
+
+TEST_CASE("InputPort") {
+    OutputPort<float> output = 1.0f;
+    float plain_value = 2.0f;
+    InputPort<float> port;
+
+    // Unconfigured ports provide an internally stored default value
+    CHECK(port.present() == 0.0f);
+    CHECK(port.any() == 0.0f);
+
+    port.connect_to(&output);
+    CHECK(!port.present().has_value());
+    CHECK(port.any() == 1.0f);
+    output = 3.0f;
+    CHECK(port.present() == 3.0f);
+    output.reset();
+    CHECK(!port.present().has_value());
+    CHECK(port.any() == 3.0f);
+
+    port.connect_to(&plain_value);
+    CHECK(port.present() == 2.0f);
+    plain_value = 4.0f;
+    CHECK(port.present() == 4.0f);
+
+    port.disconnect();
+    CHECK(!port.present().has_value());
+    CHECK(!port.any().has_value());
+
+    port.connect_to((float*)nullptr);
+    CHECK(!port.present().has_value());
+
+    // Copies must not refer to the internal value of the original
+    InputPort<float> original;
+    InputPort<float> copy{original};
+    original.connect_to(&output);
+    CHECK(copy.present() == 0.0f);
+}
@@ -0,0 +1,28 @@
+
+#include <doctest.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <initializer_list>
+
+#include <fibre/../../crc.hpp>
+
+TEST_SUITE("crc") {
+    TEST_CASE("crc8 table matches bitwise calculation") {
+        uint8_t buf[64];
+        srand(1);
+        for (uint8_t& byte: buf) {
+            byte = (uint8_t)rand();
+        }
+
+        for (size_t len = 0; len <= sizeof(buf); ++len) {
+            for (uint8_t init: {(uint8_t)0x00, (uint8_t)0x42, (uint8_t)0xff}) {
+                CHECK(calc_crc8<0x37>(init, buf, len) == calc_crc<uint8_t, 0x37>(init, buf, len));
+                CHECK(calc_crc8<0x07>(init, buf, len) == calc_crc<uint8_t, 0x07>(init, buf, len));
+            }
+        }
+
+        // CRC-8 (poly 0x07, init 0x00) check value
+        const uint8_t check_str[] = "123456789";
+        CHECK(calc_crc8<0x07>(0x00, check_str, 9) == 0xf4);
+    }
+}
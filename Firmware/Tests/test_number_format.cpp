@@ -0,0 +1,165 @@
+
+#include <doctest.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <fibre/number_format.hpp>
+
+using fibre::parse_number;
+using fibre::format_number;
+
+template<typename T>
+static bool parse(const char* str, T* value) {
+    const char* end = str + strlen(str);
+    return parse_number(str, end, value) == end;
+}
+
+template<typename T>
+static std::string format(T value) {
+    char buf[24];
+    size_t len = format_number(value, buf, sizeof(buf));
+    return std::string(buf, len);
+}
+
+TEST_SUITE("number_format") {
+    TEST_CASE("parse float") {
+        float value;
+        CHECK(parse("1.5", &value));
+        CHECK(value == 1.5f);
+        CHECK(parse("  -0.125", &value));
+        CHECK(value == -0.125f);
+        CHECK(parse("+3", &value));
+        CHECK(value == 3.0f);
+        CHECK(parse(".5", &value));
+        CHECK(value == 0.5f);
+        CHECK(parse("1e3", &value));
+        CHECK(value == 1000.0f);
+        CHECK(parse("2.5E-2", &value));
+        CHECK(value == 0.025f);
+        CHECK(parse("0.1", &value));
+        CHECK(value == 0.1f);
+        CHECK(parse("-inf", &value));
+        CHECK(value == -INFINITY);
+        CHECK(parse("nan", &value));
+        CHECK(std::isnan(value));
+        CHECK(parse("1e50", &value));
+        CHECK(value == INFINITY);
+        CHECK(parse("1e-50", &value));
+        CHECK(value == 0.0f);
+        CHECK(parse("123456789012345678901234567890", &value));
+        CHECK(value == 123456789012345678901234567890.0f);
+
+        // Stops at the first character that doesn't belong to the number
+        const char* str = "1.5e 2";
+        CHECK(parse_number(str, str + strlen(str), &value) == str + 3);
+        CHECK(value == 1.5f);
+        str = "12.5";
+        CHECK(parse_number(str, str + 2, &value) == str + 2);
+        CHECK(value == 12.0f);
+
+        CHECK(!parse_number("", (const char*)"", &value));
+        str = " - 1";
+        CHECK(!parse_number(str, str + strlen(str), &value));
+        str = "e5";
+        CHECK(!parse_number(str, str + strlen(str), &value));
+    }
+
+    TEST_CASE("parse float matches strtof") {
+        char buf[32];
+        srand(1);
+        for (int i = 0; i < 10000; ++i) {
+            double mantissa = (double)rand() / (double)RAND_MAX - 0.5;
+            snprintf(buf, sizeof(buf), "%.*e", rand() % 12, mantissa * pow(10.0, rand() % 60 - 30));
+            float value;
+            REQUIRE(parse(buf, &value));
+            CHECK_MESSAGE(value == strtof(buf, nullptr), buf);
+        }
+    }
+
+    TEST_CASE("parse int") {
+        int32_t i32;
+        CHECK(parse("-2147483648", &i32));
+        CHECK(i32 == INT32_MIN);
+        CHECK(parse("2147483647", &i32));
+        CHECK(i32 == INT32_MAX);
+        CHECK(!parse("2147483648", &i32));
+        CHECK(parse("0x7fffFFFF", &i32));
+        CHECK(i32 == INT32_MAX);
+
+        uint8_t u8;
+        CHECK(parse("255", &u8));
+        CHECK(u8 == 255);
+        CHECK(!parse("256", &u8));
+        CHECK(!parse("-1", &u8));
+
+        uint64_t u64;
+        CHECK(parse("18446744073709551615", &u64));
+        CHECK(u64 == UINT64_MAX);
+        CHECK(!parse("18446744073709551616", &u64));
+
+        // "0x" without digits is the number 0 followed by "x"
+        const char* str = "0x";
+        CHECK(parse_number(str, str + 2, &u8) == str + 1);
+        CHECK(u8 == 0);
+        CHECK(!parse("x", &u8));
+    }
+
+    TEST_CASE("parse bool") {
+        bool value = false;
+        CHECK(parse("1", &value));
+        CHECK(value);
+        CHECK(parse("0", &value));
+        CHECK(!value);
+        CHECK(parse("true", &value));
+        CHECK(value);
+        CHECK(parse("False", &value));
+        CHECK(!value);
+        CHECK(!parse("yes", &value));
+    }
+
+    TEST_CASE("format") {
+        CHECK(format(0.0f) == "0");
+        CHECK(format(-0.0f) == "-0");
+        CHECK(format(0.1f) == "0.1");
+        CHECK(format(24.087744f) == "24.087744");
+        CHECK(format(-123.456f) == "-123.456");
+        CHECK(format(1e8f) == "100000000");
+        CHECK(format(1e9f) == "1e+09");
+        CHECK(format(0.00001f) == "0.00001");
+        CHECK(format(1.5e-7f) == "1.5e-07");
+        CHECK(format(3.4028235e38f) == "3.4028235e+38");
+        CHECK(format(INFINITY) == "inf");
+        CHECK(format(-INFINITY) == "-inf");
+        CHECK(format(NAN) == "nan");
+
+        CHECK(format(INT32_MIN) == "-2147483648");
+        CHECK(format((uint8_t)255) == "255");
+        CHECK(format(UINT64_MAX) == "18446744073709551615");
+        CHECK(format(true) == "1");
+
+        char buf[4];
+        CHECK(format_number(1234, buf, sizeof(buf)) == 0);
+        CHECK(format_number(123, buf, sizeof(buf)) == 3);
+        CHECK(format_number(0.125f, buf, sizeof(buf)) == 0);
+    }
+
+    TEST_CASE("float round trip") {
+        // Samples all exponents and a spread of mantissas, including denormals
+        for (uint64_t bits = 0; bits < 0x100000000ull; bits += 65521) {
+            uint32_t u32 = (uint32_t)bits;
+            float value;
+            memcpy(&value, &u32, sizeof(value));
+            if (std::isnan(value)) {
+                continue;
+            }
+            std::string str = format(value);
+            float parsed;
+            REQUIRE(parse(str.c_str(), &parsed));
+            CHECK_MESSAGE(memcmp(&parsed, &value, sizeof(value)) == 0, str);
+            CHECK(strtof(str.c_str(), nullptr) == value);
+        }
+    }
+}
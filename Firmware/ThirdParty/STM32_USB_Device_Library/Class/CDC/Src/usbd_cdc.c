@@ -756,6 +756,10 @@ uint8_t USBD_CDC_TransmitPacket(USBD_HandleTypeDef *pdev, uint8_t* buf, size_t l
     {
       /* Tx Transfer in progress */
       hEP_Tx->State = 1;
+
+      /* Remember the length so that USBD_CDC_DataIn() can terminate a
+         transfer that ends with a full packet with a zero length packet */
+      pdev->ep_in[endpoint_num & 0xFU].total_length = len;
       
       /* Transmit next packet */
       USBD_LL_Transmit(pdev,
@@ -72,6 +72,7 @@ odrive_firmware_pkg = {
         'MotorControl/utils.cpp',
         'MotorControl/arm_sin_f32.c',
         'MotorControl/arm_cos_f32.c',
+        'MotorControl/arm_sincos_f32.c',
         'MotorControl/low_level.cpp',
         'MotorControl/axis.cpp',
         'MotorControl/motor.cpp',
@@ -85,14 +86,17 @@ odrive_firmware_pkg = {
         'MotorControl/open_loop_controller.cpp',
         'MotorControl/oscilloscope.cpp',
         'MotorControl/sensorless_estimator.cpp',
+        'MotorControl/telemetry.cpp',
         'MotorControl/trapTraj.cpp',
         'MotorControl/pwm_input.cpp',
         'MotorControl/main.cpp',
+        'MotorControl/control_loop.cpp',
         'Drivers/STM32/stm32_system.cpp',
         'Drivers/STM32/stm32_gpio.cpp',
         'Drivers/STM32/stm32_nvm.c',
         'Drivers/STM32/stm32_spi_arbiter.cpp',
         'communication/can/can_simple.cpp',
+        'communication/can/can_cyclic.cpp',
         'communication/can/odrive_can.cpp',    
         'communication/communication.cpp',
         'communication/ascii_protocol.cpp',
@@ -382,6 +386,14 @@ if tup.getconfig("NO_DRM") == "true" then
     CFLAGS += '-DNO_DRM'
 end
 
+if tup.getconfig("BATCHED_AXES") == "true" then
+    CFLAGS += '-DBATCHED_AXES'
+end
+
+if tup.getconfig("USB_CDC_TX_AGGREGATION") == "false" then
+    CFLAGS += '-DUSB_CDC_TX_AGGREGATION=0'
+end
+
 -- debug build
 if tup.getconfig("DEBUG") == "true" then
     CFLAGS += '-gdwarf-2 -Og'
@@ -450,3 +462,137 @@ if tup.getconfig('DOCTEST') == 'true' then
     tup.frule{inputs='Tests/bin/*.o', command='g++ %f -o %o', outputs='Tests/test_runner.exe'}
     tup.frule{inputs='Tests/test_runner.exe', command='%f'}
 end
+
+if tup.getconfig('SIMULATOR') == 'true' then
+    -- Host build of the control loop against a simulated board and plant.
+    -- Run build/simulator.exe to get per-task execution times.
+    SIM_FLAGS = '-O2 -DHW_VERSION_MAJOR=3 -DHW_VERSION_MINOR=6 -DHW_VERSION_VOLTAGE=56'
+    if tup.getconfig("BATCHED_AXES") == "true" then
+        SIM_FLAGS = SIM_FLAGS..' -DBATCHED_AXES'
+    end
+    SIM_INCLUDES = '-IBoard/sim/Inc -I. -IMotorControl -Ifibre-cpp/include'
+
+    function sim_compile(src_file)
+        obj_file = "build/sim/"..src_file:gsub("/","_"):gsub("%.","")..".o"
+        if src_file:sub(-2) == '.c' then
+            tup.frule{inputs={src_file}, command='gcc '..SIM_FLAGS..' '..SIM_INCLUDES..' -c %f -o %o', outputs={obj_file}}
+        else
+            tup.frule{inputs={src_file, extra_inputs={'autogen/interfaces.hpp'}}, command='g++ -std=c++17 '..SIM_FLAGS..' '..SIM_INCLUDES..' -c %f -o %o', outputs={obj_file}}
+        end
+        return obj_file
+    end
+
+    math_objs = {}
+    for _, src_file in pairs({
+        'Board/sim/sin_table.cpp',
+        'MotorControl/arm_sin_f32.c',
+        'MotorControl/arm_cos_f32.c',
+        'MotorControl/arm_sincos_f32.c',
+    }) do
+        math_objs += sim_compile(src_file)
+    end
+
+    -- Everything except the main() of simulator.exe so that other host
+    -- programs can link against the simulated board
+    sim_objs = {}
+    for _, src_file in pairs({
+        'Board/sim/board.cpp',
+        'Board/sim/sim_plant.cpp',
+        'MotorControl/utils.cpp',
+        'MotorControl/axis.cpp',
+        'MotorControl/motor.cpp',
+        'MotorControl/thermistor.cpp',
+        'MotorControl/encoder.cpp',
+        'MotorControl/endstop.cpp',
+        'MotorControl/acim_estimator.cpp',
+        'MotorControl/mechanical_brake.cpp',
+        'MotorControl/controller.cpp',
+        'MotorControl/foc.cpp',
+        'MotorControl/open_loop_controller.cpp',
+        'MotorControl/oscilloscope.cpp',
+        'MotorControl/sensorless_estimator.cpp',
+        'MotorControl/telemetry.cpp',
+        'MotorControl/trapTraj.cpp',
+        'MotorControl/control_loop.cpp',
+        'communication/can/can_cyclic.cpp',
+    }) do
+        sim_objs += sim_compile(src_file)
+    end
+    tup.append_table(sim_objs, math_objs)
+
+    simulator_objs = {sim_compile('Board/sim/sim_main.cpp')}
+    tup.append_table(simulator_objs, sim_objs)
+    tup.frule{inputs=simulator_objs, command='g++ %f -o %o', outputs='build/simulator.exe'}
+
+    -- Checks that the lock-in spin ramps up smoothly. Runs as part of the build.
+    sim_lockin_objs = {sim_compile('Board/sim/sim_lockin.cpp')}
+    tup.append_table(sim_lockin_objs, sim_objs)
+    tup.frule{inputs=sim_lockin_objs, command='g++ %f -o %o', outputs='build/sim_lockin.exe'}
+    tup.frule{inputs='build/sim_lockin.exe', command='%f'}
+
+    -- Micro-benchmarks
+    bench_sincos_objs = {sim_compile('Board/sim/bench_sincos.cpp')}
+    tup.append_table(bench_sincos_objs, math_objs)
+    tup.frule{inputs=bench_sincos_objs, command='g++ %f -o %o', outputs='build/bench_sincos.exe'}
+
+    tup.frule{inputs={sim_compile('Board/sim/bench_ports.cpp')}, command='g++ %f -o %o', outputs='build/bench_ports.exe'}
+    tup.frule{inputs={sim_compile('Board/sim/bench_can_signal.cpp')}, command='g++ %f -o %o', outputs='build/bench_can_signal.exe'}
+    tup.frule{inputs={sim_compile('Board/sim/bench_number_format.cpp')}, command='g++ %f -o %o', outputs='build/bench_number_format.exe'}
+
+    bench_can_objs = {
+        sim_compile('Board/sim/bench_can.cpp'),
+        sim_compile('Board/sim/sim_can.cpp'),
+        sim_compile('communication/can/can_simple.cpp'),
+    }
+    tup.append_table(bench_can_objs, sim_objs)
+    tup.frule{inputs=bench_can_objs, command='g++ %f -o %o', outputs='build/bench_can.exe'}
+
+    bench_ascii_objs = {
+        sim_compile('Board/sim/bench_ascii.cpp'),
+        sim_compile('communication/ascii_protocol.cpp'),
+    }
+    tup.append_table(bench_ascii_objs, sim_objs)
+    tup.frule{inputs=bench_ascii_objs, command='g++ %f -o %o', outputs='build/bench_ascii.exe'}
+
+    -- Fibre client against a simulated device that serves the real JSON
+    tup.frule{inputs={'fibre-cpp/embedded_json_template.j2', extra_inputs='odrive-interface.yaml'}, command=python_command..' interface_generator_stub.py --definitions odrive-interface.yaml --generate-endpoints '..root_interface..' --template %f --output %o', outputs='autogen/embedded_json.hpp'}
+    FIBRE_CLIENT_FLAGS = '-DFIBRE_ENABLE_CLIENT=1 -DFIBRE_ALLOW_HEAP=1'
+    function fibre_client_compile(src_file)
+        obj_file = "build/sim/fibre_client_"..src_file:gsub("/","_"):gsub("%.","")..".o"
+        tup.frule{inputs={src_file, extra_inputs={'autogen/embedded_json.hpp'}}, command='g++ -std=c++17 '..SIM_FLAGS..' '..FIBRE_CLIENT_FLAGS..' '..SIM_INCLUDES..' -c %f -o %o', outputs={obj_file}}
+        return obj_file
+    end
+    fibre_client_objs = {
+        fibre_client_compile('fibre-cpp/legacy_object_client.cpp'),
+        fibre_client_compile('fibre-cpp/legacy_protocol.cpp'),
+    }
+
+    bench_fibre_connect_objs = {fibre_client_compile('Board/sim/bench_fibre_connect.cpp')}
+    tup.append_table(bench_fibre_connect_objs, fibre_client_objs)
+    tup.frule{inputs=bench_fibre_connect_objs, command='g++ %f -o %o', outputs='build/bench_fibre_connect.exe'}
+
+    bench_json_parse_objs = {fibre_client_compile('Board/sim/bench_json_parse.cpp')}
+    tup.append_table(bench_json_parse_objs, fibre_client_objs)
+    tup.frule{inputs=bench_json_parse_objs, command='g++ %f -o %o', outputs='build/bench_json_parse.exe'}
+
+    bench_event_loop_objs = {
+        fibre_client_compile('Board/sim/bench_event_loop.cpp'),
+        fibre_client_compile('fibre-cpp/platform_support/epoll_event_loop.cpp'),
+    }
+    tup.frule{inputs=bench_event_loop_objs, command='g++ %f -pthread -o %o', outputs='build/bench_event_loop.exe'}
+
+    -- Bulk endpoints of the libusb backend against a scripted libusb. Runs as
+    -- part of the build.
+    FAKE_LIBUSB_FLAGS = FIBRE_CLIENT_FLAGS..' -IBoard/sim/fake_libusb'
+    test_libusb_endpoint_objs = {}
+    for _, src_file in pairs({
+        'Board/sim/test_libusb_endpoint.cpp',
+        'fibre-cpp/platform_support/libusb_transport.cpp',
+    }) do
+        obj_file = "build/sim/fake_libusb_"..src_file:gsub("/","_"):gsub("%.","")..".o"
+        tup.frule{inputs={src_file}, command='g++ -std=c++17 '..SIM_FLAGS..' '..FAKE_LIBUSB_FLAGS..' '..SIM_INCLUDES..' -c %f -o %o', outputs={obj_file}}
+        test_libusb_endpoint_objs += obj_file
+    end
+    tup.frule{inputs=test_libusb_endpoint_objs, command='g++ %f -o %o', outputs='build/test_libusb_endpoint.exe'}
+    tup.frule{inputs='build/test_libusb_endpoint.exe', command='%f'}
+end
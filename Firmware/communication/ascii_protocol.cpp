@@ -12,6 +12,9 @@
 #include "ascii_protocol.hpp"
 #include <utils.hpp>
 #include <fibre/cpp_utils.hpp>
+#include <fibre/simple_serdes.hpp>
+#include <fibre/number_format.hpp>
+#include <fibre/../../crc.hpp>
 
 #include "autogen/type_info.hpp"
 #include "communication/interface_can.hpp"
@@ -37,32 +40,81 @@ static Introspectable root_obj = ODrive4TypeInfo<ODrive>::make_introspectable(od
 
 /* Private function prototypes -----------------------------------------------*/
 
+// @brief Parses whitespace separated numbers from a null-terminated string,
+// like sscanf(str, "%u %f %f", ...) would.
+// @returns the number of arguments that were parsed before the first
+// argument that failed
+template<typename ... TArgs>
+static int scan_args(const char* str, TArgs* ... args) {
+    const char* end = str + strlen(str);
+    int numscan = 0;
+    auto scan_one = [&](auto* arg) {
+        if (str) {
+            str = parse_number(str, end, arg);
+            numscan += str ? 1 : 0;
+        }
+    };
+    (scan_one(args), ...);
+    return numscan;
+}
+
+// @brief Returns the next whitespace delimited token of a null-terminated
+// string or nullptr if there is none. The token is null-terminated in place
+// and `str` is advanced past it.
+static char* next_token(char** str) {
+    char* begin = *str;
+    while (*begin == ' ' || *begin == '\t')
+        ++begin;
+    char* end = begin;
+    while (*end && *end != ' ' && *end != '\t')
+        ++end;
+    *str = *end ? end + 1 : end;
+    *end = 0;
+    return *begin ? begin : nullptr;
+}
+
 /* Function implementations --------------------------------------------------*/
 
 // @brief Sends a line on the specified output.
 template<typename ... TArgs>
 void AsciiProtocol::respond(bool include_checksum, const char * fmt, TArgs&& ... args) {
     size_t len = snprintf(tx_buf_, sizeof(tx_buf_), fmt, std::forward<TArgs>(args)...);
+    send_line(include_checksum, len);
+}
 
+// @brief Sends the first `len` characters of tx_buf_ as a line.
+void AsciiProtocol::send_line(bool include_checksum, size_t len) {
     // Silently truncate the output if it's too long for the buffer.
-    len = std::min(len, sizeof(tx_buf_));
+    len = std::min(len, sizeof(tx_buf_) - 5);
 
     if (include_checksum) {
         uint8_t checksum = 0;
         for (size_t i = 0; i < len; ++i)
             checksum ^= tx_buf_[i];
-        len += snprintf(tx_buf_ + len, sizeof(tx_buf_) - len, "*%u", checksum);
+        tx_buf_[len++] = '*';
+        len += format_number(checksum, tx_buf_ + len, sizeof(tx_buf_) - len);
     } else {
-        len += snprintf(tx_buf_ + len, sizeof(tx_buf_) - len, "\r\n");
+        tx_buf_[len++] = '\r';
+        tx_buf_[len++] = '\n';
     }
 
-    // Silently truncate the output if it's too long for the buffer.
-    len = std::min(len, sizeof(tx_buf_));
-
     tx_end_ = (const uint8_t*)tx_buf_ + len;
     tx_channel_->start_write({(const uint8_t*)tx_buf_, tx_end_}, &tx_handle_, MEMBER_CB(this, on_write_finished));
 }
 
+// @brief Sends a binary frame on the specified output.
+void AsciiProtocol::respond_binary(uint8_t cmd, const uint8_t* payload, size_t len) {
+    uint8_t* buf = (uint8_t*)tx_buf_;
+    buf[0] = ASCII_BINARY_SYNC_BYTE;
+    buf[1] = cmd;
+    buf[2] = len;
+    memcpy(buf + 3, payload, len);
+    buf[3 + len] = calc_crc8<ASCII_BINARY_CRC8_POLYNOMIAL>(ASCII_BINARY_CRC8_INIT, buf + 1, len + 2);
+
+    tx_end_ = buf + 4 + len;
+    tx_channel_->start_write({buf, tx_end_}, &tx_handle_, MEMBER_CB(this, on_write_finished));
+}
+
 
 // @brief Executes an ASCII protocol command
 // @param buffer buffer of ASCII encoded characters
@@ -97,7 +149,7 @@ void AsciiProtocol::process_line(cbufptr_t buffer) {
     bool use_checksum = (checksum_start < len);
     if (use_checksum) {
         unsigned int received_checksum;
-        int numscan = sscanf(&cmd[checksum_start], "%u", &received_checksum);
+        int numscan = scan_args(&cmd[checksum_start], &received_checksum);
         if ((numscan < 1) || (received_checksum != checksum))
             return;
         len = checksum_start - 1; // prune checksum and asterisk
@@ -124,6 +176,116 @@ void AsciiProtocol::process_line(cbufptr_t buffer) {
     }
 }
 
+// @brief Executes a binary command frame
+// @param buffer received bytes, starting with the sync byte
+// @returns the number of bytes that were used up or 0 if the frame is not
+// complete yet. Invalid frames use up only the sync byte so that the parser
+// can resynchronize on the next one.
+size_t AsciiProtocol::process_binary_frame(bufptr_t buffer) {
+    if (buffer.size() < 3) {
+        return 0;
+    }
+
+    size_t payload_len = buffer[2];
+    if (payload_len > ASCII_BINARY_MAX_PAYLOAD) {
+        return 1;
+    }
+
+    size_t frame_len = payload_len + 4;
+    if (buffer.size() < frame_len) {
+        return 0;
+    }
+
+    uint8_t* payload = buffer.begin() + 3;
+    if (calc_crc8<ASCII_BINARY_CRC8_POLYNOMIAL>(ASCII_BINARY_CRC8_INIT, buffer.begin() + 1, payload_len + 2) != payload[payload_len]) {
+        return 1;
+    }
+
+    // Unknown commands and invalid arguments are ignored
+    switch (buffer[1]) {
+        case 'p': bin_set_position(payload, payload_len);     break;  // position control
+        case 'v': bin_set_velocity(payload, payload_len);     break;  // velocity control
+        case 'c': bin_set_torque(payload, payload_len);       break;  // current control
+        case 'f': bin_get_feedback(payload, payload_len);     break;  // feedback
+        default:                                              break;
+    }
+
+    return frame_len;
+}
+
+// @brief Binary version of the set position command
+// @param payload motor number (uint8) followed by position, and optionally
+// velocity feed-forward and torque feed-forward (float32 each)
+void AsciiProtocol::bin_set_position(uint8_t* payload, size_t len) {
+    if ((len != 5 && len != 9 && len != 13) || payload[0] >= AXIS_COUNT) {
+        return;
+    }
+    float pos_setpoint, vel_feed_forward, torque_feed_forward;
+    Axis& axis = axes[payload[0]];
+    axis.controller_.config_.control_mode = Controller::CONTROL_MODE_POSITION_CONTROL;
+    read_le<float>(&pos_setpoint, payload + 1);
+    axis.controller_.input_pos_ = pos_setpoint;
+    if (len >= 9) {
+        read_le<float>(&vel_feed_forward, payload + 5);
+        axis.controller_.input_vel_ = vel_feed_forward;
+    }
+    if (len >= 13) {
+        read_le<float>(&torque_feed_forward, payload + 9);
+        axis.controller_.input_torque_ = torque_feed_forward;
+    }
+    axis.controller_.input_pos_updated();
+    axis.watchdog_feed();
+}
+
+// @brief Binary version of the set velocity command
+// @param payload motor number (uint8) followed by velocity and optionally
+// torque feed-forward (float32 each)
+void AsciiProtocol::bin_set_velocity(uint8_t* payload, size_t len) {
+    if ((len != 5 && len != 9) || payload[0] >= AXIS_COUNT) {
+        return;
+    }
+    float vel_setpoint, torque_feed_forward;
+    Axis& axis = axes[payload[0]];
+    axis.controller_.config_.control_mode = Controller::CONTROL_MODE_VELOCITY_CONTROL;
+    read_le<float>(&vel_setpoint, payload + 1);
+    axis.controller_.input_vel_ = vel_setpoint;
+    if (len >= 9) {
+        read_le<float>(&torque_feed_forward, payload + 5);
+        axis.controller_.input_torque_ = torque_feed_forward;
+    }
+    axis.watchdog_feed();
+}
+
+// @brief Binary version of the set torque command
+// @param payload motor number (uint8) followed by torque (float32)
+void AsciiProtocol::bin_set_torque(uint8_t* payload, size_t len) {
+    if (len != 5 || payload[0] >= AXIS_COUNT) {
+        return;
+    }
+    float torque_setpoint;
+    Axis& axis = axes[payload[0]];
+    axis.controller_.config_.control_mode = Controller::CONTROL_MODE_TORQUE_CONTROL;
+    read_le<float>(&torque_setpoint, payload + 1);
+    axis.controller_.input_torque_ = torque_setpoint;
+    axis.watchdog_feed();
+}
+
+// @brief Binary version of the get feedback command
+// @param payload motor number (uint8)
+// Responds with an 'f' frame that contains the motor number (uint8), the
+// position and the velocity (float32 each).
+void AsciiProtocol::bin_get_feedback(uint8_t* payload, size_t len) {
+    if (len != 1 || payload[0] >= AXIS_COUNT) {
+        return;
+    }
+    Axis& axis = axes[payload[0]];
+    uint8_t response[9];
+    response[0] = payload[0];
+    write_le<float>(axis.encoder_.pos_estimate_.any().value_or(0.0f), response + 1);
+    write_le<float>(axis.encoder_.vel_estimate_.any().value_or(0.0f), response + 5);
+    respond_binary('f', response, sizeof(response));
+}
+
 // @brief Executes the set position command
 // @param pStr buffer of ASCII encoded values
 // @param response_channel reference to the stream to respond on
@@ -132,7 +294,7 @@ void AsciiProtocol::cmd_set_position(char * pStr, bool use_checksum) {
     unsigned motor_number;
     float pos_setpoint, vel_feed_forward, torque_feed_forward;
 
-    int numscan = sscanf(pStr, "p %u %f %f %f", &motor_number, &pos_setpoint, &vel_feed_forward, &torque_feed_forward);
+    int numscan = scan_args(pStr + 1, &motor_number, &pos_setpoint, &vel_feed_forward, &torque_feed_forward);
     if (numscan < 2) {
         respond(use_checksum, "invalid command format");
     } else if (motor_number >= AXIS_COUNT) {
@@ -158,7 +320,7 @@ void AsciiProtocol::cmd_set_position_wl(char * pStr, bool use_checksum) {
     unsigned motor_number;
     float pos_setpoint, vel_limit, torque_lim;
 
-    int numscan = sscanf(pStr, "q %u %f %f %f", &motor_number, &pos_setpoint, &vel_limit, &torque_lim);
+    int numscan = scan_args(pStr + 1, &motor_number, &pos_setpoint, &vel_limit, &torque_lim);
     if (numscan < 2) {
         respond(use_checksum, "invalid command format");
     } else if (motor_number >= AXIS_COUNT) {
@@ -183,7 +345,7 @@ void AsciiProtocol::cmd_set_position_wl(char * pStr, bool use_checksum) {
 void AsciiProtocol::cmd_set_velocity(char * pStr, bool use_checksum) {
     unsigned motor_number;
     float vel_setpoint, torque_feed_forward;
-    int numscan = sscanf(pStr, "v %u %f %f", &motor_number, &vel_setpoint, &torque_feed_forward);
+    int numscan = scan_args(pStr + 1, &motor_number, &vel_setpoint, &torque_feed_forward);
     if (numscan < 2) {
         respond(use_checksum, "invalid command format");
     } else if (motor_number >= AXIS_COUNT) {
@@ -206,7 +368,7 @@ void AsciiProtocol::cmd_set_torque(char * pStr, bool use_checksum) {
     unsigned motor_number;
     float torque_setpoint;
 
-    if (sscanf(pStr, "c %u %f", &motor_number, &torque_setpoint) < 2) {
+    if (scan_args(pStr + 1, &motor_number, &torque_setpoint) < 2) {
         respond(use_checksum, "invalid command format");
     } else if (motor_number >= AXIS_COUNT) {
         respond(use_checksum, "invalid motor %u", motor_number);
@@ -229,7 +391,7 @@ void AsciiProtocol::cmd_encoder(char * pStr, bool use_checksum) {
         unsigned motor_number;
         int encoder_count;
 
-        if (sscanf(pStr, "l %u %i", &motor_number, &encoder_count) < 2) {
+        if (pStr[0] != 'l' || scan_args(pStr + 1, &motor_number, &encoder_count) < 2) {
             respond(use_checksum, "invalid command format");
         } else if (motor_number >= AXIS_COUNT) {
             respond(use_checksum, "invalid motor %u", motor_number);
@@ -252,7 +414,7 @@ void AsciiProtocol::cmd_set_trapezoid_trajectory(char* pStr, bool use_checksum)
     unsigned motor_number;
     float goal_point;
 
-    if (sscanf(pStr, "t %u %f", &motor_number, &goal_point) < 2) {
+    if (scan_args(pStr + 1, &motor_number, &goal_point) < 2) {
         respond(use_checksum, "invalid command format");
     } else if (motor_number >= AXIS_COUNT) {
         respond(use_checksum, "invalid motor %u", motor_number);
@@ -273,15 +435,16 @@ void AsciiProtocol::cmd_set_trapezoid_trajectory(char* pStr, bool use_checksum)
 void AsciiProtocol::cmd_get_feedback(char * pStr, bool use_checksum) {
     unsigned motor_number;
 
-    if (sscanf(pStr, "f %u", &motor_number) < 1) {
+    if (scan_args(pStr + 1, &motor_number) < 1) {
         respond(use_checksum, "invalid command format");
     } else if (motor_number >= AXIS_COUNT) {
         respond(use_checksum, "invalid motor %u", motor_number);
     } else {
         Axis& axis = axes[motor_number];
-        respond(use_checksum, "%f %f",
-                (double)axis.encoder_.pos_estimate_.any().value_or(0.0f),
-                (double)axis.encoder_.vel_estimate_.any().value_or(0.0f));
+        size_t len = format_number(axis.encoder_.pos_estimate_.any().value_or(0.0f), tx_buf_, sizeof(tx_buf_));
+        tx_buf_[len++] = ' ';
+        len += format_number(axis.encoder_.vel_estimate_.any().value_or(0.0f), tx_buf_ + len, sizeof(tx_buf_) - len);
+        send_line(use_checksum, len);
     }
 }
 
@@ -341,19 +504,20 @@ void AsciiProtocol::cmd_system_ctrl(char * pStr, bool use_checksum) {
 // @param response_channel reference to the stream to respond on
 // @param use_checksum bool to indicate whether a checksum is required on response
 void AsciiProtocol::cmd_read_property(char * pStr, bool use_checksum) {
-    char name[MAX_LINE_LENGTH];
+    pStr += 1;
+    char* name = next_token(&pStr);
 
-    if (sscanf(pStr, "r %255s", name) < 1) {
+    if (!name) {
         respond(use_checksum, "invalid command format");
     } else {
-        Introspectable property = root_obj.get_child(name, sizeof(name));
+        Introspectable property = root_obj.get_child(name, strlen(name));
         const StringConvertibleTypeInfo* type_info = dynamic_cast<const StringConvertibleTypeInfo*>(property.get_type_info());
         if (!type_info) {
             respond(use_checksum, "invalid property");
+        } else if (type_info->get_string(property, tx_buf_, sizeof(tx_buf_) - 4)) { // leave space for the checksum
+            send_line(use_checksum, strlen(tx_buf_));
         } else {
-            char response[10];
-            bool success = type_info->get_string(property, response, sizeof(response));
-            respond(use_checksum, success ? response : "not implemented");
+            respond(use_checksum, "not implemented");
         }
     }
 }
@@ -363,18 +527,19 @@ void AsciiProtocol::cmd_read_property(char * pStr, bool use_checksum) {
 // @param response_channel reference to the stream to respond on
 // @param use_checksum bool to indicate whether a checksum is required on response
 void AsciiProtocol::cmd_write_property(char * pStr, bool use_checksum) {
-    char name[MAX_LINE_LENGTH];
-    char value[MAX_LINE_LENGTH];
+    pStr += 1;
+    char* name = next_token(&pStr);
+    char* value = next_token(&pStr);
 
-    if (sscanf(pStr, "w %255s %255s", name, value) < 1) {
+    if (!name || !value) {
         respond(use_checksum, "invalid command format");
     } else {
-        Introspectable property = root_obj.get_child(name, sizeof(name));
+        Introspectable property = root_obj.get_child(name, strlen(name));
         const StringConvertibleTypeInfo* type_info = dynamic_cast<const StringConvertibleTypeInfo*>(property.get_type_info());
         if (!type_info) {
             respond(use_checksum, "invalid property");
         } else {
-            bool success = type_info->set_string(property, value, sizeof(value));
+            bool success = type_info->set_string(property, value, strlen(value));
             if (!success) {
                 respond(use_checksum, "not implemented");
             }
@@ -389,7 +554,7 @@ void AsciiProtocol::cmd_write_property(char * pStr, bool use_checksum) {
 void AsciiProtocol::cmd_update_axis_wdg(char * pStr, bool use_checksum) {
     unsigned motor_number;
 
-    if (sscanf(pStr, "u %u", &motor_number) < 1) {
+    if (scan_args(pStr + 1, &motor_number) < 1) {
         respond(use_checksum, "invalid command format");
     } else if (motor_number >= AXIS_COUNT) {
         respond(use_checksum, "invalid motor %u", motor_number);
@@ -431,14 +596,43 @@ void AsciiProtocol::on_read_finished(ReadResult result) {
     }
 
     for (;;) {
+        if (read_active_ && result.end > rx_buf_ && rx_buf_[0] == ASCII_BINARY_SYNC_BYTE) {
+            if (tx_handle_) {
+                // TX is busy - inhibit processing of the incoming data until
+                // on_write_finished() is invoked.
+                rx_end_ = result.end;
+                return;
+            }
+
+            size_t frame_len = process_binary_frame({rx_buf_, result.end});
+            if (!frame_len) {
+                break; // wait for the rest of the frame
+            }
+
+            size_t n_remaining = result.end - rx_buf_ - frame_len;
+            memmove(rx_buf_, rx_buf_ + frame_len, n_remaining);
+            result.end = rx_buf_ + n_remaining;
+            continue;
+        }
+
         uint8_t* end_of_line = std::find_if(rx_buf_, result.end, [](uint8_t c) {
-            return c == '\r' || c == '\n' || c == '!';
+            return c == '\r' || c == '\n' || c == '!' || c == ASCII_BINARY_SYNC_BYTE;
         });
 
         if (end_of_line >= result.end) {
             break;
         }
 
+        if (*end_of_line == ASCII_BINARY_SYNC_BYTE) {
+            // A binary frame interrupts the current line (e.g. after a
+            // corrupted frame). Drop the incomplete line and resynchronize.
+            size_t n_remaining = result.end - end_of_line;
+            memmove(rx_buf_, end_of_line, n_remaining);
+            result.end = rx_buf_ + n_remaining;
+            read_active_ = true;
+            continue;
+        }
+
         if (read_active_) {
             if (tx_handle_) {
                 // TX is busy - inhibit processing of the incoming data until
@@ -5,6 +5,14 @@
 
 #define MAX_LINE_LENGTH ((size_t)256)
 
+// Binary frames share the stream with the ASCII lines. A frame starts with
+// the sync byte, which is not a valid ASCII character, at the start of a line:
+// [sync] [cmd] [payload length] [payload] [CRC-8 of cmd, length and payload]
+#define ASCII_BINARY_SYNC_BYTE ((uint8_t)0xa5)
+#define ASCII_BINARY_MAX_PAYLOAD ((size_t)16)
+#define ASCII_BINARY_CRC8_POLYNOMIAL 0x37 // same as the native protocol
+#define ASCII_BINARY_CRC8_INIT 0x42
+
 class AsciiProtocol {
 public:
     AsciiProtocol(fibre::AsyncStreamSource* rx_channel, fibre::AsyncStreamSink* tx_channel)
@@ -28,8 +36,16 @@ private:
     void cmd_unknown(char * pStr, bool use_checksum);
     void cmd_encoder(char * pStr, bool use_checksum);
 
+    void bin_set_position(uint8_t* payload, size_t len);
+    void bin_set_velocity(uint8_t* payload, size_t len);
+    void bin_set_torque(uint8_t* payload, size_t len);
+    void bin_get_feedback(uint8_t* payload, size_t len);
+
     template<typename ... TArgs> void respond(bool include_checksum, const char * fmt, TArgs&& ... args);
+    void send_line(bool include_checksum, size_t len);
+    void respond_binary(uint8_t cmd, const uint8_t* payload, size_t len);
     void process_line(fibre::cbufptr_t buffer);
+    size_t process_binary_frame(fibre::bufptr_t buffer);
     void on_write_finished(fibre::WriteResult result);
     void on_read_finished(fibre::ReadResult result);
 
@@ -0,0 +1,183 @@
+
+#include "can_cyclic.hpp"
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+template<typename T, uint8_t kStartByte>
+static void encode_signal(can_Message_t& frame, float raw) {
+    using Desc = can_SignalDesc<T, 8 * kStartByte, 8 * sizeof(T)>;
+    if constexpr (std::is_floating_point_v<T>) {
+        Desc::set_raw(frame, raw);
+    } else {
+        // Saturate instead of wrapping around. NaN is sent as 0.
+        constexpr float min = (float)std::numeric_limits<T>::min();
+        constexpr float max = (float)std::numeric_limits<T>::max();
+        T val = (raw >= max) ? std::numeric_limits<T>::max()
+              : (raw > min) ? (T)std::llround(raw)
+              : (raw <= min) ? std::numeric_limits<T>::min()
+              : (T)0;
+        Desc::set_raw(frame, val);
+    }
+}
+
+// One encoder for each start byte at which a T fits into the frame
+template<typename T, size_t... kStartBytes>
+static constexpr std::array<void(*)(can_Message_t&, float), sizeof...(kStartBytes)> make_encoders(std::index_sequence<kStartBytes...>) {
+    return {&encode_signal<T, kStartBytes>...};
+}
+
+template<typename T>
+static constexpr auto encoders = make_encoders<T>(std::make_index_sequence<9 - sizeof(T)>());
+
+template<typename T>
+static void (*get_encoder_for(uint8_t start_byte, uint8_t* size))(can_Message_t&, float) {
+    *size = sizeof(T);
+    return start_byte < encoders<T>.size() ? encoders<T>[start_byte] : nullptr;
+}
+
+CanCyclicTx::SignalEncoder CanCyclicTx::get_encoder(SignalType type, uint8_t start_byte, uint8_t* size) {
+    switch (type) {
+        case ODriveIntf::CanIntf::CYCLIC_SIGNAL_TYPE_FLOAT32: return get_encoder_for<float>(start_byte, size);
+        case ODriveIntf::CanIntf::CYCLIC_SIGNAL_TYPE_INT32: return get_encoder_for<int32_t>(start_byte, size);
+        case ODriveIntf::CanIntf::CYCLIC_SIGNAL_TYPE_UINT32: return get_encoder_for<uint32_t>(start_byte, size);
+        case ODriveIntf::CanIntf::CYCLIC_SIGNAL_TYPE_INT16: return get_encoder_for<int16_t>(start_byte, size);
+        case ODriveIntf::CanIntf::CYCLIC_SIGNAL_TYPE_UINT16: return get_encoder_for<uint16_t>(start_byte, size);
+        case ODriveIntf::CanIntf::CYCLIC_SIGNAL_TYPE_INT8: return get_encoder_for<int8_t>(start_byte, size);
+        case ODriveIntf::CanIntf::CYCLIC_SIGNAL_TYPE_UINT8: return get_encoder_for<uint8_t>(start_byte, size);
+        default: return nullptr;
+    }
+}
+
+bool CanCyclicTx::start(const MessageConfig_t (&config)[CAN_CYCLIC_MAX_MESSAGES]) {
+    // Stop sending first. update() runs at a higher priority than this
+    // function so it won't see the half-updated settings below.
+    active_ = false;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+
+    uses_sync_ = false;
+
+    for (size_t i = 0; i < CAN_CYCLIC_MAX_MESSAGES; ++i) {
+        Message& msg = messages_[i];
+        msg.trigger = config[i].trigger;
+        msg.n_signals = 0;
+        msg.frame = {};
+
+        if (msg.trigger == ODriveIntf::CanIntf::CYCLIC_TRIGGER_NONE) {
+            continue;
+        }
+
+        uint8_t len = 0;
+        for (size_t j = 0; j < CAN_CYCLIC_MAX_SIGNALS; ++j) {
+            const SignalConfig_t& signal_config = config[i].signals[j];
+            Signal& signal = msg.signals[j];
+            if (!signal_config.endpoint.endpoint_id) {
+                break;
+            }
+            if (!fibre::get_float_readable_endpoint(signal_config.endpoint, &signal.endpoint)) {
+                return false;
+            }
+            uint8_t size;
+            signal.encode = get_encoder(signal_config.type, signal_config.start_byte, &size);
+            if (!signal.encode || signal_config.factor == 0.0f) {
+                return false;
+            }
+            signal.type_info = dynamic_cast<const FloatGettableTypeInfo*>(signal.endpoint.get_type_info());
+            signal.factor = signal_config.factor;
+            signal.offset = signal_config.offset;
+            len = std::max<uint8_t>(len, signal_config.start_byte + size);
+            msg.n_signals++;
+        }
+
+        msg.frame.id = config[i].id;
+        msg.frame.isExt = config[i].is_extended;
+        msg.frame.rtr = false;
+        msg.frame.len = len;
+        msg.period = std::max<uint32_t>(config[i].period, 1);
+        msg.period_cnt = 0;
+        uses_sync_ = uses_sync_ || (msg.trigger == ODriveIntf::CanIntf::CYCLIC_TRIGGER_SYNC);
+    }
+
+    last_n_sync_ = n_sync_;
+    n_overruns_ = 0;
+
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    active_ = true;
+    return true;
+}
+
+void CanCyclicTx::stop() {
+    active_ = false;
+}
+
+void CanCyclicTx::on_sync() {
+    n_sync_++;
+}
+
+bool CanCyclicTx::update() {
+    if (!active_) {
+        return false;
+    }
+
+    uint32_t n_sync = n_sync_;
+    uint32_t n_new_sync = n_sync - last_n_sync_;
+    last_n_sync_ = n_sync;
+
+    bool any_due = false;
+
+    for (Message& msg: messages_) {
+        uint32_t n_ticks = (msg.trigger == ODriveIntf::CanIntf::CYCLIC_TRIGGER_CONTROL_LOOP) ? 1
+                         : (msg.trigger == ODriveIntf::CanIntf::CYCLIC_TRIGGER_SYNC) ? n_new_sync
+                         : 0;
+        if (!n_ticks) {
+            continue;
+        }
+
+        msg.period_cnt += n_ticks;
+        if (msg.period_cnt < msg.period) {
+            continue;
+        }
+        msg.period_cnt = 0;
+
+        if (msg.pending) {
+            n_overruns_++;
+            continue;
+        }
+
+        for (size_t i = 0; i < msg.n_signals; ++i) {
+            Signal& signal = msg.signals[i];
+            float val;
+            if (!signal.type_info->get_float(signal.endpoint, &val)) {
+                val = NAN;
+            }
+            signal.encode(msg.frame, (val - signal.offset) / signal.factor);
+        }
+
+        // Publish the frame to the CAN thread
+        std::atomic_signal_fence(std::memory_order_release);
+        msg.pending = true;
+        any_due = true;
+    }
+
+    return any_due;
+}
+
+void CanCyclicTx::send_pending(CanBusBase& bus) {
+    for (Message& msg: messages_) {
+        if (!msg.pending) {
+            continue;
+        }
+        std::atomic_signal_fence(std::memory_order_acquire);
+
+        if (!bus.send_latest(msg.frame)) {
+            return;
+        }
+
+        // Hand the slot back to update()
+        std::atomic_signal_fence(std::memory_order_release);
+        msg.pending = false;
+    }
+}
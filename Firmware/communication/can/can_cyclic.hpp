@@ -0,0 +1,115 @@
+#ifndef __CAN_CYCLIC_HPP
+#define __CAN_CYCLIC_HPP
+
+#include "canbus.hpp"
+#include <autogen/interfaces.hpp>
+#include <fibre/introspection.hpp>
+
+#define CAN_CYCLIC_MAX_MESSAGES 8
+
+// Four 16 bit signals fill a classic CAN frame
+#define CAN_CYCLIC_MAX_SIGNALS 4
+
+/**
+ * @brief Sends a table of messages with values sampled in the control loop.
+ *
+ * Each message carries up to CAN_CYCLIC_MAX_SIGNALS values. Every signal has
+ * its own type, start byte and linear scaling and is encoded little endian
+ * (Intel) with a can_SignalDesc. A message is sent either every `period`
+ * control loop iterations or on every `period`-th SYNC message. All messages that are due
+ * in the same iteration are sampled at the same point of the control loop,
+ * so a master that sends a SYNC to all nodes receives values that were taken
+ * within one control period of each other.
+ *
+ * update() samples the values in the control loop and the CAN thread sends
+ * them with send_pending(). Every message has a single slot: only update()
+ * sets `pending` and only send_pending() clears it. If the previous frame of
+ * a message was not sent yet when the next one is due, the new one is
+ * dropped and counted in n_overruns_.
+ */
+class CanCyclicTx {
+public:
+    using Trigger = ODriveIntf::CanIntf::CyclicTrigger;
+    using SignalType = ODriveIntf::CanIntf::CyclicSignalType;
+
+    struct SignalConfig_t {
+        endpoint_ref_t endpoint = {}; // The first unset signal ends the list
+        SignalType type = ODriveIntf::CanIntf::CYCLIC_SIGNAL_TYPE_FLOAT32;
+        uint8_t start_byte = 0;
+        float factor = 1.0f; // value = raw * factor + offset
+        float offset = 0.0f;
+    };
+
+    struct MessageConfig_t {
+        uint32_t id = 0;
+        bool is_extended = false;
+        Trigger trigger = ODriveIntf::CanIntf::CYCLIC_TRIGGER_NONE;
+        uint32_t period = 1; // [control loop iterations or SYNC messages]
+        SignalConfig_t signals[CAN_CYCLIC_MAX_SIGNALS];
+    };
+
+    /**
+     * @brief Latches the message table from the configuration.
+     * @returns false if a signal refers to a value that can't be sampled,
+     * doesn't fit into the 8 data bytes or has a factor of 0. In this case no
+     * message is sent.
+     */
+    bool start(const MessageConfig_t (&config)[CAN_CYCLIC_MAX_MESSAGES]);
+    void stop();
+
+    /**
+     * @brief Makes the SYNC triggered messages count one SYNC. The messages
+     * that become due are sampled in the next control loop iteration.
+     * Can be called from an interrupt.
+     */
+    void on_sync();
+
+    /**
+     * @brief Samples the messages that are due. Must be called once per
+     * control loop iteration.
+     * @returns true if a message is ready to be sent.
+     */
+    bool update();
+
+    /**
+     * @brief Sends the messages that were sampled by update(). Stops at the
+     * first message that the bus doesn't accept.
+     */
+    void send_pending(CanBusBase& bus);
+
+    bool uses_sync() const { return uses_sync_; }
+
+    bool active_ = false;
+    uint32_t n_sync_ = 0; // only modified by on_sync()
+    uint32_t n_overruns_ = 0;
+
+private:
+    // Writes the raw value (value - offset) / factor into the frame
+    using SignalEncoder = void(*)(can_Message_t& frame, float raw);
+
+    struct Signal {
+        Introspectable endpoint;
+        const FloatGettableTypeInfo* type_info = nullptr;
+        SignalEncoder encode = nullptr;
+        float factor = 1.0f;
+        float offset = 0.0f;
+    };
+
+    struct Message {
+        can_Message_t frame;
+        Trigger trigger = ODriveIntf::CanIntf::CYCLIC_TRIGGER_NONE;
+        uint32_t period = 1;
+        uint32_t period_cnt = 0; // only modified by update()
+        uint8_t n_signals = 0;
+        Signal signals[CAN_CYCLIC_MAX_SIGNALS];
+        bool pending = false;
+    };
+
+    static SignalEncoder get_encoder(SignalType type, uint8_t start_byte, uint8_t* size);
+
+    Message messages_[CAN_CYCLIC_MAX_MESSAGES];
+    bool uses_sync_ = false;
+    uint32_t last_n_sync_ = 0; // only modified by update()
+};
+
+#endif // __CAN_CYCLIC_HPP
@@ -4,6 +4,8 @@
 #include <algorithm>
 #include <cstring>
 #include <iterator>
+#include <ratio>
+#include <type_traits>
 
 struct can_Message_t {
     uint32_t id = 0x000;  // 11-bit max is 0x7ff, 29-bit max is 0x1FFFFFFF
@@ -94,4 +96,83 @@ float can_getSignal(can_Message_t msg, const can_Signal_t& signal) {
 template <typename T>
 void can_setSignal(can_Message_t& msg, const T& val, const can_Signal_t& signal) {
     can_setSignal(msg, val, signal.startBit, signal.length, signal.isIntel, signal.factor, signal.offset);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Compile-time description of a signal in a CAN message.
+ *
+ * Decodes and encodes the same bits as can_getSignal() / can_setSignal()
+ * with the same arguments, but since all positions and masks are template
+ * parameters, get() and set() compile to a few shifts and masks on the
+ * message buffer instead of copying and reversing it on every call.
+ *
+ * Factor and Offset are std::ratio. If either of them is not the identity,
+ * get() returns the physical value (raw * Factor + Offset) as float and set()
+ * takes a float.
+ *
+ * Example:
+ *   using InputVel = can_SignalDesc<int16_t, 32, 16, true, std::ratio<1, 1000>>;
+ *   float vel = InputVel::get(msg);
+ */
+template <typename T, uint8_t startBit, uint8_t length, bool isIntel = true,
+          typename Factor = std::ratio<1>, typename Offset = std::ratio<0>>
+struct can_SignalDesc {
+    static_assert(length > 0 && startBit + length <= 64, "signal must be within the 8 data bytes");
+    static_assert(sizeof(T) <= sizeof(uint64_t) && std::is_trivially_copyable_v<T>, "unsupported signal type");
+
+    static constexpr bool is_scaled = !std::ratio_equal_v<Factor, std::ratio<1>> || !std::ratio_equal_v<Offset, std::ratio<0>>;
+    using raw_type = T;
+    using value_type = std::conditional_t<is_scaled, float, T>;
+
+    static constexpr uint64_t mask = length < 64 ? (1ULL << length) - 1ULL : -1ULL;
+
+    // Position of the LSB in the data bytes read as little endian (Intel) or
+    // big endian (Motorola) uint64
+    static constexpr uint8_t shift = isIntel ? startBit : 64 - startBit - length;
+
+    static constexpr float factor = (float)Factor::num / (float)Factor::den;
+    static constexpr float offset = (float)Offset::num / (float)Offset::den;
+
+    static inline T get_raw(const can_Message_t& msg) {
+        uint64_t bits = (load(msg) >> shift) & mask;
+        T val;
+        std::memcpy(&val, &bits, sizeof(T));
+        return val;
+    }
+
+    static inline void set_raw(can_Message_t& msg, const T& val) {
+        uint64_t bits = 0;
+        std::memcpy(&bits, &val, sizeof(T));
+        uint64_t data = load(msg);
+        data = (data & ~(mask << shift)) | ((bits & mask) << shift);
+        store(msg, data);
+    }
+
+    static inline value_type get(const can_Message_t& msg) {
+        if constexpr (is_scaled) {
+            return (get_raw(msg) * factor) + offset;
+        } else {
+            return get_raw(msg);
+        }
+    }
+
+    static inline void set(can_Message_t& msg, const value_type& val) {
+        if constexpr (is_scaled) {
+            set_raw(msg, static_cast<T>((val - offset) / factor));
+        } else {
+            set_raw(msg, val);
+        }
+    }
+
+private:
+    static inline uint64_t load(const can_Message_t& msg) {
+        uint64_t data;
+        std::memcpy(&data, msg.buf, sizeof(data));
+        return isIntel ? data : __builtin_bswap64(data);
+    }
+
+    static inline void store(can_Message_t& msg, uint64_t data) {
+        data = isIntel ? data : __builtin_bswap64(data);
+        std::memcpy(msg.buf, &data, sizeof(data));
+    }
+};
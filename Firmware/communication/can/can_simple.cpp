@@ -3,6 +3,72 @@
 
 #include <odrive_main.h>
 
+namespace {
+
+template <typename T, uint8_t startBit, uint8_t length, typename Factor = std::ratio<1>>
+using Signal = can_SignalDesc<T, startBit, length, true, Factor>;
+
+// Signal layouts of the CANSimple messages (see docs/can-protocol.md)
+namespace Msg {
+    struct Heartbeat {
+        using AxisError = Signal<Axis::Error, 0, 32>;
+        using AxisState = Signal<Axis::AxisState, 32, 32>;
+    };
+    struct GetMotorError { using MotorError = Signal<Motor::Error, 0, 64>; };
+    struct GetEncoderError { using EncoderError = Signal<Encoder::Error, 0, 32>; };
+    struct GetSensorlessError { using SensorlessError = Signal<SensorlessEstimator::Error, 0, 32>; };
+    struct SetAxisNodeId { using NodeId = Signal<uint32_t, 0, 32>; };
+    struct SetAxisRequestedState { using RequestedState = Signal<int32_t, 0, 16>; };
+    struct GetEncoderEstimates {
+        using PosEstimate = Signal<float, 0, 32>;
+        using VelEstimate = Signal<float, 32, 32>;
+    };
+    struct GetEncoderCount {
+        using ShadowCount = Signal<int32_t, 0, 32>;
+        using CountInCpr = Signal<int32_t, 32, 32>;
+    };
+    struct SetControllerModes {
+        using ControlMode = Signal<int32_t, 0, 32>;
+        using InputMode = Signal<int32_t, 32, 32>;
+    };
+    struct SetInputPos {
+        using InputPos = Signal<float, 0, 32>;
+        using VelFF = Signal<int16_t, 32, 16, std::milli>;
+        using TorqueFF = Signal<int16_t, 48, 16, std::milli>;
+    };
+    struct SetInputVel {
+        using InputVel = Signal<float, 0, 32>;
+        using TorqueFF = Signal<float, 32, 32>;
+    };
+    struct SetInputTorque { using InputTorque = Signal<float, 0, 32>; };
+    struct SetLimits {
+        using VelLimit = Signal<float, 0, 32>;
+        using CurrentLimit = Signal<float, 32, 32>;
+    };
+    struct SetTrajVelLimit { using TrajVelLimit = Signal<float, 0, 32>; };
+    struct SetTrajAccelLimits {
+        using AccelLimit = Signal<float, 0, 32>;
+        using DecelLimit = Signal<float, 32, 32>;
+    };
+    struct SetTrajInertia { using Inertia = Signal<float, 0, 32>; };
+    struct GetSensorlessEstimates {
+        using PosEstimate = Signal<float, 0, 32>;
+        using VelEstimate = Signal<float, 32, 32>;
+    };
+    struct GetIq {
+        using IdSetpoint = Signal<float, 0, 32>;
+        using IqSetpoint = Signal<float, 32, 32>;
+    };
+    struct GetVbusVoltage { using VbusVoltage = Signal<float, 0, 32>; };
+    struct SetLinearCount { using Count = Signal<int32_t, 0, 32>; };
+    struct SetMultiAxisInput {
+        using Axis0 = Signal<float, 0, 32>;
+        using Axis1 = Signal<float, 32, 32>;
+    };
+}
+
+}
+
 bool CANSimple::init() {
     for (size_t i = 0; i < AXIS_COUNT; ++i) {
         if (!renew_subscription(i)) {
@@ -34,9 +100,17 @@ bool CANSimple::renew_subscription(size_t i) {
         canbus_->unsubscribe(subscription_handles_[i]);
     }
 
-    return canbus_->subscribe(filter, [](void* ctx, const can_Message_t& msg) {
+    if (!canbus_->subscribe(filter, [](void* ctx, const can_Message_t& msg) {
         ((CANSimple*)ctx)->handle_can_message(msg);
-    }, this, &subscription_handles_[i]);
+    }, this, &subscription_handles_[i])) {
+        return false;
+    }
+
+    // Setpoints are applied right in the RX interrupt if the bus supports it
+    canbus_->set_isr_callback(subscription_handles_[i], [](void* ctx, const can_Message_t& msg) {
+        return handle_can_message_isr(msg);
+    });
+    return true;
 }
 
 void CANSimple::handle_can_message(const can_Message_t& msg) {
@@ -53,6 +127,37 @@ void CANSimple::handle_can_message(const can_Message_t& msg) {
     }
 }
 
+/**
+ * @brief Handles time-critical setpoint messages in the CAN RX interrupt.
+ * 
+ * This only touches the input variables of the controller which are also
+ * written by other interfaces at a lower priority than the control loop.
+ * 
+ * @returns: true if the message was handled or false if it must be handled
+ * by handle_can_message() in the CAN thread.
+ */
+bool CANSimple::handle_can_message_isr(const can_Message_t& msg) {
+    uint32_t cmd = get_cmd_id(msg.id);
+    if (msg.rtr || (cmd != MSG_SET_INPUT_POS && cmd != MSG_SET_INPUT_VEL && cmd != MSG_SET_INPUT_TORQUE && cmd != MSG_SET_MULTI_AXIS_INPUT)) {
+        return false;
+    }
+
+    uint32_t nodeID = get_node_id(msg.id);
+    for (auto& axis : axes) {
+        if ((axis.config_.can.node_id == nodeID) && (axis.config_.can.is_extended == msg.isExt)) {
+            axis.watchdog_feed();
+            switch (cmd) {
+                case MSG_SET_INPUT_POS: set_input_pos_callback(axis, msg); break;
+                case MSG_SET_INPUT_VEL: set_input_vel_callback(axis, msg); break;
+                case MSG_SET_INPUT_TORQUE: set_input_torque_callback(axis, msg); break;
+                case MSG_SET_MULTI_AXIS_INPUT: set_multi_axis_input_callback(msg); break;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
 void CANSimple::do_command(Axis& axis, const can_Message_t& msg) {
     const uint32_t cmd = get_cmd_id(msg.id);
     axis.watchdog_feed();
@@ -141,6 +246,12 @@ void CANSimple::do_command(Axis& axis, const can_Message_t& msg) {
         case MSG_CLEAR_ERRORS:
             clear_errors_callback(axis, msg);
             break;
+        case MSG_SET_LINEAR_COUNT:
+            set_linear_count_callback(axis, msg);
+            break;
+        case MSG_SET_MULTI_AXIS_INPUT:
+            set_multi_axis_input_callback(msg);
+            break;
         default:
             break;
     }
@@ -161,7 +272,7 @@ bool CANSimple::get_motor_error_callback(const Axis& axis) {
     txmsg.isExt = axis.config_.can.is_extended;
     txmsg.len = 8;
 
-    can_setSignal(txmsg, axis.motor_.error_, 0, 64, true);
+    Msg::GetMotorError::MotorError::set(txmsg, axis.motor_.error_);
 
     return canbus_->send_message(txmsg);
 }
@@ -173,7 +284,7 @@ bool CANSimple::get_encoder_error_callback(const Axis& axis) {
     txmsg.isExt = axis.config_.can.is_extended;
     txmsg.len = 8;
 
-    can_setSignal(txmsg, axis.encoder_.error_, 0, 32, true);
+    Msg::GetEncoderError::EncoderError::set(txmsg, axis.encoder_.error_);
 
     return canbus_->send_message(txmsg);
 }
@@ -185,17 +296,17 @@ bool CANSimple::get_sensorless_error_callback(const Axis& axis) {
     txmsg.isExt = axis.config_.can.is_extended;
     txmsg.len = 8;
 
-    can_setSignal(txmsg, axis.sensorless_estimator_.error_, 0, 32, true);
+    Msg::GetSensorlessError::SensorlessError::set(txmsg, axis.sensorless_estimator_.error_);
 
     return canbus_->send_message(txmsg);
 }
 
 void CANSimple::set_axis_nodeid_callback(Axis& axis, const can_Message_t& msg) {
-    axis.config_.can.node_id = can_getSignal<uint32_t>(msg, 0, 32, true);
+    axis.config_.can.node_id = Msg::SetAxisNodeId::NodeId::get(msg);
 }
 
 void CANSimple::set_axis_requested_state_callback(Axis& axis, const can_Message_t& msg) {
-    axis.requested_state_ = static_cast<Axis::AxisState>(can_getSignal<int32_t>(msg, 0, 16, true));
+    axis.requested_state_ = static_cast<Axis::AxisState>(Msg::SetAxisRequestedState::RequestedState::get(msg));
 }
 
 void CANSimple::set_axis_startup_config_callback(Axis& axis, const can_Message_t& msg) {
@@ -209,10 +320,11 @@ bool CANSimple::get_encoder_estimates_callback(const Axis& axis) {
     txmsg.isExt = axis.config_.can.is_extended;
     txmsg.len = 8;
 
-    can_setSignal<float>(txmsg, axis.encoder_.pos_estimate_.any().value_or(0.0f), 0, 32, true);
-    can_setSignal<float>(txmsg, axis.encoder_.vel_estimate_.any().value_or(0.0f), 32, 32, true);
+    Msg::GetEncoderEstimates::PosEstimate::set(txmsg, axis.encoder_.pos_estimate_.any().value_or(0.0f));
+    Msg::GetEncoderEstimates::VelEstimate::set(txmsg, axis.encoder_.vel_estimate_.any().value_or(0.0f));
 
-    return canbus_->send_message(txmsg);
+    // Only the newest estimate is worth sending if the bus is congested
+    return canbus_->send_latest(txmsg);
 }
 
 bool CANSimple::get_sensorless_estimates_callback(const Axis& axis) {
@@ -224,8 +336,8 @@ bool CANSimple::get_sensorless_estimates_callback(const Axis& axis) {
 
     static_assert(sizeof(float) == sizeof(axis.sensorless_estimator_.pll_pos_));
 
-    can_setSignal<float>(txmsg, axis.sensorless_estimator_.pll_pos_, 0, 32, true);
-    can_setSignal<float>(txmsg, axis.sensorless_estimator_.vel_estimate_.any().value_or(0.0f), 32, 32, true);
+    Msg::GetSensorlessEstimates::PosEstimate::set(txmsg, axis.sensorless_estimator_.pll_pos_);
+    Msg::GetSensorlessEstimates::VelEstimate::set(txmsg, axis.sensorless_estimator_.vel_estimate_.any().value_or(0.0f));
 
     return canbus_->send_message(txmsg);
 }
@@ -237,35 +349,35 @@ bool CANSimple::get_encoder_count_callback(const Axis& axis) {
     txmsg.isExt = axis.config_.can.is_extended;
     txmsg.len = 8;
 
-    can_setSignal<int32_t>(txmsg, axis.encoder_.shadow_count_, 0, 32, true);
-    can_setSignal<int32_t>(txmsg, axis.encoder_.count_in_cpr_, 32, 32, true);
+    Msg::GetEncoderCount::ShadowCount::set(txmsg, axis.encoder_.shadow_count_);
+    Msg::GetEncoderCount::CountInCpr::set(txmsg, axis.encoder_.count_in_cpr_);
     return canbus_->send_message(txmsg);
 }
 
 void CANSimple::set_input_pos_callback(Axis& axis, const can_Message_t& msg) {
-    axis.controller_.input_pos_ = can_getSignal<float>(msg, 0, 32, true);
-    axis.controller_.input_vel_ = can_getSignal<int16_t>(msg, 32, 16, true, 0.001f, 0);
-    axis.controller_.input_torque_ = can_getSignal<int16_t>(msg, 48, 16, true, 0.001f, 0);
+    axis.controller_.input_pos_ = Msg::SetInputPos::InputPos::get(msg);
+    axis.controller_.input_vel_ = Msg::SetInputPos::VelFF::get(msg);
+    axis.controller_.input_torque_ = Msg::SetInputPos::TorqueFF::get(msg);
     axis.controller_.input_pos_updated();
 }
 
 void CANSimple::set_input_vel_callback(Axis& axis, const can_Message_t& msg) {
-    axis.controller_.input_vel_ = can_getSignal<float>(msg, 0, 32, true);
-    axis.controller_.input_torque_ = can_getSignal<float>(msg, 32, 32, true);
+    axis.controller_.input_vel_ = Msg::SetInputVel::InputVel::get(msg);
+    axis.controller_.input_torque_ = Msg::SetInputVel::TorqueFF::get(msg);
 }
 
 void CANSimple::set_input_torque_callback(Axis& axis, const can_Message_t& msg) {
-    axis.controller_.input_torque_ = can_getSignal<float>(msg, 0, 32, true);
+    axis.controller_.input_torque_ = Msg::SetInputTorque::InputTorque::get(msg);
 }
 
 void CANSimple::set_controller_modes_callback(Axis& axis, const can_Message_t& msg) {
-    axis.controller_.config_.control_mode = static_cast<Controller::ControlMode>(can_getSignal<int32_t>(msg, 0, 32, true));
-    axis.controller_.config_.input_mode = static_cast<Controller::InputMode>(can_getSignal<int32_t>(msg, 32, 32, true));
+    axis.controller_.config_.control_mode = static_cast<Controller::ControlMode>(Msg::SetControllerModes::ControlMode::get(msg));
+    axis.controller_.config_.input_mode = static_cast<Controller::InputMode>(Msg::SetControllerModes::InputMode::get(msg));
 }
 
 void CANSimple::set_limits_callback(Axis& axis, const can_Message_t& msg) {
-    axis.controller_.config_.vel_limit = can_getSignal<float>(msg, 0, 32, true);
-    axis.motor_.config_.current_lim = can_getSignal<float>(msg, 32, 32, true);
+    axis.controller_.config_.vel_limit = Msg::SetLimits::VelLimit::get(msg);
+    axis.motor_.config_.current_lim = Msg::SetLimits::CurrentLimit::get(msg);
 }
 
 void CANSimple::start_anticogging_callback(const Axis& axis, const can_Message_t& msg) {
@@ -273,20 +385,46 @@ void CANSimple::start_anticogging_callback(const Axis& axis, const can_Message_t
 }
 
 void CANSimple::set_traj_vel_limit_callback(Axis& axis, const can_Message_t& msg) {
-    axis.trap_traj_.config_.vel_limit = can_getSignal<float>(msg, 0, 32, true);
+    axis.trap_traj_.config_.vel_limit = Msg::SetTrajVelLimit::TrajVelLimit::get(msg);
 }
 
 void CANSimple::set_traj_accel_limits_callback(Axis& axis, const can_Message_t& msg) {
-    axis.trap_traj_.config_.accel_limit = can_getSignal<float>(msg, 0, 32, true);
-    axis.trap_traj_.config_.decel_limit = can_getSignal<float>(msg, 32, 32, true);
+    axis.trap_traj_.config_.accel_limit = Msg::SetTrajAccelLimits::AccelLimit::get(msg);
+    axis.trap_traj_.config_.decel_limit = Msg::SetTrajAccelLimits::DecelLimit::get(msg);
 }
 
 void CANSimple::set_traj_inertia_callback(Axis& axis, const can_Message_t& msg) {
-    axis.controller_.config_.inertia = can_getSignal<float>(msg, 0, 32, true);
+    axis.controller_.config_.inertia = Msg::SetTrajInertia::Inertia::get(msg);
 }
 
 void CANSimple::set_linear_count_callback(Axis& axis, const can_Message_t& msg){
-    axis.encoder_.set_linear_count(can_getSignal<int32_t>(msg, 0, 32, true));
+    axis.encoder_.set_linear_count(Msg::SetLinearCount::Count::get(msg));
+}
+
+/**
+ * @brief Sets the inputs of the first two axes from one message.
+ * 
+ * Each axis gets one float32 (axis0 at byte 0, axis1 at byte 4) which is
+ * used as input_pos, input_vel or input_torque depending on the axis' control
+ * mode. Both axes are updated in the same control loop iteration.
+ */
+void CANSimple::set_multi_axis_input_callback(const can_Message_t& msg) {
+    constexpr size_t n_axes = std::min<size_t>(AXIS_COUNT, 2);
+    const float values[2] = {Msg::SetMultiAxisInput::Axis0::get(msg), Msg::SetMultiAxisInput::Axis1::get(msg)};
+
+    // Keep the control loop from running in between the two axes
+    CRITICAL_SECTION() {
+        for (size_t i = 0; i < n_axes; ++i) {
+            Controller& controller = axes[i].controller_;
+            switch (controller.config_.control_mode) {
+                case Controller::CONTROL_MODE_POSITION_CONTROL: controller.set_input_pos(values[i]); break;
+                case Controller::CONTROL_MODE_VELOCITY_CONTROL: controller.input_vel_ = values[i]; break;
+                case Controller::CONTROL_MODE_TORQUE_CONTROL: controller.input_torque_ = values[i]; break;
+                default: break;
+            }
+            axes[i].watchdog_feed();
+        }
+    }
 }
 
 bool CANSimple::get_iq_callback(const Axis& axis) {
@@ -303,8 +441,8 @@ bool CANSimple::get_iq_callback(const Axis& axis) {
     
     static_assert(sizeof(float) == sizeof(Idq_setpoint->first));
     static_assert(sizeof(float) == sizeof(Idq_setpoint->second));
-    can_setSignal<float>(txmsg, Idq_setpoint->first, 0, 32, true);
-    can_setSignal<float>(txmsg, Idq_setpoint->second, 32, 32, true);
+    Msg::GetIq::IdSetpoint::set(txmsg, Idq_setpoint->first);
+    Msg::GetIq::IqSetpoint::set(txmsg, Idq_setpoint->second);
 
     return canbus_->send_message(txmsg);
 }
@@ -319,7 +457,7 @@ bool CANSimple::get_vbus_voltage_callback(const Axis& axis) {
 
     uint32_t floatBytes;
     static_assert(sizeof(vbus_voltage) == sizeof(floatBytes));
-    can_setSignal<float>(txmsg, vbus_voltage, 0, 32, true);
+    Msg::GetVbusVoltage::VbusVoltage::set(txmsg, vbus_voltage);
 
     return canbus_->send_message(txmsg);
 }
@@ -375,8 +513,8 @@ bool CANSimple::send_heartbeat(const Axis& axis) {
     txmsg.isExt = axis.config_.can.is_extended;
     txmsg.len = 8;
 
-    can_setSignal(txmsg, axis.error_, 0, 32, true);
-    can_setSignal(txmsg, axis.current_state_, 32, 32, true);
+    Msg::Heartbeat::AxisError::set(txmsg, axis.error_);
+    Msg::Heartbeat::AxisState::set(txmsg, axis.current_state_);
 
-    return canbus_->send_message(txmsg);
+    return canbus_->send_heartbeat(txmsg);
 }
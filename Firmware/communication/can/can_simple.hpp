@@ -32,6 +32,8 @@ class CANSimple {
         MSG_RESET_ODRIVE,
         MSG_GET_VBUS_VOLTAGE,
         MSG_CLEAR_ERRORS,
+        MSG_SET_LINEAR_COUNT,
+        MSG_SET_MULTI_AXIS_INPUT,
         MSG_CO_HEARTBEAT_CMD = 0x700,  // CANOpen NMT Heartbeat  SEND
     };
 
@@ -46,6 +48,7 @@ class CANSimple {
     bool send_heartbeat(const Axis& axis);
 
     void handle_can_message(const can_Message_t& msg);
+    static bool handle_can_message_isr(const can_Message_t& msg);
 
     void do_command(Axis& axis, const can_Message_t& cmd);
     
@@ -73,6 +76,7 @@ class CANSimple {
     static void set_traj_accel_limits_callback(Axis& axis, const can_Message_t& msg);
     static void set_traj_inertia_callback(Axis& axis, const can_Message_t& msg);
     static void set_linear_count_callback(Axis& axis, const can_Message_t& msg);
+    static void set_multi_axis_input_callback(const can_Message_t& msg);
 
     // Other functions
     static void nmt_callback(const Axis& axis, const can_Message_t& msg);
@@ -93,7 +97,7 @@ class CANSimple {
     }
 
     CanBusBase* canbus_;
-    CanBusBase::CanSubscription* subscription_handles_[AXIS_COUNT];
+    CanBusBase::CanSubscription* subscription_handles_[AXIS_COUNT] = {};
 
     // TODO: we this is a hack but actually we should use protocol hooks to
     // renew our filter when the node ID changes
@@ -0,0 +1,152 @@
+#ifndef __CAN_TX_QUEUE_HPP
+#define __CAN_TX_QUEUE_HPP
+
+#include "can_helpers.hpp"
+#include <stddef.h>
+
+/**
+ * @brief Software queue for outgoing CAN frames that hands out the frame
+ * which would win the bus arbitration first.
+ *
+ * Frames with the same arbitration priority leave the queue in the order in
+ * which they were pushed. A frame that is pushed with `coalesce` set replaces
+ * a queued frame with the same ID and `keep` setting that was also pushed
+ * with `coalesce`, so
+ * that only the newest value of a periodic message is sent. The new frame
+ * takes the place of the newest queued frame with that ID so that it never
+ * overtakes a frame that was pushed after the replaced one.
+ *
+ * If the queue is full, the lowest priority frame that was not pushed with
+ * `keep` set is dropped. This is either the new frame or a queued frame.
+ * Frames pushed with `keep` set (heartbeats) are only dropped if the whole
+ * queue is taken up by such frames. They should also be coalesced so that
+ * there's at most one of them per ID.
+ *
+ * The queue is not thread safe. The caller must make sure that push() and
+ * pop() are not interrupted by each other.
+ */
+template<size_t N>
+class CanTxQueue {
+public:
+    /**
+     * @brief Returns a number that is lower for frames that win the
+     * arbitration against frames with a higher number.
+     *
+     * The bits are in the order in which they appear on the bus: the base ID,
+     * then RTR (standard frame) or SRR (extended frame, always recessive),
+     * IDE, the ID extension and the RTR bit of an extended frame.
+     */
+    static constexpr uint32_t arbitration_key(const can_Message_t& msg) {
+        uint32_t base_id = msg.isExt ? (msg.id >> 18) & 0x7ff : msg.id & 0x7ff;
+        uint32_t id_ext = msg.isExt ? msg.id & 0x3ffff : 0;
+        bool bit_after_base_id = msg.isExt ? true : msg.rtr;
+        return (base_id << 21) | ((uint32_t)bit_after_base_id << 20) | ((uint32_t)msg.isExt << 19)
+             | (id_ext << 1) | (uint32_t)(msg.isExt && msg.rtr);
+    }
+
+    /**
+     * @brief Queues a frame.
+     * @param coalesce: Replace a queued frame with the same ID that was also
+     *        pushed with `coalesce` and the same `keep` setting.
+     * @param keep: Never drop this frame to make room for another frame.
+     * @returns false if the frame was dropped because the queue is full.
+     */
+    bool push(const can_Message_t& msg, bool coalesce, bool keep = false) {
+        uint32_t key = arbitration_key(msg);
+
+        // The entries are sorted by descending key so that pop() takes the
+        // last one. Among the entries with the same key the newest one comes
+        // first.
+        size_t pos = 0;
+        while (pos < size_ && entries_[pos].key > key) {
+            pos++;
+        }
+
+        if (coalesce) {
+            for (size_t i = pos; i < size_ && entries_[i].key == key; ++i) {
+                if (entries_[i].coalesce && entries_[i].keep == keep) {
+                    // Move the replaced entry to the place of the newest
+                    // frame with this key
+                    for (; i > pos; --i) {
+                        entries_[i] = entries_[i - 1];
+                    }
+                    entries_[pos] = {msg, key, coalesce, keep};
+                    n_coalesced_++;
+                    return true;
+                }
+            }
+        }
+
+        if (size_ >= N) {
+            n_dropped_++;
+            // Lowest priority frame that may be dropped
+            size_t victim = 0;
+            while (victim < size_ && entries_[victim].keep) {
+                victim++;
+            }
+            if (victim == size_ || (!keep && key >= entries_[victim].key)) {
+                return false;
+            }
+            for (size_t i = victim + 1; i < size_; ++i) {
+                entries_[i - 1] = entries_[i];
+            }
+            size_--;
+            if (victim < pos) {
+                pos--;
+            }
+        }
+
+        for (size_t i = size_; i > pos; --i) {
+            entries_[i] = entries_[i - 1];
+        }
+        entries_[pos] = {msg, key, coalesce, keep};
+        size_++;
+        return true;
+    }
+
+    /**
+     * @brief Returns the frame with the highest priority without removing it
+     * or nullptr if the queue is empty.
+     *
+     * The pointer is valid until the next call to push(), pop() or clear().
+     */
+    const can_Message_t* front() const {
+        return size_ ? &entries_[size_ - 1].msg : nullptr;
+    }
+
+    /**
+     * @brief Removes the frame with the highest priority from the queue.
+     * @param msg: Receives the removed frame unless nullptr.
+     * @returns false if the queue is empty.
+     */
+    bool pop(can_Message_t* msg = nullptr) {
+        if (!size_) {
+            return false;
+        }
+        --size_;
+        if (msg) {
+            *msg = entries_[size_].msg;
+        }
+        return true;
+    }
+
+    void clear() { size_ = 0; }
+    size_t size() const { return size_; }
+    bool full() const { return size_ >= N; }
+
+    uint32_t n_coalesced_ = 0; // Frames that replaced a queued frame
+    uint32_t n_dropped_ = 0; // Frames that were dropped because the queue was full
+
+private:
+    struct Entry {
+        can_Message_t msg;
+        uint32_t key;
+        bool coalesce;
+        bool keep;
+    };
+
+    Entry entries_[N];
+    size_t size_ = 0;
+};
+
+#endif // __CAN_TX_QUEUE_HPP
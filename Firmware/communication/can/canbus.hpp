@@ -12,6 +12,7 @@ struct MsgIdFilterSpecs {
 class CanBusBase {
 public:
     typedef void(*on_can_message_cb_t)(void* ctx, const can_Message_t& message);
+    typedef bool(*on_can_message_isr_cb_t)(void* ctx, const can_Message_t& message);
     struct CanSubscription {};
 
     /**
@@ -22,6 +23,29 @@ public:
      */
     virtual bool send_message(const can_Message_t& message) = 0;
 
+    /**
+     * @brief Sends a message that supersedes all earlier messages with the
+     * same ID, such as a periodic status message.
+     * 
+     * If an earlier message with the same ID that was also sent with
+     * send_latest() is still waiting in the send queue, its payload is
+     * replaced instead of sending both.
+     * 
+     * @returns: true on success or false otherwise.
+     */
+    virtual bool send_latest(const can_Message_t& message) { return send_message(message); }
+
+    /**
+     * @brief Sends a heartbeat message.
+     * 
+     * Behaves like send_latest() but the message is never dropped from the
+     * send queue to make room for other messages, regardless of their
+     * priority.
+     * 
+     * @returns: true on success or false otherwise.
+     */
+    virtual bool send_heartbeat(const can_Message_t& message) { return send_latest(message); }
+
     /**
      * @brief Registers a callback that will be invoked for every incoming CAN
      * message that matches the filter.
@@ -38,6 +62,20 @@ public:
      * @brief Deregisters a callback that was previously registered with subscribe().
      */
     virtual bool unsubscribe(CanSubscription* handle) = 0;
+
+    /**
+     * @brief Registers an additional callback for a subscription that is
+     * invoked directly in the RX interrupt, before the message is handed to
+     * the regular callback.
+     * 
+     * The ISR callback must be short and must not block. It returns true if it
+     * consumed the message or false to pass the message on to the regular
+     * callback. Passing nullptr removes the ISR callback.
+     * 
+     * @returns: true on success or false if the bus doesn't support ISR
+     * callbacks.
+     */
+    virtual bool set_isr_callback(CanSubscription* handle, on_can_message_isr_cb_t callback) { return false; }
 };
 
 #endif // __CANBUS_HPP
\ No newline at end of file
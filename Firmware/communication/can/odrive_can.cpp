@@ -5,6 +5,7 @@
 
 #include "freertos_vars.h"
 #include "utils.hpp"
+#include <odrive_main.h>
 
 // Safer context handling via maps instead of arrays
 // #include <unordered_map>
@@ -27,6 +28,8 @@ bool ODriveCAN::reinit() {
 
 bool ODriveCAN::start_server(CAN_HandleTypeDef* handle) {
     handle_ = handle;
+    isr_fast_path_ = config_.enable_isr_fast_path;
+    update_filter_lut();
 
     handle_->Init.Prescaler = CAN_FREQ / config_.baud_rate;
     if (!reinit()) {
@@ -49,21 +52,29 @@ void ODriveCAN::can_server_thread() {
         can_simple_.init();
     }
 
+    start_cyclic_messages();
+
     for (;;) {
         uint32_t status = HAL_CAN_GetError(handle_);
         if (status == HAL_CAN_ERROR_NONE) {
             uint32_t next_service_time = UINT32_MAX;
 
+            cyclic_tx_.send_pending(*this);
+            update_sync_subscription();
+
             if (protocol & PROTOCOL_SIMPLE) {
                 next_service_time = std::min(can_simple_.service_stack(), next_service_time);
             }
 
+            // Keep the RX interrupt from reading the FIFOs at the same time
+            HAL_CAN_DeactivateNotification(handle_, CAN_IT_RX_FIFO0_MSG_PENDING | CAN_IT_RX_FIFO1_MSG_PENDING);
             process_rx_fifo(CAN_RX_FIFO0);
             process_rx_fifo(CAN_RX_FIFO1);
             HAL_CAN_ActivateNotification(handle_, CAN_IT_RX_FIFO0_MSG_PENDING | CAN_IT_RX_FIFO1_MSG_PENDING | CAN_IT_TX_MAILBOX_EMPTY);
 
-            // wait at least 1ms to prevent busy-spin on failed sends
-            osSemaphoreWait(sem_can, std::max(next_service_time, 1UL));
+            // Sends only fail if the TX queue is full. In that case wait for
+            // the TX interrupt to make room instead of busy-spinning.
+            osSemaphoreWait(sem_can, tx_queue_.full() ? std::max(next_service_time, 1UL) : next_service_time);
         } else if (status == HAL_CAN_ERROR_TIMEOUT) {
             HAL_CAN_ResetError(handle_);
             status = HAL_CAN_Start(handle_);
@@ -73,6 +84,57 @@ void ODriveCAN::can_server_thread() {
     }
 }
 
+bool ODriveCAN::start_cyclic_messages() {
+    return cyclic_tx_.start(config_.cyclic_messages);
+}
+
+void ODriveCAN::stop_cyclic_messages() {
+    cyclic_tx_.stop();
+}
+
+/**
+ * @brief Wakes up the CAN thread to send the messages that cyclic_tx_ sampled.
+ * Called from the control loop.
+ */
+void ODriveCAN::notify_tx() {
+    osSemaphoreRelease(sem_can);
+}
+
+/**
+ * @brief Subscribes to SYNC messages while a cyclic message needs them.
+ * 
+ * Runs on the CAN thread so that the subscriptions are only ever modified
+ * by one thread.
+ */
+void ODriveCAN::update_sync_subscription() {
+    bool needs_sync = cyclic_tx_.active_ && cyclic_tx_.uses_sync();
+
+    if (sync_subscription_ && (!needs_sync || sync_id_ != config_.sync_id)) {
+        unsubscribe(sync_subscription_);
+        sync_subscription_ = nullptr;
+    }
+
+    if (needs_sync && !sync_subscription_) {
+        sync_id_ = config_.sync_id;
+        MsgIdFilterSpecs filter = {
+            .id = (uint16_t)sync_id_,
+            .mask = 0x7ff
+        };
+        auto on_sync = [](void* ctx, const can_Message_t& msg) {
+            ((ODriveCAN*)ctx)->cyclic_tx_.on_sync();
+        };
+        auto on_sync_isr = [](void* ctx, const can_Message_t& msg) {
+            ((ODriveCAN*)ctx)->cyclic_tx_.on_sync();
+            return true;
+        };
+        if (subscribe(filter, on_sync, this, &sync_subscription_)) {
+            set_isr_callback(sync_subscription_, on_sync_isr);
+        } else {
+            sync_subscription_ = nullptr;
+        }
+    }
+}
+
 // Set one of only a few common baud rates.  CAN doesn't do arbitrary baud rates well due to the time-quanta issue.
 // 21 TQ allows for easy sampling at exactly 80% (recommended by Vector Informatik GmbH for high reliability systems)
 // Conveniently, the CAN peripheral's 42MHz clock lets us easily create 21TQs for all common baud rates
@@ -103,46 +165,155 @@ void ODriveCAN::process_rx_fifo(uint32_t fifo) {
         rxmsg.len = header.DLC;
         rxmsg.rtr = header.RTR;
 
-        // TODO: this could be optimized with an ahead-of-time computed
-        // index-to-filter map
+        ODriveCanSubscription* subscription = get_subscription(fifo, header.FilterMatchIndex);
+        if (subscription) {
+            subscription->callback(subscription->ctx, rxmsg);
+        }
+    }
+}
+
+ODriveCAN::ODriveCanSubscription* ODriveCAN::get_subscription(uint32_t fifo, uint32_t filter_match_index) {
+    if (fifo > CAN_RX_FIFO1 || filter_match_index >= kMaxSubscriptions) {
+        return nullptr;
+    }
+    uint8_t index = filter_lut_[fifo][filter_match_index];
+    if (index == kNoSubscription) {
+        return nullptr;
+    }
+    ODriveCanSubscription& subscription = subscriptions_[index];
+    return (subscription.fifo == fifo) ? &subscription : nullptr;
+}
 
-        size_t fifo0_idx = 0;
-        size_t fifo1_idx = 0;
+void ODriveCAN::update_filter_lut() {
+    uint8_t lut[2][kMaxSubscriptions];
+    size_t n_filters[2] = {0, 0};
 
-        // Find the triggered subscription item based on header.FilterMatchIndex
-        auto it = std::find_if(subscriptions_.begin(), subscriptions_.end(), [&](auto& s) {
-            size_t current_idx = (s.fifo == 0 ? fifo0_idx : fifo1_idx)++;
-            return (header.FilterMatchIndex == current_idx) && (s.fifo == fifo);
-        });
+    std::fill_n(&lut[0][0], 2 * kMaxSubscriptions, kNoSubscription);
+    for (size_t i = 0; i < kMaxSubscriptions; ++i) {
+        uint8_t bank_fifo = subscriptions_[i].filter_bank_fifo;
+        lut[bank_fifo][n_filters[bank_fifo]++] = i;
+    }
+
+    // The RX interrupt might look up a subscription in the meantime
+    CRITICAL_SECTION() {
+        std::copy_n(&lut[0][0], 2 * kMaxSubscriptions, &filter_lut_[0][0]);
+    }
+}
 
-        if (it == subscriptions_.end()) {
-            continue;
+/**
+ * @brief Handles a pending RX FIFO interrupt.
+ * 
+ * If the ISR fast path is enabled, the messages are handed to the ISR
+ * callbacks of their subscriptions until the first message that is not
+ * consumed. All remaining messages are left in the FIFO for the CAN thread
+ * so that the order of messages is preserved.
+ */
+void ODriveCAN::on_rx_pending_isr(CAN_HandleTypeDef* hcan, uint32_t fifo) {
+    if (isr_fast_path_ && hcan == handle_) {
+        while (HAL_CAN_GetRxFifoFillLevel(handle_, fifo)) {
+            // Look at the message without releasing it from the FIFO
+            const CAN_FIFOMailBox_TypeDef& mailbox = handle_->Instance->sFIFOMailBox[fifo];
+            can_Message_t rxmsg;
+            rxmsg.isExt = mailbox.RIR & CAN_RI0R_IDE;
+            rxmsg.id = rxmsg.isExt ?
+                       (mailbox.RIR & (CAN_RI0R_EXID | CAN_RI0R_STID)) >> CAN_RI0R_EXID_Pos :
+                       (mailbox.RIR & CAN_RI0R_STID) >> CAN_RI0R_STID_Pos;
+            rxmsg.rtr = mailbox.RIR & CAN_RI0R_RTR;
+            rxmsg.len = (mailbox.RDTR & CAN_RDT0R_DLC) >> CAN_RDT0R_DLC_Pos;
+            uint32_t data[2] = {mailbox.RDLR, mailbox.RDHR};
+            std::memcpy(rxmsg.buf, data, sizeof(rxmsg.buf));
+
+            ODriveCanSubscription* subscription = get_subscription(fifo, (mailbox.RDTR & CAN_RDT0R_FMI) >> CAN_RDT0R_FMI_Pos);
+            on_can_message_isr_cb_t isr_callback = subscription ? subscription->isr_callback : nullptr;
+            if (!isr_callback || !isr_callback(subscription->ctx, rxmsg)) {
+                break;
+            }
+
+            if (fifo == CAN_RX_FIFO0) {
+                SET_BIT(handle_->Instance->RF0R, CAN_RF0R_RFOM0);
+            } else {
+                SET_BIT(handle_->Instance->RF1R, CAN_RF1R_RFOM1);
+            }
         }
 
-        it->callback(it->ctx, rxmsg);
+        if (!HAL_CAN_GetRxFifoFillLevel(handle_, fifo)) {
+            return;
+        }
     }
+
+    HAL_CAN_DeactivateNotification(hcan, fifo == CAN_RX_FIFO0 ? CAN_IT_RX_FIFO0_MSG_PENDING : CAN_IT_RX_FIFO1_MSG_PENDING);
+    osSemaphoreRelease(sem_can);
+}
+
+bool ODriveCAN::send_message(const can_Message_t& txmsg) {
+    return enqueue_tx(txmsg, false, false);
 }
 
-// Send a CAN message on the bus
-bool ODriveCAN::send_message(const can_Message_t &txmsg) {
+bool ODriveCAN::send_latest(const can_Message_t& txmsg) {
+    return enqueue_tx(txmsg, true, false);
+}
+
+bool ODriveCAN::send_heartbeat(const can_Message_t& txmsg) {
+    return enqueue_tx(txmsg, true, true);
+}
+
+/**
+ * @brief Puts a message into the TX queue and moves as many queued messages
+ * as possible into the hardware mailboxes.
+ * 
+ * The remaining messages are moved by on_tx_mailbox_empty_isr() as soon as a
+ * mailbox becomes free. The bxCAN peripheral sends the mailboxes in the order
+ * of their IDs, so a high priority message waits for at most one frame that
+ * is already on the bus plus the mailboxes with a higher priority.
+ */
+bool ODriveCAN::enqueue_tx(const can_Message_t& txmsg, bool coalesce, bool keep) {
     if (HAL_CAN_GetError(handle_) != HAL_CAN_ERROR_NONE) {
         return false;
     }
 
-    CAN_TxHeaderTypeDef header;
-    header.StdId = txmsg.id;
-    header.ExtId = txmsg.id;
-    header.IDE = txmsg.isExt ? CAN_ID_EXT : CAN_ID_STD;
-    header.RTR = CAN_RTR_DATA;
-    header.DLC = txmsg.len;
-    header.TransmitGlobalTime = FunctionalState::DISABLE;
+    bool queued;
+    CRITICAL_SECTION() {
+        queued = tx_queue_.push(txmsg, coalesce, keep);
+        fill_tx_mailboxes();
+    }
+    return queued;
+}
 
-    uint32_t retTxMailbox = 0;
-    if (!HAL_CAN_GetTxMailboxesFreeLevel(handle_)) {
-        return false;
+// Must be called from the CAN TX interrupt or with the CAN interrupts masked
+void ODriveCAN::fill_tx_mailboxes() {
+    const can_Message_t* txmsg;
+    while (HAL_CAN_GetTxMailboxesFreeLevel(handle_) && (txmsg = tx_queue_.front())) {
+        CAN_TxHeaderTypeDef header;
+        header.StdId = txmsg->id;
+        header.ExtId = txmsg->id;
+        header.IDE = txmsg->isExt ? CAN_ID_EXT : CAN_ID_STD;
+        header.RTR = CAN_RTR_DATA;
+        header.DLC = txmsg->len;
+        header.TransmitGlobalTime = FunctionalState::DISABLE;
+
+        // The frame stays queued if the peripheral refuses it (e.g. because
+        // it's not started). It's retried on the next enqueue_tx() or
+        // mailbox empty interrupt.
+        uint32_t retTxMailbox = 0;
+        if (HAL_CAN_AddTxMessage(handle_, &header, (uint8_t*)txmsg->buf, &retTxMailbox) != HAL_OK) {
+            break;
+        }
+        tx_queue_.pop();
+    }
+}
+
+void ODriveCAN::on_tx_mailbox_empty_isr(CAN_HandleTypeDef* hcan) {
+    if (hcan != handle_) {
+        return;
+    }
+
+    bool was_full = tx_queue_.full();
+    fill_tx_mailboxes();
+
+    // The CAN thread waits for this if it couldn't queue a message
+    if (was_full) {
+        osSemaphoreRelease(sem_can);
     }
-    
-    return HAL_CAN_AddTxMessage(handle_, &header, (uint8_t*)txmsg.buf, &retTxMailbox) == HAL_OK;
 }
 
 //void ODriveCAN::set_error(Error error) {
@@ -159,8 +330,10 @@ bool ODriveCAN::subscribe(const MsgIdFilterSpecs& filter, on_can_message_cb_t ca
     }
 
     it->callback = callback;
+    it->isr_callback = nullptr;
     it->ctx = ctx;
     it->fifo = CAN_RX_FIFO0; // TODO: make customizable
+    it->filter_bank_fifo = it->fifo;
     if (handle) {
         *handle = &*it;
     }
@@ -186,6 +359,7 @@ bool ODriveCAN::subscribe(const MsgIdFilterSpecs& filter, on_can_message_cb_t ca
     if (HAL_CAN_ConfigFilter(handle_, &hal_filter) != HAL_OK) {
         return false;
     }
+    update_filter_lut();
     return true;
 }
 
@@ -194,41 +368,63 @@ bool ODriveCAN::unsubscribe(CanSubscription* handle) {
     if (subscription < subscriptions_.begin() || subscription >= subscriptions_.end()) {
         return false;
     }
-    if (subscription->fifo != kCanFifoNone) {
+    if (subscription->fifo == kCanFifoNone) {
         return false; // not in use
     }
 
     subscription->fifo = kCanFifoNone;
+    update_filter_lut();
 
     CAN_FilterTypeDef hal_filter = {};
     hal_filter.FilterActivation = DISABLE;
+    hal_filter.FilterBank = subscription - &subscriptions_[0];
+    hal_filter.FilterFIFOAssignment = subscription->filter_bank_fifo;
+    hal_filter.FilterMode = CAN_FILTERMODE_IDMASK;
+    hal_filter.FilterScale = CAN_FILTERSCALE_32BIT;
     return HAL_CAN_ConfigFilter(handle_, &hal_filter) == HAL_OK;
 }
 
+bool ODriveCAN::set_isr_callback(CanSubscription* handle, on_can_message_isr_cb_t callback) {
+    ODriveCanSubscription* subscription = static_cast<ODriveCanSubscription*>(handle);
+    if (subscription < subscriptions_.begin() || subscription >= subscriptions_.end()) {
+        return false;
+    }
+    if (subscription->fifo == kCanFifoNone) {
+        return false; // not in use
+    }
+
+    subscription->isr_callback = callback;
+    return true;
+}
+
 void HAL_CAN_TxMailbox0CompleteCallback(CAN_HandleTypeDef *hcan) {
-    HAL_CAN_DeactivateNotification(hcan, CAN_IT_TX_MAILBOX_EMPTY);
-    osSemaphoreRelease(sem_can);
+    odrv.can_.on_tx_mailbox_empty_isr(hcan);
 }
 void HAL_CAN_TxMailbox1CompleteCallback(CAN_HandleTypeDef *hcan) {
-    HAL_CAN_DeactivateNotification(hcan, CAN_IT_TX_MAILBOX_EMPTY);
-    osSemaphoreRelease(sem_can);
+    odrv.can_.on_tx_mailbox_empty_isr(hcan);
 }
 void HAL_CAN_TxMailbox2CompleteCallback(CAN_HandleTypeDef *hcan) {
-    HAL_CAN_DeactivateNotification(hcan, CAN_IT_TX_MAILBOX_EMPTY);
-    osSemaphoreRelease(sem_can);
+    odrv.can_.on_tx_mailbox_empty_isr(hcan);
+}
+void HAL_CAN_TxMailbox0AbortCallback(CAN_HandleTypeDef *hcan) {
+    odrv.can_.on_tx_mailbox_empty_isr(hcan);
+}
+void HAL_CAN_TxMailbox1AbortCallback(CAN_HandleTypeDef *hcan) {
+    odrv.can_.on_tx_mailbox_empty_isr(hcan);
+}
+void HAL_CAN_TxMailbox2AbortCallback(CAN_HandleTypeDef *hcan) {
+    odrv.can_.on_tx_mailbox_empty_isr(hcan);
 }
-void HAL_CAN_TxMailbox0AbortCallback(CAN_HandleTypeDef *hcan) {}
-void HAL_CAN_TxMailbox1AbortCallback(CAN_HandleTypeDef *hcan) {}
-void HAL_CAN_TxMailbox2AbortCallback(CAN_HandleTypeDef *hcan) {}
 void HAL_CAN_RxFifo0MsgPendingCallback(CAN_HandleTypeDef *hcan) {
-    HAL_CAN_DeactivateNotification(hcan, CAN_IT_RX_FIFO0_MSG_PENDING);
-    osSemaphoreRelease(sem_can);
+    odrv.can_.on_rx_pending_isr(hcan, CAN_RX_FIFO0);
 }
 void HAL_CAN_RxFifo0FullCallback(CAN_HandleTypeDef *hcan) {
     HAL_CAN_DeactivateNotification(hcan, CAN_IT_RX_FIFO1_MSG_PENDING);
     osSemaphoreRelease(sem_can);
 }
-void HAL_CAN_RxFifo1MsgPendingCallback(CAN_HandleTypeDef *hcan) {}
+void HAL_CAN_RxFifo1MsgPendingCallback(CAN_HandleTypeDef *hcan) {
+    odrv.can_.on_rx_pending_isr(hcan, CAN_RX_FIFO1);
+}
 void HAL_CAN_RxFifo1FullCallback(CAN_HandleTypeDef *hcan) {}
 void HAL_CAN_SleepCallback(CAN_HandleTypeDef *hcan) {}
 void HAL_CAN_WakeUpFromRxMsgCallback(CAN_HandleTypeDef *hcan) {}
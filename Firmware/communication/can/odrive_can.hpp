@@ -5,6 +5,8 @@
 
 #include "canbus.hpp"
 #include "can_simple.hpp"
+#include "can_cyclic.hpp"
+#include "can_tx_queue.hpp"
 #include <autogen/interfaces.hpp>
 
 #define CAN_CLK_HZ (42000000)
@@ -24,6 +26,9 @@ public:
     struct Config_t {
         uint32_t baud_rate = CAN_BAUD_250K;
         Protocol protocol = PROTOCOL_SIMPLE;
+        bool enable_isr_fast_path = false; // latched when the CAN server is started
+        uint32_t sync_id = 0x080; // CANopen SYNC
+        CanCyclicTx::MessageConfig_t cyclic_messages[CAN_CYCLIC_MAX_MESSAGES];
 
         ODriveCAN* parent = nullptr; // set in apply_config()
         void set_baud_rate(uint32_t value) { parent->set_baud_rate(value); }
@@ -33,21 +38,32 @@ public:
 
     bool apply_config();
     bool start_server(CAN_HandleTypeDef* handle);
+    void on_rx_pending_isr(CAN_HandleTypeDef* hcan, uint32_t fifo);
+    void on_tx_mailbox_empty_isr(CAN_HandleTypeDef* hcan);
+    bool start_cyclic_messages() override;
+    void stop_cyclic_messages() override;
+    void notify_tx();
 
     Error error_ = ERROR_NONE;
 
     Config_t config_;
     CANSimple can_simple_{this};
+    CanCyclicTx cyclic_tx_;
+    CanTxQueue<16> tx_queue_; // only accessed with the CAN interrupts masked
 
     osThreadId thread_id_;
     const uint32_t stack_size_ = 1024;  // Bytes
 
 private:
     static const uint8_t kCanFifoNone = 0xff;
+    static const uint8_t kNoSubscription = 0xff;
+    static const size_t kMaxSubscriptions = 8;
 
     struct ODriveCanSubscription : CanSubscription {
         uint8_t fifo = kCanFifoNone;
+        uint8_t filter_bank_fifo = 0; // FIFO assignment of the filter bank (reset value: FIFO0), kept when the subscription is released
         on_can_message_cb_t callback;
+        on_can_message_isr_cb_t isr_callback = nullptr;
         void* ctx;
     };
 
@@ -55,14 +71,34 @@ private:
     void can_server_thread();
     bool set_baud_rate(uint32_t baud_rate);
     void process_rx_fifo(uint32_t fifo);
+    void update_filter_lut();
+    void update_sync_subscription();
+    ODriveCanSubscription* get_subscription(uint32_t fifo, uint32_t filter_match_index);
     bool send_message(const can_Message_t& message) final;
+    bool send_latest(const can_Message_t& message) final;
+    bool send_heartbeat(const can_Message_t& message) final;
+    bool enqueue_tx(const can_Message_t& message, bool coalesce, bool keep);
+    void fill_tx_mailboxes();
     bool subscribe(const MsgIdFilterSpecs& filter, on_can_message_cb_t callback, void* ctx, CanSubscription** handle) final;
     bool unsubscribe(CanSubscription* handle) final;
+    bool set_isr_callback(CanSubscription* handle, on_can_message_isr_cb_t callback) final;
 
     // Hardware supports at most 28 filters unless we do optimizations. For now
-    // we don't need that many.
-    std::array<ODriveCanSubscription, 8> subscriptions_;
+    // we don't need that many. Subscription i uses filter bank i.
+    std::array<ODriveCanSubscription, kMaxSubscriptions> subscriptions_;
+
+    // Maps the FilterMatchIndex of a received message to the index of the
+    // subscription that it belongs to. The filter match index counts the
+    // filter banks that are assigned to the same FIFO, regardless of whether
+    // they are active. Unused entries are kNoSubscription. Rebuilt by
+    // update_filter_lut().
+    uint8_t filter_lut_[2][kMaxSubscriptions] = {};
+
     CAN_HandleTypeDef *handle_ = nullptr;
+    bool isr_fast_path_ = false;
+
+    CanSubscription* sync_subscription_ = nullptr;
+    uint32_t sync_id_ = 0; // ID of sync_subscription_
 };
 
 #endif  // __ODRIVE_CAN_HPP
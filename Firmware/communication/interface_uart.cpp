@@ -13,12 +13,15 @@
 #include <odrive_main.h>
 
 #define UART_TX_BUFFER_SIZE 64
-#define UART_RX_BUFFER_SIZE 64
+#define UART_RX_BUFFER_SIZE 256
 
-// DMA open loop continous circular buffer
-// 1ms delay periodic, chase DMA ptr around
+// DMA continuous circular buffer. The UART thread chases the DMA pointer
+// whenever the DMA reaches the middle or the end of the buffer or the line
+// goes idle after a burst of bytes. The received bytes are copied into the
+// buffer of the pending read (see Stm32UartRxStream::did_receive()).
 static uint8_t dma_rx_buffer[UART_RX_BUFFER_SIZE];
 static uint32_t dma_last_rcv_idx;
+static volatile bool uart_rx_pending = false;
 
 osThreadId uart_thread = 0;
 static UART_HandleTypeDef* huart_ = nullptr;
@@ -43,7 +46,7 @@ class Stm32UartRxStream : public AsyncStreamSource {
 public:
     void start_read(bufptr_t buffer, TransferHandle* handle, Callback<void, ReadResult> completer) final;
     void cancel_read(TransferHandle transfer_handle) final;
-    void did_receive(uint8_t* buffer, size_t length);
+    size_t did_receive(const uint8_t* buffer, size_t length);
 
     Callback<void, ReadResult> completer_;
     bufptr_t rx_buf_ = {nullptr, nullptr};
@@ -92,9 +95,10 @@ void Stm32UartRxStream::cancel_read(TransferHandle transfer_handle) {
     // not implemented
 }
 
-void Stm32UartRxStream::did_receive(uint8_t* buffer, size_t length) {
-    // This can be called even if there was no RX operation in progress
-
+// Copies as much of the received data as fits into the buffer of the pending
+// read and completes the read. Returns the number of bytes that were consumed,
+// which is 0 if there was no RX operation in progress.
+size_t Stm32UartRxStream::did_receive(const uint8_t* buffer, size_t length) {
     bufptr_t rx_buf = rx_buf_;
 
     if (completer_ && rx_buf.begin()) {
@@ -102,7 +106,9 @@ void Stm32UartRxStream::did_receive(uint8_t* buffer, size_t length) {
         size_t chunk = std::min(length, rx_buf.size());
         memcpy(rx_buf.begin(), buffer, chunk);
         completer_.invoke_and_clear({kStreamOk, rx_buf.begin() + chunk});
+        return chunk;
     }
+    return 0;
 }
 
 Stm32UartTxStream uart_tx_stream(huart_);
@@ -116,6 +122,36 @@ AsciiProtocol ascii_over_uart(&uart_rx_stream, &uart_tx_multiplexer);
 
 bool uart0_stdout_pending = false;
 
+// Hands all bytes that the DMA has written since the last call to the
+// protocol. Bytes that the protocol doesn't read right away stay in the DMA
+// buffer until the next call.
+static void uart_process_rx() {
+    // Check for UART errors and restart receive DMA transfer if required
+    if (huart_->RxState != HAL_UART_STATE_BUSY_RX) {
+        HAL_UART_AbortReceive(huart_);
+        HAL_UART_Receive_DMA(huart_, dma_rx_buffer, sizeof(dma_rx_buffer));
+        dma_last_rcv_idx = 0;
+    }
+    // Fetch the circular buffer "write pointer", where it would write next
+    uint32_t new_rcv_idx = UART_RX_BUFFER_SIZE - huart_->hdmarx->Instance->NDTR;
+    if (new_rcv_idx >= UART_RX_BUFFER_SIZE) { // NDTR is reloaded when it reaches 0
+        new_rcv_idx = 0;
+    }
+
+    // Process bytes in chunks that don't wrap around the end of the buffer.
+    // The protocols issue the next read from within the completion callback,
+    // so one call can consume several chunks.
+    while (dma_last_rcv_idx != new_rcv_idx) {
+        uint32_t end_idx = new_rcv_idx > dma_last_rcv_idx ? new_rcv_idx : UART_RX_BUFFER_SIZE;
+        size_t n_consumed = uart_rx_stream.did_receive(dma_rx_buffer + dma_last_rcv_idx,
+                end_idx - dma_last_rcv_idx);
+        if (!n_consumed) {
+            break;
+        }
+        dma_last_rcv_idx = (dma_last_rcv_idx + n_consumed) % UART_RX_BUFFER_SIZE;
+    }
+}
+
 static void uart_server_thread(void * ctx) {
     (void) ctx;
 
@@ -135,38 +171,14 @@ static void uart_server_thread(void * ctx) {
 
         switch (event.value.v) {
             case 1: {
-                // This event is triggered by the control loop at 8kHz. This should be
-                // enough for most applications.
-                // At 1Mbaud/s that corresponds to at most 12.5 bytes which can arrive
-                // during the sleep period.
-
-                // Check for UART errors and restart receive DMA transfer if required
-                if (huart_->RxState != HAL_UART_STATE_BUSY_RX) {
-                    HAL_UART_AbortReceive(huart_);
-                    HAL_UART_Receive_DMA(huart_, dma_rx_buffer, sizeof(dma_rx_buffer));
-                    dma_last_rcv_idx = 0;
-                }
-                // Fetch the circular buffer "write pointer", where it would write next
-                uint32_t new_rcv_idx = UART_RX_BUFFER_SIZE - huart_->hdmarx->Instance->NDTR;
-                if (new_rcv_idx > UART_RX_BUFFER_SIZE) { // defensive programming
-                    continue;
-                }
-
-                // Process bytes in one or two chunks (two in case there was a wrap)
-                if (new_rcv_idx < dma_last_rcv_idx) {
-                    uart_rx_stream.did_receive(dma_rx_buffer + dma_last_rcv_idx,
-                            UART_RX_BUFFER_SIZE - dma_last_rcv_idx);
-                    dma_last_rcv_idx = 0;
-                }
-                if (new_rcv_idx > dma_last_rcv_idx) {
-                    uart_rx_stream.did_receive(dma_rx_buffer + dma_last_rcv_idx,
-                            new_rcv_idx - dma_last_rcv_idx);
-                    dma_last_rcv_idx = new_rcv_idx;
-                }
+                uart_rx_pending = false;
+                uart_process_rx();
             } break;
 
             case 2: {
                 uart_tx_stream.did_finish();
+                // The protocol may have held back a read until the TX was done
+                uart_process_rx();
             } break;
 
             case 3: { // stdout has data
@@ -183,19 +195,50 @@ void start_uart_server(UART_HandleTypeDef* huart) {
     uart_tx_stream.huart_ = huart;
 
     // DMA is set up to receive in a circular buffer forever.
-    // We dont use interrupts to fetch the data, instead we periodically read
-    // data out of the circular buffer into a parse buffer, controlled by a state machine
+    // The half transfer, transfer complete and idle line interrupts wake up
+    // the UART thread which reads the data out of the circular buffer.
     HAL_UART_Receive_DMA(huart_, dma_rx_buffer, sizeof(dma_rx_buffer));
     dma_last_rcv_idx = 0;
+    __HAL_UART_ENABLE_IT(huart_, UART_IT_IDLE);
 
     // Start UART communication thread
     osThreadDef(uart_server_thread_def, uart_server_thread, osPriorityNormal, 0, stack_size_uart_thread / sizeof(StackType_t) /* the ascii protocol needs considerable stack space */);
     uart_thread = osThreadCreate(osThread(uart_server_thread_def), NULL);
 }
 
-void uart_poll() {
-    if (uart_thread) { // the thread is only started if UART is enabled
-        osMessagePut(uart_event_queue, 1, 0);
+// Wakes up the UART thread to process received data. Only one event is
+// queued at a time so that a fast stream of interrupts can't fill the queue.
+static void uart_notify_rx() {
+    if (!uart_rx_pending) {
+        uart_rx_pending = true;
+        if (osMessagePut(uart_event_queue, 1, 0) != osOK) {
+            uart_rx_pending = false;
+        }
+    }
+}
+
+void uart_idle_isr(UART_HandleTypeDef* huart) {
+    if (huart == huart_) {
+        uart_notify_rx();
+    }
+}
+
+void HAL_UART_RxHalfCpltCallback(UART_HandleTypeDef* huart) {
+    if (huart == huart_) {
+        uart_notify_rx();
+    }
+}
+
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef* huart) {
+    if (huart == huart_) {
+        uart_notify_rx();
+    }
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef* huart) {
+    if (huart == huart_) {
+        // The thread restarts the RX DMA if the error stopped it
+        uart_notify_rx();
     }
 }
 
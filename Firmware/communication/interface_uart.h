@@ -13,7 +13,7 @@ extern osThreadId uart_thread;
 extern const uint32_t stack_size_uart_thread;
 
 void start_uart_server(UART_HandleTypeDef* huart);
-void uart_poll(void);
+void uart_idle_isr(UART_HandleTypeDef* huart);
 
 #ifdef __cplusplus
 }
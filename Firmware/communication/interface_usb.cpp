@@ -5,6 +5,7 @@
 #include <MotorControl/utils.hpp>
 
 #include <fibre/async_stream.hpp>
+#include <fibre/simple_serdes.hpp>
 #include <fibre/../../legacy_protocol.hpp>
 #include <usbd_cdc.h>
 #include <usbd_cdc_if.h>
@@ -14,24 +15,63 @@
 
 #include <odrive_main.h>
 
+// If enabled, small writes to the CDC endpoint are aggregated into full size
+// USB packets (see Stm32UsbTxStream).
+#ifndef USB_CDC_TX_AGGREGATION
+#define USB_CDC_TX_AGGREGATION 1
+#endif
+
 osThreadId usb_thread;
 const uint32_t stack_size_usb_thread = 4096; // Bytes
 USBStats_t usb_stats_;
 
 namespace fibre {
 
+/**
+ * @brief TX stream that copies writes into a queue of two USB packets.
+ *
+ * While one packet is in flight, writes go into the other one, which is sent
+ * as soon as the first one is done. A write completes as soon as it was
+ * copied, so the writer can prepare its next write while the previous one is
+ * still on the bus. If both packets are taken, the write completes when the
+ * packet in flight is done.
+ *
+ * If `aggregate` is set, writes are appended to the queued packet up to the
+ * full packet size and a write that doesn't fit completes partially. This
+ * must only be used on stream based endpoints because packet boundaries are
+ * not preserved. Transfers that end with a full packet are terminated with a
+ * zero length packet by the USB stack so that the host doesn't wait for more
+ * data.
+ *
+ * Otherwise every write becomes exactly one packet and must be smaller than
+ * a full packet (see note on MTU in start_write()).
+ */
 class Stm32UsbTxStream : public AsyncStreamSink {
 public:
-    Stm32UsbTxStream(uint8_t endpoint_num) : endpoint_num_(endpoint_num) {}
+    Stm32UsbTxStream(uint8_t endpoint_num, bool aggregate)
+        : endpoint_num_(endpoint_num), aggregate_(aggregate) {}
 
     void start_write(cbufptr_t buffer, TransferHandle* handle, Callback<void, WriteResult> completer) final;
     void cancel_write(TransferHandle transfer_handle) final;
     void did_finish();
 
     const uint8_t endpoint_num_;
+    const bool aggregate_;
     bool connected_ = false;
-    Callback<void, WriteResult> completer_;
-    const uint8_t* tx_end_ = nullptr;
+
+private:
+    size_t enqueue(cbufptr_t buffer);
+    void maybe_send_packet();
+
+    uint8_t packets_[2][USB_TX_DATA_SIZE];
+    size_t lengths_[2] = {0, 0};
+    size_t head_ = 0; // index of the oldest queued packet
+    size_t n_queued_ = 0; // number of queued packets including the one in flight
+    bool in_flight_ = false; // the packet at head_ is being sent
+
+    // Write that is waiting for a free packet buffer
+    cbufptr_t pending_ = {nullptr, nullptr};
+    Callback<void, WriteResult> pending_completer_;
 };
 
 class Stm32UsbRxStream : public AsyncStreamSource {
@@ -48,10 +88,79 @@ public:
     uint8_t* rx_end_ = nullptr;
 };
 
+/**
+ * @brief Pushes the samples of odrv.telemetry_ to the host.
+ *
+ * The samples are framed like a legacy protocol request on
+ * TELEMETRY_ENDPOINT_ID that doesn't expect a response, so that they can share
+ * the native endpoint with the protocol.
+ */
+class UsbTelemetrySender {
+public:
+    UsbTelemetrySender(AsyncStreamSink& sink) : sink_(sink) {}
+
+    void maybe_start_write();
+
+private:
+    void on_write_finished(WriteResult result);
+
+    AsyncStreamSink& sink_;
+    uint8_t tx_buf_[USB_TX_DATA_SIZE - 1]; // See note on MTU below
+    uint16_t seqno_ = 0;
+    bool is_active_ = false;
+    TransferHandle transfer_handle_ = 0;
+};
+
 }
 
 using namespace fibre;
 
+static uint8_t usb_transmit(const uint8_t* buf, uint16_t len, uint8_t endpoint_num) {
+    return
+#if HW_VERSION_MAJOR == 3 // TODO: remove preprocessor switch
+        CDC_Transmit_FS
+#elif HW_VERSION_MAJOR == 4
+        CDC_Transmit_HS
+#else
+#error "not supported"
+#endif
+        (const_cast<uint8_t*>(buf), len, endpoint_num);
+}
+
+void UsbTelemetrySender::maybe_start_write() {
+    if (is_active_) {
+        return;
+    }
+
+    bufptr_t payload = {tx_buf_ + 6, tx_buf_ + sizeof(tx_buf_) - 2};
+    if (!odrv.telemetry_.pop_samples(&payload)) {
+        return;
+    }
+    size_t length = payload.begin() - tx_buf_;
+
+    seqno_ = (seqno_ + 1) & 0x7fff;
+    write_le<uint16_t>(seqno_, tx_buf_);
+    write_le<uint16_t>(TELEMETRY_ENDPOINT_ID, tx_buf_ + 2); // MSB not set: no response expected
+    write_le<uint16_t>(0, tx_buf_ + 4);
+    write_le<uint16_t>(fibre::json_crc_, tx_buf_ + length);
+
+    is_active_ = true;
+    sink_.start_write({tx_buf_, length + 2}, &transfer_handle_, MEMBER_CB(this, on_write_finished));
+}
+
+void UsbTelemetrySender::on_write_finished(WriteResult result) {
+    is_active_ = false;
+    transfer_handle_ = 0;
+
+    // Don't restart right away: the multiplexer invokes this before it picks
+    // the next slot so the telemetry would always win against protocol
+    // responses. Going through the event queue lets a pending response go
+    // out first.
+    if (result.status == kStreamOk) {
+        usb_notify_telemetry();
+    }
+}
+
 void Stm32UsbTxStream::start_write(cbufptr_t buffer, TransferHandle* handle, Callback<void, WriteResult> completer) {
     if (handle) {
         *handle = reinterpret_cast<TransferHandle>(this);
@@ -68,41 +177,112 @@ void Stm32UsbTxStream::start_write(cbufptr_t buffer, TransferHandle* handle, Cal
     // packet. Currently we don't implement this segmentation. Therefore we
     // must ensure that all packets are < 64 bytes, otherwise the host will wait
     // for more.
-    if (buffer.size() >= USB_TX_DATA_SIZE) {
+    if (!aggregate_ && buffer.size() >= USB_TX_DATA_SIZE) {
         completer.invoke({kStreamError, buffer.begin()});
         return;
     }
 
-    if (completer_ || tx_end_) {
+    if (pending_completer_) {
         completer.invoke({kStreamError, buffer.begin()});
         return;
     }
 
-    completer_ = completer;
-    tx_end_ = buffer.end();
+    if (buffer.empty()) {
+        completer.invoke({kStreamOk, buffer.begin()});
+        return;
+    }
 
-    if (
-#if HW_VERSION_MAJOR == 3 // TODO: remove preprocessor switch
-        CDC_Transmit_FS
-#elif HW_VERSION_MAJOR == 4
-        CDC_Transmit_HS
-#else
-#error "not supported"
-#endif
-        (const_cast<uint8_t*>(buffer.begin()), buffer.size(), endpoint_num_) != USBD_OK) {
-        tx_end_ = nullptr;
-        completer_.invoke_and_clear({kStreamError, buffer.begin()});
+    size_t n_copied = enqueue(buffer);
+    if (!n_copied) {
+        // Both packets are taken. Complete the write when there's space again.
+        pending_ = buffer;
+        pending_completer_ = completer;
+        return;
     }
+
+    maybe_send_packet();
+    completer.invoke({kStreamOk, buffer.begin() + n_copied});
 }
 
 void Stm32UsbTxStream::cancel_write(TransferHandle transfer_handle) {
-    // not implemented
+    // Writes that were copied can't be cancelled anymore
+    const uint8_t* pending_begin = pending_.begin();
+    pending_ = {nullptr, nullptr};
+    pending_completer_.invoke_and_clear({kStreamCancelled, pending_begin});
 }
 
 void Stm32UsbTxStream::did_finish() {
-    const uint8_t* tx_end = tx_end_;
-    tx_end_ = nullptr;
-    completer_.invoke_and_clear({connected_ ? kStreamOk : kStreamClosed, tx_end});
+    if (in_flight_) {
+        in_flight_ = false;
+        head_ ^= 1;
+        n_queued_--;
+    }
+
+    if (!connected_) {
+        n_queued_ = 0;
+        const uint8_t* pending_begin = pending_.begin();
+        pending_ = {nullptr, nullptr};
+        pending_completer_.invoke_and_clear({kStreamClosed, pending_begin});
+        return;
+    }
+
+    // Also retries a packet that the USB stack refused earlier
+    maybe_send_packet();
+
+    if (pending_completer_) {
+        size_t n_copied = enqueue(pending_);
+        if (n_copied) {
+            const uint8_t* pending_begin = pending_.begin();
+            pending_ = {nullptr, nullptr};
+            maybe_send_packet();
+            pending_completer_.invoke_and_clear({kStreamOk, pending_begin + n_copied});
+        }
+    }
+}
+
+/**
+ * @brief Copies as much of the buffer as possible into the packet queue.
+ *
+ * Appends to the last queued packet if aggregation is enabled and that packet
+ * is not in flight. Otherwise the data goes into a new packet, if there's a
+ * free one.
+ *
+ * @returns The number of bytes that were copied.
+ */
+size_t Stm32UsbTxStream::enqueue(cbufptr_t buffer) {
+    size_t tail = (head_ + n_queued_ - 1) & 1;
+    bool can_append = aggregate_ && n_queued_ && !(in_flight_ && n_queued_ == 1)
+                   && lengths_[tail] < sizeof(packets_[0]);
+
+    if (!can_append) {
+        if (n_queued_ >= 2) {
+            return 0;
+        }
+        tail = (head_ + n_queued_) & 1;
+        lengths_[tail] = 0;
+        n_queued_++;
+    }
+
+    size_t n_copy = std::min(buffer.size(), sizeof(packets_[0]) - lengths_[tail]);
+    memcpy(packets_[tail] + lengths_[tail], buffer.begin(), n_copy);
+    lengths_[tail] += n_copy;
+    return n_copy;
+}
+
+void Stm32UsbTxStream::maybe_send_packet() {
+    if (in_flight_ || !n_queued_) {
+        return;
+    }
+
+    if (usb_transmit(packets_[head_], lengths_[head_], endpoint_num_) != USBD_OK) {
+        // The packet stays queued because its write already completed. It's
+        // retried on the next write or did_finish().
+        usb_stats_.tx_overrun_cnt++;
+        return;
+    }
+
+    usb_stats_.tx_cnt++;
+    in_flight_ = true;
 }
 
 void Stm32UsbRxStream::start_read(bufptr_t buffer, TransferHandle* handle, Callback<void, ReadResult> completer) {
@@ -140,19 +320,23 @@ void Stm32UsbRxStream::did_finish() {
     completer_.invoke_and_clear({connected_ ? kStreamOk : kStreamClosed, rx_end});
 }
 
-Stm32UsbTxStream usb_cdc_tx_stream(CDC_IN_EP);
-Stm32UsbTxStream usb_native_tx_stream(ODRIVE_IN_EP);
+Stm32UsbTxStream usb_cdc_tx_stream(CDC_IN_EP, USB_CDC_TX_AGGREGATION);
+Stm32UsbTxStream usb_native_tx_stream(ODRIVE_IN_EP, false); // packet boundaries are significant on this endpoint
 Stm32UsbRxStream usb_cdc_rx_stream(CDC_OUT_EP);
 Stm32UsbRxStream usb_native_rx_stream(ODRIVE_OUT_EP);
 
+fibre::AsyncStreamSinkMultiplexer<2> usb_native_tx_multiplexer(usb_native_tx_stream);
+UsbTelemetrySender usb_telemetry_sender(usb_native_tx_multiplexer);
+
 LegacyProtocolStreamBased fibre_over_cdc(&usb_cdc_rx_stream, &usb_cdc_tx_stream);
-LegacyProtocolPacketBased fibre_over_usb(&usb_native_rx_stream, &usb_native_tx_stream, USB_TX_DATA_SIZE - 1); // See note on MTU above
+LegacyProtocolPacketBased fibre_over_usb(&usb_native_rx_stream, &usb_native_tx_multiplexer, USB_TX_DATA_SIZE - 1); // See note on MTU above
 
 fibre::AsyncStreamSinkMultiplexer<2> usb_cdc_tx_multiplexer(usb_cdc_tx_stream);
 fibre::BufferedStreamSink<64> usb_cdc_stdout_sink(usb_cdc_tx_multiplexer); // Used in communication.cpp
 AsciiProtocol ascii_over_cdc(&usb_cdc_rx_stream, &usb_cdc_tx_multiplexer);
 
 bool usb_cdc_stdout_pending = false;
+bool usb_telemetry_pending = false;
 
 static void usb_server_thread(void * ctx) {
     (void) ctx;
@@ -188,6 +372,7 @@ static void usb_server_thread(void * ctx) {
                 usb_native_tx_stream.connected_ = false;
                 usb_cdc_rx_stream.connected_ = false;
                 usb_native_rx_stream.connected_ = false;
+                odrv.telemetry_.stop(); // the next host might not expect it
                 usb_cdc_tx_stream.did_finish();
                 usb_native_tx_stream.did_finish();
                 usb_cdc_rx_stream.did_finish();
@@ -214,6 +399,11 @@ static void usb_server_thread(void * ctx) {
                 usb_cdc_stdout_pending = false;
                 usb_cdc_stdout_sink.maybe_start_async_write();
             } break;
+
+            case 8: { // telemetry has data
+                usb_telemetry_pending = false;
+                usb_telemetry_sender.maybe_start_write();
+            } break;
         }
     }
 }
@@ -230,6 +420,14 @@ void usb_rx_process_packet(uint8_t *buf, uint32_t len, uint8_t endpoint_pair) {
     }
 }
 
+// Called from the control loop when a telemetry sample was queued
+void usb_notify_telemetry() {
+    if (!usb_telemetry_pending) {
+        usb_telemetry_pending = true;
+        osMessagePut(usb_event_queue, 8, 0);
+    }
+}
+
 void start_usb_server() {
     // Start USB communication thread
     osThreadDef(usb_server_thread_def, usb_server_thread, osPriorityNormal, 0, stack_size_usb_thread / sizeof(StackType_t));
@@ -22,6 +22,7 @@ extern USBStats_t usb_stats_;
 
 void usb_rx_process_packet(uint8_t *buf, uint32_t len, uint8_t endpoint_pair);
 void start_usb_server(void);
+void usb_notify_telemetry(void);
 
 #ifdef __cplusplus
 }
@@ -43,10 +43,39 @@ static uint16_t calc_crc16(uint16_t remainder, uint8_t value) {
     return calc_crc<uint16_t, POLYNOMIAL>(remainder, value);
 }
 
+#if __cplusplus >= 201703L
+// Lookup table of the CRC-8 remainder of every byte value, computed at
+// compile time. Processes a byte with one lookup instead of eight shifts.
+// Costs 256 bytes per polynomial.
+template<unsigned POLYNOMIAL>
+struct Crc8Table {
+    constexpr Crc8Table() : values() {
+        for (unsigned i = 0; i < 256; ++i) {
+            uint8_t remainder = (uint8_t)i;
+            for (uint8_t bit = 8; bit; --bit) {
+                remainder = (remainder & 0x80) ? (uint8_t)((remainder << 1) ^ POLYNOMIAL) : (uint8_t)(remainder << 1);
+            }
+            values[i] = remainder;
+        }
+    }
+    uint8_t values[256];
+};
+
+template<unsigned POLYNOMIAL>
+inline constexpr Crc8Table<POLYNOMIAL> crc8_table{};
+
+template<unsigned POLYNOMIAL>
+static uint8_t calc_crc8(uint8_t remainder, const uint8_t* buffer, size_t length) {
+    while (length--)
+        remainder = crc8_table<POLYNOMIAL>.values[remainder ^ *(buffer++)];
+    return remainder;
+}
+#else
 template<unsigned POLYNOMIAL>
 static uint8_t calc_crc8(uint8_t remainder, const uint8_t* buffer, size_t length) {
     return calc_crc<uint8_t, POLYNOMIAL>(remainder, buffer, length);
 }
+#endif
 
 template<unsigned POLYNOMIAL>
 static uint16_t calc_crc16(uint16_t remainder, const uint8_t* buffer, size_t length) {
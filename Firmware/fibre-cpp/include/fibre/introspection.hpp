@@ -143,8 +143,11 @@ struct StringConvertibleTypeInfo {
     virtual bool set_string(const Introspectable& obj, char* buffer, size_t length) const { return false; }
 };
 
+struct FloatGettableTypeInfo {
+    virtual bool get_float(const Introspectable& obj, float* val) const { return false; }
+};
+
 struct FloatSettableTypeInfo {
-    //virtual bool get_float(const Introspectable& obj, float* val) const { return false; }
     virtual bool set_float(const Introspectable& obj, float val) const { return false; }
 };
 
@@ -155,7 +158,7 @@ struct FibrePropertyTypeInfo;
 
 // readonly property
 template<typename T>
-struct FibrePropertyTypeInfo<Property<const T>> : StringConvertibleTypeInfo, TypeInfo {
+struct FibrePropertyTypeInfo<Property<const T>> : FloatGettableTypeInfo, StringConvertibleTypeInfo, TypeInfo {
     using TypeInfo::TypeInfo;
     static const PropertyInfo property_table[];
     static const FibrePropertyTypeInfo<Property<const T>> singleton;
@@ -167,6 +170,10 @@ struct FibrePropertyTypeInfo<Property<const T>> : StringConvertibleTypeInfo, Typ
     bool get_string(const Introspectable& obj, char* buffer, size_t length) const override {
         return to_string(static_cast<maybe_underlying_type_t<T>>(as<const Property<const T>>(obj).read()), buffer, length, 0);
     }
+
+    bool get_float(const Introspectable& obj, float* val) const override {
+        return conversion::get_as_float(static_cast<maybe_underlying_type_t<T>>(as<const Property<const T>>(obj).read()), val);
+    }
 };
 
 template<typename T>
@@ -176,7 +183,7 @@ const FibrePropertyTypeInfo<Property<const T>> FibrePropertyTypeInfo<Property<co
 
 // readwrite property
 template<typename T>
-struct FibrePropertyTypeInfo<Property<T>> : FloatSettableTypeInfo, StringConvertibleTypeInfo, TypeInfo {
+struct FibrePropertyTypeInfo<Property<T>> : FloatGettableTypeInfo, FloatSettableTypeInfo, StringConvertibleTypeInfo, TypeInfo {
     using TypeInfo::TypeInfo;
     static const PropertyInfo property_table[];
     static const FibrePropertyTypeInfo<Property<T>> singleton;
@@ -190,6 +197,10 @@ struct FibrePropertyTypeInfo<Property<T>> : FloatSettableTypeInfo, StringConvert
         return to_string(static_cast<maybe_underlying_type_t<T>>(as<const Property<T>>(obj).read()), buffer, length, 0);
     }
 
+    bool get_float(const Introspectable& obj, float* val) const override {
+        return conversion::get_as_float(static_cast<maybe_underlying_type_t<T>>(as<const Property<T>>(obj).read()), val);
+    }
+
     bool set_string(const Introspectable& obj, char* buffer, size_t length) const override {
         maybe_underlying_type_t<T> value{};
         if (!from_string(buffer, length, &value, 0)) {
@@ -226,6 +226,31 @@ typedef LibFibreStatus (*libfibre_call_cb_t)(void* ctx,
         const unsigned char** tx_buf, size_t* tx_len,
         unsigned char** rx_buf, size_t* rx_len);
 
+/**
+ * @brief Completion callback type for libfibre_read_properties() and
+ * libfibre_write_properties().
+ * 
+ * @param ctx: The user data that was passed to the function that started the
+ *        operation.
+ * @param status: kFibreOk if all properties were processed. kFibreInvalidArgument
+ *        if the remote device rejected one of the properties or doesn't support
+ *        bulk operations. Any other status indicates a transport error.
+ * @param n_completed: Number of properties (counted from the beginning of the
+ *        list) that were successfully read or written. For a read operation
+ *        the values of these properties are valid in rx_buf.
+ */
+typedef void (*libfibre_bulk_cb_t)(void* ctx, LibFibreStatus status, size_t n_completed);
+
+/**
+ * @brief Callback type for libfibre_set_telemetry_callback().
+ * 
+ * @param ctx: The user data that was passed to libfibre_set_telemetry_callback().
+ * @param buf: The payload of one telemetry packet as it was sent by the remote
+ *        device. Only valid for the duration of the callback.
+ * @param length: Length of buf.
+ */
+typedef void (*libfibre_telemetry_cb_t)(void* ctx, const unsigned char* buf, size_t length);
+
 /**
  * @brief TX completion callback type for libfibre_start_tx().
  * 
@@ -516,6 +541,68 @@ FIBRE_PUBLIC LibFibreStatus libfibre_call(LibFibreFunction* func, LibFibreCallCo
         unsigned char** rx_end,
         libfibre_call_cb_t callback, void* cb_ctx);
 
+/**
+ * @brief Reads the values of several properties of the same remote device.
+ * 
+ * This is equivalent to calling the "read" function of each property but the
+ * reads are packed into as few round-trips as possible. This makes a big
+ * difference on USB, where every round-trip takes at least one frame.
+ * 
+ * @param properties: The property objects to read. All properties must belong
+ *        to the same device. Properties of the object_ref type are not
+ *        supported.
+ * @param n_properties: Length of the properties array.
+ * @param rx_buf: The buffer into which the values are written, in the order of
+ *        the properties and in the encoding of their "read" function. Must
+ *        remain valid until `callback` is invoked.
+ * @param rx_len: Length of rx_buf. Must be equal to the sum of the value sizes.
+ * @param callback: Invoked when the operation completes. This callback is
+ *        never invoked from inside libfibre_read_properties().
+ * @param cb_ctx: An opaque application-defined handle that gets passed to
+ *        `callback`.
+ * 
+ * @retval kFibreBusy: The operation was started and `callback` will be invoked.
+ * @retval kFibreInvalidArgument: The operation was not started.
+ */
+FIBRE_PUBLIC LibFibreStatus libfibre_read_properties(LibFibreObject* const* properties, size_t n_properties,
+        unsigned char* rx_buf, size_t rx_len,
+        libfibre_bulk_cb_t callback, void* cb_ctx);
+
+/**
+ * @brief Writes the values of several properties of the same remote device.
+ * 
+ * The counterpart of libfibre_read_properties(). The properties are written in
+ * the order in which they are listed.
+ * 
+ * @param tx_buf: The concatenated values to write, in the encoding of the first
+ *        argument of each property's "exchange" function. Must remain valid
+ *        until `callback` is invoked.
+ * @param tx_len: Length of tx_buf. Must be equal to the sum of the value sizes.
+ * 
+ * @retval kFibreBusy: The operation was started and `callback` will be invoked.
+ * @retval kFibreInvalidArgument: The operation was not started.
+ */
+FIBRE_PUBLIC LibFibreStatus libfibre_write_properties(LibFibreObject* const* properties, size_t n_properties,
+        const unsigned char* tx_buf, size_t tx_len,
+        libfibre_bulk_cb_t callback, void* cb_ctx);
+
+/**
+ * @brief Sets the callback that receives the telemetry packets which the
+ * remote device pushes without being asked.
+ * 
+ * The format of the packets is defined by the remote device. What the device
+ * pushes is usually configured through regular function calls and properties.
+ * 
+ * @param obj: Any object of the remote device.
+ * @param callback: Invoked for every telemetry packet. NULL to stop receiving
+ *        telemetry packets.
+ * @param cb_ctx: An opaque application-defined handle that gets passed to
+ *        `callback`.
+ * @returns: kFibreOk or kFibreInvalidArgument
+ */
+FIBRE_PUBLIC LibFibreStatus libfibre_set_telemetry_callback(LibFibreObject* obj,
+        libfibre_telemetry_cb_t callback, void* cb_ctx);
+
 /**
  * @brief Starts sending data on the specified TX stream.
  * 
@@ -0,0 +1,391 @@
+#ifndef __FIBRE_NUMBER_FORMAT_HPP
+#define __FIBRE_NUMBER_FORMAT_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+
+/**
+ * Allocation-free conversion between numbers and decimal text.
+ *
+ * These are used instead of sscanf / snprintf by the ASCII protocol and the
+ * string conversion of properties because the libc versions are slow and
+ * large on a microcontroller.
+ *
+ * All parse functions skip leading spaces and tabs, stop at the first
+ * character that doesn't belong to the number (or at `end`) and return a
+ * pointer to that character, or nullptr if there was no number.
+ *
+ * All format functions write a null-terminated string and return its length
+ * (without the null terminator), or 0 if the buffer is too small.
+ *
+ * Floats are formatted with the fewest significant digits (at most 9) that
+ * parse back to the exact same float32, so format_number() followed by
+ * parse_number() always reproduces the original value.
+ */
+
+namespace fibre {
+
+namespace number_format_detail {
+
+inline bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+inline const char* skip_whitespace(const char* str, const char* end) {
+    while (str < end && (*str == ' ' || *str == '\t')) {
+        ++str;
+    }
+    return str;
+}
+
+// Returns value * 10^exp10. Powers of ten up to 1e22 are exact in double
+// precision so the result is correctly rounded for |exp10| <= 22.
+inline double scale_pow10(double value, int exp10) {
+    static const double pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    constexpr int max_exp = sizeof(pow10) / sizeof(pow10[0]) - 1;
+
+    while (exp10 > max_exp) {
+        value *= pow10[max_exp];
+        exp10 -= max_exp;
+    }
+    while (exp10 < -max_exp) {
+        value /= pow10[max_exp];
+        exp10 += max_exp;
+    }
+    return exp10 >= 0 ? value * pow10[exp10] : value / pow10[-exp10];
+}
+
+inline bool matches_word(const char* str, const char* end, const char* word) {
+    for (; *word; ++str, ++word) {
+        if (str >= end || (*str | 0x20) != *word) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Writes the decimal digits of value to buffer (without null terminator)
+// and returns the number of digits or 0 if the buffer is too small.
+inline size_t format_digits(uint64_t value, char* buffer, size_t length) {
+    char tmp[20];
+    size_t n = 0;
+    do {
+        tmp[n++] = '0' + (value % 10);
+        value /= 10;
+    } while (value);
+
+    if (n > length) {
+        return 0;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        buffer[i] = tmp[n - 1 - i];
+    }
+    return n;
+}
+
+inline size_t finish(const char* tmp, size_t n, char* buffer, size_t length) {
+    if (n + 1 > length) {
+        return 0;
+    }
+    memcpy(buffer, tmp, n);
+    buffer[n] = 0;
+    return n;
+}
+
+} // namespace number_format_detail
+
+/**
+ * @brief Parses a decimal floating point number with optional sign, fraction
+ * and exponent, or "inf" / "nan".
+ */
+inline const char* parse_number(const char* str, const char* end, float* value) {
+    using namespace number_format_detail;
+
+    const char* pos = skip_whitespace(str, end);
+    bool negative = false;
+    if (pos < end && (*pos == '-' || *pos == '+')) {
+        negative = (*pos == '-');
+        ++pos;
+    }
+
+    if (matches_word(pos, end, "inf")) {
+        *value = negative ? -INFINITY : INFINITY;
+        pos += 3;
+        return matches_word(pos, end, "inity") ? pos + 5 : pos;
+    } else if (matches_word(pos, end, "nan")) {
+        *value = NAN;
+        return pos + 3;
+    }
+
+    // Collect up to 18 significant digits, which is more than enough for a
+    // float, and keep track of the decimal exponent.
+    uint64_t mantissa = 0;
+    int n_significant = 0;
+    int exp10 = 0;
+    bool any_digits = false;
+
+    for (; pos < end && is_digit(*pos); ++pos) {
+        any_digits = true;
+        if (n_significant < 18) {
+            mantissa = mantissa * 10 + (*pos - '0');
+            n_significant += (mantissa != 0);
+        } else {
+            exp10++;
+        }
+    }
+    if (pos < end && *pos == '.') {
+        for (++pos; pos < end && is_digit(*pos); ++pos) {
+            any_digits = true;
+            if (n_significant < 18) {
+                mantissa = mantissa * 10 + (*pos - '0');
+                n_significant += (mantissa != 0);
+                exp10--;
+            }
+        }
+    }
+    if (!any_digits) {
+        return nullptr;
+    }
+
+    // The exponent is only consumed if it has at least one digit
+    if (pos < end && (*pos == 'e' || *pos == 'E')) {
+        const char* exp_pos = pos + 1;
+        bool exp_negative = false;
+        if (exp_pos < end && (*exp_pos == '-' || *exp_pos == '+')) {
+            exp_negative = (*exp_pos == '-');
+            ++exp_pos;
+        }
+        if (exp_pos < end && is_digit(*exp_pos)) {
+            int exp = 0;
+            for (; exp_pos < end && is_digit(*exp_pos); ++exp_pos) {
+                exp = std::min(exp * 10 + (*exp_pos - '0'), 10000);
+            }
+            exp10 += exp_negative ? -exp : exp;
+            pos = exp_pos;
+        }
+    }
+
+    float result;
+    if (!mantissa || exp10 < -100) {
+        result = 0.0f;
+    } else if (exp10 > 100) {
+        result = INFINITY;
+    } else {
+        result = (float)scale_pow10((double)mantissa, exp10);
+    }
+    *value = negative ? -result : result;
+    return pos;
+}
+
+/**
+ * @brief Parses a decimal integer with optional sign or a hexadecimal integer
+ * with "0x" prefix. Fails if the value is out of range for T.
+ */
+template<typename T, typename = typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type>
+const char* parse_number(const char* str, const char* end, T* value) {
+    using namespace number_format_detail;
+
+    const char* pos = skip_whitespace(str, end);
+    bool negative = false;
+    if (pos < end && (*pos == '-' || *pos == '+')) {
+        negative = (*pos == '-');
+        ++pos;
+    }
+    if (negative && std::is_unsigned<T>::value) {
+        return nullptr;
+    }
+
+    unsigned base = 10;
+    if ((end - pos) >= 3 && pos[0] == '0' && (pos[1] | 0x20) == 'x') {
+        base = 16;
+        pos += 2;
+    }
+
+    // Largest magnitude that the result can have
+    using U = typename std::make_unsigned<T>::type;
+    const uint64_t limit = negative ? (uint64_t)(U)std::numeric_limits<T>::min() : (uint64_t)std::numeric_limits<T>::max();
+
+    uint64_t magnitude = 0;
+    const char* digits_begin = pos;
+    for (; pos < end; ++pos) {
+        unsigned digit;
+        if (is_digit(*pos)) {
+            digit = *pos - '0';
+        } else if (base == 16 && (*pos | 0x20) >= 'a' && (*pos | 0x20) <= 'f') {
+            digit = (*pos | 0x20) - 'a' + 10;
+        } else {
+            break;
+        }
+        if (magnitude > (limit - digit) / base) {
+            return nullptr; // out of range
+        }
+        magnitude = magnitude * base + digit;
+    }
+    if (pos == digits_begin) {
+        return nullptr;
+    }
+
+    *value = negative ? (T)(0 - (U)magnitude) : (T)magnitude;
+    return pos;
+}
+
+/**
+ * @brief Parses "0", "1" (or any other integer, which is true if non-zero),
+ * "true" or "false".
+ */
+inline const char* parse_number(const char* str, const char* end, bool* value) {
+    using namespace number_format_detail;
+
+    const char* pos = skip_whitespace(str, end);
+    if (matches_word(pos, end, "true")) {
+        *value = true;
+        return pos + 4;
+    } else if (matches_word(pos, end, "false")) {
+        *value = false;
+        return pos + 5;
+    }
+
+    int64_t int_value;
+    pos = parse_number(pos, end, &int_value);
+    if (pos) {
+        *value = int_value != 0;
+    }
+    return pos;
+}
+
+template<typename T, typename = typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type>
+size_t format_number(T value, char* buffer, size_t length) {
+    using namespace number_format_detail;
+    using U = typename std::make_unsigned<T>::type;
+
+    char tmp[24];
+    size_t n = 0;
+    U magnitude = (U)value;
+    if (value < 0) {
+        tmp[n++] = '-';
+        magnitude = 0 - magnitude;
+    }
+    n += format_digits(magnitude, tmp + n, sizeof(tmp) - n);
+    return finish(tmp, n, buffer, length);
+}
+
+inline size_t format_number(bool value, char* buffer, size_t length) {
+    return number_format_detail::finish(value ? "1" : "0", 1, buffer, length);
+}
+
+/**
+ * @brief Formats a float in fixed point notation if its decimal exponent is
+ * in [-5, 9) and in scientific notation (e.g. "1.5e-07") otherwise.
+ */
+inline size_t format_number(float value, char* buffer, size_t length) {
+    using namespace number_format_detail;
+
+    char tmp[24];
+    size_t n = 0;
+
+    if (isnan(value)) {
+        return finish("nan", 3, buffer, length);
+    }
+    if (signbit(value)) {
+        tmp[n++] = '-';
+        value = -value;
+    }
+    if (isinf(value)) {
+        memcpy(tmp + n, "inf", 3);
+        return finish(tmp, n + 3, buffer, length);
+    }
+    if (value == 0.0f) {
+        tmp[n++] = '0';
+        return finish(tmp, n, buffer, length);
+    }
+
+    // Decimal exponent of the leading digit, estimated from the binary
+    // exponent and then corrected.
+    int exp2;
+    frexpf(value, &exp2);
+    int exp10 = (int)floorf((float)(exp2 - 1) * 0.30103f);
+    if ((double)value >= scale_pow10(1.0, exp10 + 1)) {
+        exp10++;
+    } else if ((double)value < scale_pow10(1.0, exp10)) {
+        exp10--;
+    }
+
+    // Find the shortest digit string that parses back to the same value. 9
+    // significant digits always do.
+    uint64_t digits = 0;
+    int n_digits = 0;
+    int leading_exp10 = exp10;
+    while (n_digits < 9) {
+        n_digits++;
+        digits = (uint64_t)(scale_pow10((double)value, n_digits - 1 - exp10) + 0.5);
+        leading_exp10 = exp10;
+        if (digits >= (uint64_t)scale_pow10(1.0, n_digits)) {
+            // Rounding carried into a new leading digit (e.g. 9.96 => 10.0)
+            digits /= 10;
+            leading_exp10++;
+        }
+        float parsed = (float)scale_pow10((double)digits, leading_exp10 - (n_digits - 1));
+        if (parsed == value) {
+            break;
+        }
+    }
+    exp10 = leading_exp10;
+    while (n_digits > 1 && !(digits % 10)) {
+        digits /= 10;
+        n_digits--;
+    }
+
+    char digit_str[10];
+    format_digits(digits, digit_str, sizeof(digit_str));
+
+    if (exp10 >= -5 && exp10 < 9) {
+        if (exp10 < 0) {
+            // 0.000ddd
+            tmp[n++] = '0';
+            tmp[n++] = '.';
+            for (int i = -1; i > exp10; --i) {
+                tmp[n++] = '0';
+            }
+            memcpy(tmp + n, digit_str, n_digits);
+            n += n_digits;
+        } else {
+            // ddd[.ddd] or ddd000
+            int n_int_digits = exp10 + 1;
+            for (int i = 0; i < n_int_digits; ++i) {
+                tmp[n++] = i < n_digits ? digit_str[i] : '0';
+            }
+            if (n_digits > n_int_digits) {
+                tmp[n++] = '.';
+                memcpy(tmp + n, digit_str + n_int_digits, n_digits - n_int_digits);
+                n += n_digits - n_int_digits;
+            }
+        }
+    } else {
+        // d[.ddd]e[+-]dd
+        tmp[n++] = digit_str[0];
+        if (n_digits > 1) {
+            tmp[n++] = '.';
+            memcpy(tmp + n, digit_str + 1, n_digits - 1);
+            n += n_digits - 1;
+        }
+        tmp[n++] = 'e';
+        tmp[n++] = exp10 < 0 ? '-' : '+';
+        int abs_exp = exp10 < 0 ? -exp10 : exp10;
+        tmp[n++] = '0' + abs_exp / 10;
+        tmp[n++] = '0' + abs_exp % 10;
+    }
+
+    return finish(tmp, n, buffer, length);
+}
+
+}
+
+#endif // __FIBRE_NUMBER_FORMAT_HPP
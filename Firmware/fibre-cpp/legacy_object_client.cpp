@@ -7,167 +7,221 @@
 #include "crc.hpp"
 #include <variant>
 #include <algorithm>
+#include <limits>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
 
 DEFINE_LOG_TOPIC(LEGACY_OBJ);
 USE_LOG_TOPIC(LEGACY_OBJ);
 
 using namespace fibre;
 
-struct json_error {
-    const char* ptr;
-    std::string str;
-};
+/**
+ * @brief A string in the JSON buffer. Escape sequences are not supported.
+ */
+struct json_str {
+    json_str() : begin(nullptr), end(nullptr) {}
+    json_str(const char* begin, const char* end) : begin(begin), end(end) {}
 
-struct json_value;
-using json_list = std::vector<std::shared_ptr<json_value>>;
-using json_dict = std::vector<std::pair<std::shared_ptr<json_value>, std::shared_ptr<json_value>>>;
-using json_value_variant = std::variant<std::string, int, json_list, json_dict, json_error>;
+    const char* begin;
+    const char* end;
 
-struct json_value : json_value_variant {
-    //json_value(const json_value_variant& v) : json_value_variant{v} {}
-    template<typename T> json_value(T&& arg) : json_value_variant{std::forward<T>(arg)} {}
-    //json_value_variant v;
+    bool valid() const { return begin; }
+    bool operator==(const char* other) const {
+        size_t length = strlen(other);
+        return valid() && (size_t)(end - begin) == length && !memcmp(begin, other, length);
+    }
+    bool operator!=(const char* other) const { return !(*this == other); }
+    std::string str() const { return {begin, end}; }
 };
 
-// helper functions
-bool json_is_str(json_value val) { return val.index() == 0; }
-bool json_is_int(json_value val) { return val.index() == 1; }
-bool json_is_list(json_value val) { return val.index() == 2; }
-bool json_is_dict(json_value val) { return val.index() == 3; }
-bool json_is_err(json_value val) { return val.index() == 4; }
-std::string json_as_str(json_value val) { return std::get<0>(val); }
-int json_as_int(json_value val) { return std::get<1>(val); }
-json_list json_as_list(json_value val) { return std::get<2>(val); }
-json_dict json_as_dict(json_value val) { return std::get<3>(val); }
-json_error json_as_err(json_value val) { return std::get<4>(val); }
-
-json_value json_make_error(const char* ptr, std::string str) {
-    return {json_error{ptr, str}};
-}
-
-
-void json_skip_whitespace(const char** begin, const char* end) {
-    while (*begin < end && std::isspace(**begin)) {
-        (*begin)++;
+/**
+ * @brief Single-pass reader for the JSON interface definition.
+ *
+ * Strings are returned as pointers into the JSON buffer and values that the
+ * caller isn't interested in are skipped without being stored. This way the
+ * object tree can be built directly while reading the JSON.
+ *
+ * The reader stops at the first syntax error. All functions return false once
+ * `error` is set.
+ */
+struct fibre::JsonReader {
+    JsonReader(const char* begin, const char* end) : begin(begin), pos(begin), end(end) {}
+
+    const char* begin;
+    const char* pos;
+    const char* end;
+    const char* error = nullptr; // position of the first syntax error
+    const char* error_str = nullptr;
+
+    // Not std::isspace()/std::isdigit(): they are undefined for negative char
+    // values and depend on the locale. JSON only knows these characters.
+    static bool is_space(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
     }
-}
 
-bool json_comp(const char* begin, const char* end, char c) {
-    return begin < end && *begin == c;
-}
+    static bool is_digit(char c) {
+        return c >= '0' && c <= '9';
+    }
 
-json_value json_parse(const char** begin, const char* end) {
-    // skip whitespace
+    bool fail(const char* str) {
+        if (!error) {
+            error = pos;
+            error_str = str;
+        }
+        return false;
+    }
 
-    if (*begin >= end) {
-        return json_make_error(*begin, "expected value but got EOF");
+    void skip_whitespace() {
+        while (pos < end && is_space(*pos)) {
+            pos++;
+        }
     }
 
-    if (json_comp(*begin, end, '{')) {
-        // parse dict
-        (*begin)++; // consume leading '{'
-        json_dict dict;
-        bool expect_comma = false;
+    // Returns true if the next value starts with the character c
+    bool peek(char c) {
+        skip_whitespace();
+        return pos < end && *pos == c;
+    }
 
-        json_skip_whitespace(begin, end);
-        while (!json_comp(*begin, end, '}')) {
-            if (expect_comma) {
-                if (!json_comp(*begin, end, ',')) {
-                    return json_make_error(*begin, "expected ',' or '}'");
-                }
-                (*begin)++; // consume comma
-                json_skip_whitespace(begin, end);
-            }
-            expect_comma = true;
-
-            // Parse key-value pair
-            json_value key = json_parse(begin, end);
-            if (json_is_err(key)) return key;
-            json_skip_whitespace(begin, end);
-            if (!json_comp(*begin, end, ':')) {
-                return json_make_error(*begin, "expected :");
-            }
-            (*begin)++;
-            json_value val = json_parse(begin, end);
-            if (json_is_err(val)) return val;
-            dict.push_back({std::make_shared<json_value>(key), std::make_shared<json_value>(val)});
+    bool peek_int() {
+        skip_whitespace();
+        return pos < end && is_digit(*pos);
+    }
 
-            json_skip_whitespace(begin, end);
+    bool consume(char c, const char* error_str) {
+        if (!peek(c)) {
+            return fail(error_str);
         }
+        pos++;
+        return true;
+    }
 
-        (*begin)++;
-        return {dict};
-
-    } else if (json_comp(*begin, end, '[')) {
-        // parse list
-        (*begin)++; // consume leading '['
-        json_list list;
-        bool expect_comma = false;
+    /**
+     * @brief Moves to the next item of a list or to the next key of a dict.
+     *
+     * Usage: `for (bool first = true; reader.next_item(']', &first); ) { ... }`
+     * where the body reads exactly one item.
+     *
+     * @param close: ']' for lists, '}' for dicts. The opening bracket must
+     *        already be consumed.
+     * @returns false when the closing bracket was consumed or on error.
+     */
+    bool next_item(char close, bool* first) {
+        if (error) {
+            return false;
+        }
+        if (peek(close)) {
+            pos++;
+            return false;
+        }
+        if (!*first && !consume(',', close == ']' ? "expected ',' or ']'" : "expected ',' or '}'")) {
+            return false;
+        }
+        *first = false;
+        skip_whitespace();
+        if (pos >= end) {
+            return fail("expected value but got EOF");
+        }
+        return true;
+    }
 
-        json_skip_whitespace(begin, end);
-        while (!json_comp(*begin, end, ']')) {
-            if (expect_comma) {
-                if (!json_comp(*begin, end, ',')) {
-                    return json_make_error(*begin, "expected ',' or ']'");
-                }
-                (*begin)++; // consume comma
-                json_skip_whitespace(begin, end);
+    bool read_str(json_str* str) {
+        if (!consume('"', "expected '\"'")) {
+            return false;
+        }
+        const char* str_begin = pos;
+        while (pos < end && *pos != '"') {
+            if (*pos == '\\') {
+                return fail("escaped strings not supported");
             }
-            expect_comma = true;
-
-            // Parse item
-            json_value val = json_parse(begin, end);
-            if (json_is_err(val)) return val;
-            list.push_back(std::make_shared<json_value>(val));
-
-            json_skip_whitespace(begin, end);
+            pos++;
         }
+        if (pos >= end) {
+            return fail("expected '\"' but got EOF");
+        }
+        *str = {str_begin, pos++};
+        return true;
+    }
 
-        (*begin)++; // consume trailing ']'
-        return {list};
-
-    } else if (json_comp(*begin, end, '"')) {
-        // parse string
-        (*begin)++; // consume leading '"'
-        std::string str;
-
-        while (!json_comp(*begin, end, '"')) {
-            if (*begin >= end) {
-                return json_make_error(*begin, "expected '\"' but got EOF");
-            }
-            if (json_comp(*begin, end, '\\')) {
-                return json_make_error(*begin, "escaped strings not supported");
+    bool read_int(int* val) {
+        if (!peek_int()) {
+            return fail("expected integer");
+        }
+        int result = 0;
+        for (; pos < end && is_digit(*pos); ++pos) {
+            if (result > (std::numeric_limits<int>::max() - (*pos - '0')) / 10) {
+                return fail("integer too large");
             }
-            str.push_back(**begin);
-            (*begin)++;
+            result = result * 10 + (*pos - '0');
         }
+        *val = result;
+        return true;
+    }
 
-        (*begin)++; // consume trailing '"'
-        return {str};
+    // Reads a dict key including the colon
+    bool read_key(json_str* key) {
+        return read_str(key) && consume(':', "expected :");
+    }
 
-    } else if (std::isdigit(**begin)) {
-        // parse int
+    // Reads a string or skips the value if it's not a string
+    bool read_str_or_skip(json_str* str) {
+        return peek('"') ? read_str(str) : skip_value();
+    }
 
-        std::string str;
-        while (*begin < end && std::isdigit(**begin)) {
-            str.push_back(**begin);
-            (*begin)++;
+    // Reads an integer or skips the value if it's not an integer
+    bool read_int_or_skip(std::optional<int>* val) {
+        int result;
+        if (!peek_int()) {
+            return skip_value();
+        } else if (!read_int(&result)) {
+            return false;
         }
+        *val = result;
+        return true;
+    }
 
-        return {std::stoi(str)}; // note: this can throw an exception if the int is too long
+    bool skip_value() {
+        skip_whitespace();
+        if (pos >= end) {
+            return fail("expected value but got EOF");
+        }
 
-    } else {
-        return json_make_error(*begin, "unexpected character '" + std::string(*begin, *begin + 1) + "'");
-    }
-}
+        if (*pos == '{') {
+            pos++;
+            for (bool first = true; next_item('}', &first); ) {
+                json_str key;
+                if (!read_key(&key) || !skip_value()) {
+                    return false;
+                }
+            }
+        } else if (*pos == '[') {
+            pos++;
+            for (bool first = true; next_item(']', &first); ) {
+                if (!skip_value()) {
+                    return false;
+                }
+            }
+        } else if (*pos == '"') {
+            json_str str;
+            read_str(&str);
+        } else if (is_digit(*pos)) {
+            int val;
+            read_int(&val);
+        } else {
+            return fail("unexpected character");
+        }
 
-json_value json_dict_find(json_dict dict, std::string key) {
-    auto it = std::find_if(dict.begin(), dict.end(),
-        [&](std::pair<std::shared_ptr<json_value>, std::shared_ptr<json_value>>& kv){
-            return json_is_str(*kv.first) && json_as_str(*kv.first) == key;
-        });
-    return (it == dict.end()) ? json_make_error(nullptr, "key not found") : *it->second;
-}
+        return !error;
+    }
+};
 
 // not sure if this function exists in the STL
 template<typename TIt, typename TFunc, typename TNum = decltype(std::declval<TFunc>()(*std::declval<TIt>()))>
@@ -190,7 +244,8 @@ std::unordered_map<std::string, size_t> codecs = {
     {"int64", 8},
     {"uint64", 8},
     {"float", 4},
-    {"endpoint_ref", 4}
+    {"endpoint_ref", 4},
+    {"float32x15", 60}
 };
 
 size_t get_codec_size(std::string codec) {
@@ -198,45 +253,189 @@ size_t get_codec_size(std::string codec) {
     return (it == codecs.end()) ? 0 : it->second;
 }
 
-std::vector<LegacyFibreArg> parse_arglist(const json_value& list_val) {
+static std::vector<LegacyFibreArg> load_arglist(JsonReader& reader) {
     std::vector<LegacyFibreArg> arglist;
 
-    for (auto& arg : json_is_list(list_val) ? json_as_list(list_val) : json_list()) {
-        if (!json_is_dict(*arg)) {
+    if (!reader.peek('[')) {
+        reader.skip_value();
+        return arglist;
+    }
+    reader.pos++;
+
+    for (bool first = true; reader.next_item(']', &first); ) {
+        if (!reader.peek('{')) {
             FIBRE_LOG(W) << "arglist is invalid";
+            reader.skip_value();
             continue;
         }
-        auto dict = json_as_dict(*arg);
-        
-        json_value name_val = json_dict_find(dict, "name");
-        json_value id_val = json_dict_find(dict, "id");
-        json_value type_val = json_dict_find(dict, "type");
+        reader.pos++;
+
+        json_str name;
+        json_str type;
+        std::optional<int> id;
+
+        for (bool first_key = true; reader.next_item('}', &first_key); ) {
+            json_str key;
+            if (!reader.read_key(&key)) {
+                break;
+            } else if (key == "name") {
+                reader.read_str_or_skip(&name);
+            } else if (key == "id") {
+                reader.read_int_or_skip(&id);
+            } else if (key == "type") {
+                reader.read_str_or_skip(&type);
+            } else {
+                reader.skip_value();
+            }
+        }
 
-        if (!json_is_str(name_val) || !json_is_int(id_val) || ((int)(size_t)json_as_int(id_val) != json_as_int(id_val)) || !json_is_str(type_val)) {
+        if (reader.error) {
+            break;
+        } else if (!name.valid() || !id.has_value() || !type.valid()) {
             FIBRE_LOG(W) << "arglist is invalid";
             continue;
         }
 
-
+        std::string codec = type.str();
         arglist.push_back({
-            json_as_str(name_val),
-            json_as_str(type_val),
-            (json_as_str(type_val) == "endpoint_ref") ? "object_ref" : json_as_str(type_val),
-            get_codec_size(json_as_str(type_val)),
-            (json_as_str(type_val) == "endpoint_ref") ? sizeof(uintptr_t) : get_codec_size(json_as_str(type_val)),
-            (size_t)json_as_int(id_val),
+            name.str(),
+            codec,
+            (codec == "endpoint_ref") ? "object_ref" : codec,
+            get_codec_size(codec),
+            (codec == "endpoint_ref") ? sizeof(uintptr_t) : get_codec_size(codec),
+            (size_t)*id,
         });
     }
 
     return arglist;
 }
 
+/**
+ * @brief Returns the directory in which the JSON interface definitions of
+ * remote devices are cached or an empty string if the cache is disabled.
+ *
+ * The directory can be set with the environment variable FIBRE_CACHE_DIR.
+ * Setting it to an empty string disables the cache.
+ */
+static std::string json_cache_dir() {
+#ifdef __EMSCRIPTEN__
+    return "";
+#else
+    const char* dir = getenv("FIBRE_CACHE_DIR");
+    if (dir) {
+        return dir;
+    }
+#ifdef _WIN32
+    dir = getenv("LOCALAPPDATA");
+    return dir ? std::string{dir} + "\\fibre" : "";
+#else
+    dir = getenv("XDG_CACHE_HOME");
+    if (dir && *dir) {
+        return std::string{dir} + "/fibre";
+    }
+    dir = getenv("HOME");
+    return dir ? std::string{dir} + "/.cache/fibre" : "";
+#endif
+#endif
+}
+
+static std::string json_cache_path(uint32_t json_version_id) {
+    std::string dir = json_cache_dir();
+    if (dir.empty()) {
+        return "";
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "/interface-%08x.json", (unsigned)json_version_id);
+    return dir + name;
+}
+
+// Creates the directory and all of its parents
+static void make_dirs(std::string path) {
+    for (size_t pos = path.find_first_of("/\\", 1); ; pos = path.find_first_of("/\\", pos + 1)) {
+        std::string parent = path.substr(0, pos);
+#ifdef _WIN32
+        _mkdir(parent.c_str());
+#else
+        mkdir(parent.c_str(), 0755);
+#endif
+        if (pos == std::string::npos) {
+            break;
+        }
+    }
+}
+
+// Same as json_version_id_ in endpoints_template.j2
+static uint32_t calc_json_version_id(const std::vector<uint8_t>& json) {
+    uint16_t json_crc = calc_crc16<CANONICAL_CRC16_POLYNOMIAL>(PROTOCOL_VERSION, json.data(), json.size());
+    return ((uint32_t)json_crc << 16) | calc_crc16<CANONICAL_CRC16_POLYNOMIAL>(json_crc, json.data(), json.size());
+}
+
+/**
+ * @brief Loads the JSON with the specified version ID from the interface cache.
+ *
+ * Returns false if it's not in the cache or if the cached file doesn't match
+ * the version ID.
+ */
+static bool load_cached_json(uint32_t json_version_id, std::vector<uint8_t>* json) {
+    std::string path = json_cache_path(json_version_id);
+    FILE* file = path.empty() ? nullptr : fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    json->clear();
+    uint8_t buf[4096];
+    size_t n_read;
+    while ((n_read = fread(buf, 1, sizeof(buf), file)) > 0) {
+        json->insert(json->end(), buf, buf + n_read);
+    }
+    fclose(file);
+
+    if (calc_json_version_id(*json) != json_version_id) {
+        FIBRE_LOG(W) << "ignoring corrupt cache file " << path;
+        json->clear();
+        return false;
+    }
+
+    return true;
+}
+
+static void store_cached_json(uint32_t json_version_id, const std::vector<uint8_t>& json) {
+    std::string path = json_cache_path(json_version_id);
+    if (path.empty()) {
+        return;
+    }
+
+    make_dirs(json_cache_dir());
+
+    // Write to a temporary file first so that a concurrent reader never sees
+    // a partial file.
+    std::string tmp_path = path + ".tmp";
+    FILE* file = fopen(tmp_path.c_str(), "wb");
+    if (!file) {
+        FIBRE_LOG(D) << "can't write cache file " << tmp_path;
+        return;
+    }
+    bool ok = fwrite(json.data(), 1, json.size(), file) == json.size();
+    ok = (fclose(file) == 0) && ok;
+
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        FIBRE_LOG(D) << "can't write cache file " << path;
+        remove(tmp_path.c_str());
+    }
+}
+
 void LegacyObjectClient::start(Callback<void, LegacyObjectClient*, std::shared_ptr<LegacyObject>> on_found_root_object, Callback<void, LegacyObjectClient*, std::shared_ptr<LegacyObject>> on_lost_root_object) {
     FIBRE_LOG(D) << "start";
     on_found_root_object_ = on_found_root_object;
     on_lost_root_object_ = on_lost_root_object;
     json_.clear();
-    receive_more_json();
+    json_version_id_ = std::nullopt;
+
+    // Reading endpoint 0 at offset 0xffffffff returns the JSON version ID.
+    // With this we can skip downloading the JSON if it's in the cache.
+    write_le<uint32_t>(0xffffffff, tx_buf_);
+    protocol_->start_endpoint_operation(0, tx_buf_, version_id_buf_, &op_handle_, MEMBER_CB(this, on_received_version_id));
 }
 
 std::shared_ptr<FibreInterface> LegacyObjectClient::get_property_interfaces(std::string codec, bool write) {
@@ -267,13 +466,13 @@ std::shared_ptr<FibreInterface> LegacyObjectClient::get_property_interfaces(std:
     return intf_ptr;
 }
 
-std::shared_ptr<LegacyObject> LegacyObjectClient::load_object(json_value list_val) {
-    
-
-    if (!json_is_list(list_val)) {
+std::shared_ptr<LegacyObject> LegacyObjectClient::load_object(JsonReader& reader) {
+    if (!reader.peek('[')) {
         FIBRE_LOG(W) << "interface members must be a list";
+        reader.skip_value();
         return nullptr;
     }
+    reader.pos++;
 
     LegacyObject obj{
         .client = this,
@@ -282,66 +481,140 @@ std::shared_ptr<LegacyObject> LegacyObjectClient::load_object(json_value list_va
         .known_to_application = false
     };
     auto obj_ptr = std::make_shared<LegacyObject>(obj);
-    FibreInterface& intf = *obj_ptr->intf;
 
-    for (auto& item: json_as_list(list_val)) {
-        if (!json_is_dict(*item)) {
-            FIBRE_LOG(W) << "expected dict";
-            continue;
+    for (bool first = true; reader.next_item(']', &first); ) {
+        load_member(reader, obj_ptr.get());
+    }
+
+    if (reader.error) {
+        return nullptr;
+    }
+
+    objects_.push_back(obj_ptr);
+    return obj_ptr;
+}
+
+// Reads one entry of the members list of an object and adds it to the object
+void LegacyObjectClient::load_member(JsonReader& reader, LegacyObject* obj) {
+    if (!reader.peek('{')) {
+        FIBRE_LOG(W) << "expected dict";
+        reader.skip_value();
+        return;
+    }
+    reader.pos++;
+
+    json_str name_val;
+    json_str type;
+    json_str access;
+    std::optional<int> id;
+    std::vector<LegacyFibreArg> inputs;
+    std::vector<LegacyFibreArg> outputs;
+    std::shared_ptr<LegacyObject> subobj;
+    const char* members_pos = nullptr; // members that appeared before the type
+
+    for (bool first = true; reader.next_item('}', &first); ) {
+        json_str key;
+        if (!reader.read_key(&key)) {
+            return;
+        } else if (key == "name") {
+            reader.read_str_or_skip(&name_val);
+        } else if (key == "type") {
+            reader.read_str_or_skip(&type);
+        } else if (key == "access") {
+            reader.read_str_or_skip(&access);
+        } else if (key == "id") {
+            reader.read_int_or_skip(&id);
+        } else if (key == "members" && type == "object") {
+            subobj = load_object(reader);
+        } else if (key == "members") {
+            members_pos = reader.pos;
+            reader.skip_value();
+        } else if (key == "inputs") {
+            inputs = load_arglist(reader);
+        } else if (key == "outputs") {
+            outputs = load_arglist(reader);
+        } else {
+            reader.skip_value();
         }
-        auto dict = json_as_dict(*item);
+    }
 
-        json_value type = json_dict_find(dict, "type");
-        json_value name_val = json_dict_find(dict, "name");
-        std::string name = json_is_str(name_val) ? json_as_str(name_val) : "[anonymous]";
+    if (reader.error) {
+        return;
+    }
 
-        if (json_is_str(type) && json_as_str(type) == "object") {
-            std::shared_ptr<LegacyObject> subobj = load_object(json_dict_find(dict, "members"));
-            intf.attributes[name] = {subobj};
+    FibreInterface& intf = *obj->intf;
+    std::string name = name_val.valid() ? name_val.str() : "[anonymous]";
 
-        } else if (json_is_str(type) && json_as_str(type) == "function") {
-            json_value id = json_dict_find(dict, "id");
-            if (!json_is_int(id) || ((int)(size_t)json_as_int(id) != json_as_int(id))) {
-                continue;
-            }
-            intf.functions.emplace(name, LegacyFunction{
-                (size_t)json_as_int(id),
-                obj_ptr.get(),
-                parse_arglist(json_dict_find(dict, "inputs")),
-                parse_arglist(json_dict_find(dict, "outputs"))
-            });
-
-        } else if (json_is_str(type) && json_as_str(type) == "json") {
-            // Ignore
-
-        } else if (json_is_str(type)) {
-            std::string type_str = json_as_str(type);
-            json_value access = json_dict_find(dict, "access");
-            std::string access_str = json_is_str(access) ? json_as_str(access) : "r";
-            bool can_write = access_str.find('w') != std::string::npos;
-
-            json_value id = json_dict_find(dict, "id");
-            if (!json_is_int(id) || ((int)(size_t)json_as_int(id) != json_as_int(id))) {
-                continue;
-            }
+    if (type == "object") {
+        if (!subobj) {
+            JsonReader members_reader = reader;
+            members_reader.pos = members_pos ? members_pos : reader.end;
+            subobj = load_object(members_reader);
+        }
+        intf.attributes[name] = {subobj};
 
-            LegacyObject subobj{
-                .client = this,
-                .ep_num = (size_t)json_as_int(id),
-                .intf = get_property_interfaces(type_str, can_write),
-                .known_to_application = false
-            };
-            auto subobj_ptr = std::make_shared<LegacyObject>(subobj);
-            objects_.push_back(subobj_ptr);
-            intf.attributes[name] = {subobj_ptr};
+    } else if (type == "function") {
+        if (!id.has_value()) {
+            return;
+        }
+        intf.functions.emplace(name, LegacyFunction{
+            (size_t)*id,
+            obj,
+            inputs,
+            outputs
+        });
 
-        } else {
-            FIBRE_LOG(W) << "unsupported codec";
+    } else if (type == "json") {
+        // Ignore
+
+    } else if (type.valid()) {
+        bool can_write = access.valid() && std::find(access.begin, access.end, 'w') != access.end;
+
+        if (!id.has_value()) {
+            return;
         }
+
+        LegacyObject subobj{
+            .client = this,
+            .ep_num = (size_t)*id,
+            .intf = get_property_interfaces(type.str(), can_write),
+            .known_to_application = false
+        };
+        auto subobj_ptr = std::make_shared<LegacyObject>(subobj);
+        objects_.push_back(subobj_ptr);
+        intf.attributes[name] = {subobj_ptr};
+
+    } else {
+        FIBRE_LOG(W) << "unsupported codec";
     }
+}
 
-    objects_.push_back(obj_ptr);
-    return obj_ptr;
+void LegacyObjectClient::on_received_version_id(EndpointOperationResult result) {
+    op_handle_ = 0;
+
+    if (result.status == kStreamCancelled) {
+        return;
+    } else if (result.status == kStreamClosed) {
+        return;
+    } else if (result.status != kStreamOk) {
+        FIBRE_LOG(W) << "JSON version read operation failed";
+        return;
+    }
+
+    if (result.rx_end == version_id_buf_ + sizeof(version_id_buf_)) {
+        uint32_t json_version_id;
+        read_le<uint32_t>(&json_version_id, version_id_buf_);
+        json_version_id_ = json_version_id;
+        FIBRE_LOG(D) << "JSON version ID is " << as_hex(*json_version_id_);
+
+        if (load_cached_json(*json_version_id_, &json_)) {
+            FIBRE_LOG(D) << "loaded JSON from cache";
+            load_json();
+            return;
+        }
+    }
+
+    receive_more_json();
 }
 
 void LegacyObjectClient::receive_more_json() {
@@ -372,31 +645,60 @@ void LegacyObjectClient::on_received_json(EndpointOperationResult result) {
         receive_more_json();
 
     } else {
-
         FIBRE_LOG(D) << "received JSON of length " << json_.size();
         //FIBRE_LOG(D) << "JSON: " << str{json_.data(), json_.data() + json_.size()};
 
-        const char *begin = reinterpret_cast<const char*>(json_.data());
-        auto val = json_parse(&begin, begin + json_.size());
-
-        if (json_is_err(val)) {
-            size_t pos = json_as_err(val).ptr - reinterpret_cast<const char*>(json_.data());
-            FIBRE_LOG(E) << "JSON parsing error: " << json_as_err(val).str << " at position " << pos;
-            return;
-        } else if (!json_is_list(val)) {
-            FIBRE_LOG(E) << "JSON data must be a list";
-            return;
+        if (load_json() && json_version_id_.has_value()) {
+            if (calc_json_version_id(json_) == *json_version_id_) {
+                store_cached_json(*json_version_id_, json_);
+            } else {
+                FIBRE_LOG(W) << "JSON doesn't match the version ID. Not caching it.";
+            }
         }
+    }
+}
 
-        FIBRE_LOG(D) << "sucessfully parsed JSON";
-        root_obj_ = load_object(val);
-        json_crc_ = calc_crc16<CANONICAL_CRC16_POLYNOMIAL>(PROTOCOL_VERSION, json_.data(), json_.size());
-        if (root_obj_) {
-            on_found_root_object_.invoke_and_clear(this, root_obj_);
-        }
+/**
+ * @brief Builds the object tree that is described by a JSON interface
+ * definition.
+ *
+ * The objects are added to objects_.
+ *
+ * @returns The root object or null if the JSON is invalid.
+ */
+std::shared_ptr<LegacyObject> LegacyObjectClient::load_interface(cbufptr_t json) {
+    const char* begin = reinterpret_cast<const char*>(json.begin());
+    JsonReader reader{begin, begin + json.size()};
+
+    if (!reader.peek('[')) {
+        FIBRE_LOG(E) << "JSON data must be a list";
+        return nullptr;
     }
+
+    size_t n_objects = objects_.size();
+    std::shared_ptr<LegacyObject> root_obj = load_object(reader);
+
+    if (reader.error) {
+        FIBRE_LOG(E) << "JSON parsing error: " << reader.error_str << " at position " << (reader.error - begin);
+        objects_.resize(n_objects);
+        return nullptr;
+    }
+
+    FIBRE_LOG(D) << "sucessfully parsed JSON";
+    return root_obj;
 }
 
+// Loads the JSON in json_ and reports the root object.
+bool LegacyObjectClient::load_json() {
+    root_obj_ = load_interface(json_);
+    if (!root_obj_) {
+        return false;
+    }
+
+    json_crc_ = calc_crc16<CANONICAL_CRC16_POLYNOMIAL>(PROTOCOL_VERSION, json_.data(), json_.size());
+    on_found_root_object_.invoke_and_clear(this, root_obj_);
+    return true;
+}
 
 std::optional<CallBufferRelease> LegacyFunction::call(void** call_handle,
         CallBuffers buffers,
@@ -693,3 +995,135 @@ std::variant<LegacyCallContext::ContinueWithApp, LegacyCallContext::ContinueWith
 
     return InternalError{};
 }
+
+std::optional<LegacyBulkOperation*> LegacyBulkOperation::start(std::vector<LegacyObject*> properties, bool write, cbufptr_t values_to_write, bufptr_t values_read, Callback<void, LegacyBulkOperation*, Status> callback) {
+    if (!properties.size()) {
+        return std::nullopt;
+    }
+
+    std::vector<size_t> sizes;
+    size_t total_size = 0;
+
+    for (LegacyObject* obj: properties) {
+        if (!obj || !obj->ep_num || obj->client != properties[0]->client) {
+            FIBRE_LOG(W) << "properties must be non-root objects of the same device";
+            return std::nullopt;
+        }
+
+        auto func = obj->intf->functions.find(write ? "exchange" : "read");
+        if (func == obj->intf->functions.end()) {
+            FIBRE_LOG(W) << "object is not a " << (write ? "writable" : "readable") << " property";
+            return std::nullopt;
+        }
+
+        // Values that need transcoding (endpoint_ref) are not supported
+        const LegacyFibreArg& arg = write ? func->second.inputs[0] : func->second.outputs[0];
+        if (arg.protocol_codec != arg.app_codec || arg.protocol_size > 0xff) {
+            FIBRE_LOG(W) << "codec " << arg.protocol_codec << " not supported in bulk operations";
+            return std::nullopt;
+        }
+
+        sizes.push_back(arg.protocol_size);
+        total_size += arg.protocol_size;
+    }
+
+    if ((write ? values_to_write.size() : values_read.size()) != total_size) {
+        FIBRE_LOG(W) << "expected " << total_size << " bytes of values";
+        return std::nullopt;
+    }
+
+    LegacyBulkOperation* op = new LegacyBulkOperation();
+    op->protocol_ = properties[0]->client->protocol_;
+    op->properties_ = properties;
+    op->sizes_ = sizes;
+    op->write_ = write;
+    op->values_to_write_ = values_to_write;
+    op->values_read_ = values_read;
+    op->callback_ = callback;
+    op->start_next_operation();
+    return op;
+}
+
+void LegacyBulkOperation::start_next_operation() {
+    // Pack as many properties as fit into one request and one response. The
+    // remote MTU is assumed to be at most one byte smaller than ours (USB:
+    // 63 vs 64 bytes).
+    size_t max_tx = std::max(protocol_->tx_mtu_, (size_t)8) - 8;
+    size_t max_rx = std::max(protocol_->tx_mtu_, (size_t)3) - 3;
+
+    tx_buf_.clear();
+    size_t rx_len = 1; // number of processed entries
+    n_pending_ = 0;
+
+    for (size_t i = n_done_; i < properties_.size(); ++i) {
+        size_t tx_len = write_ ? 3 + sizes_[i] : 2;
+        size_t rx_len_inc = write_ ? 0 : sizes_[i];
+        if (n_pending_ && (tx_buf_.size() + tx_len > max_tx || rx_len + rx_len_inc > max_rx)) {
+            break;
+        }
+
+        size_t pos = tx_buf_.size();
+        tx_buf_.resize(pos + tx_len);
+        uint16_t ep_num = properties_[i]->ep_num | (write_ ? 0x8000 : 0);
+        write_le<uint16_t>(ep_num, tx_buf_.data() + pos);
+        if (write_) {
+            const uint8_t* value = values_to_write_.begin() + calc_value_offset(i);
+            tx_buf_[pos + 2] = (uint8_t)sizes_[i];
+            std::copy_n(value, sizes_[i], tx_buf_.data() + pos + 3);
+        }
+
+        rx_len += rx_len_inc;
+        n_pending_++;
+    }
+
+    rx_buf_.resize(rx_len);
+    protocol_->start_endpoint_operation(MULTI_ENDPOINT_ID, tx_buf_, rx_buf_, &op_handle_, MEMBER_CB(this, on_operation_finished));
+}
+
+size_t LegacyBulkOperation::calc_value_offset(size_t idx) {
+    return calc_sum(sizes_.begin(), sizes_.begin() + idx, [](size_t size) { return size; });
+}
+
+void LegacyBulkOperation::on_operation_finished(EndpointOperationResult result) {
+    op_handle_ = 0;
+
+    Status status = kFibreOk;
+    size_t n_received = result.rx_end ? result.rx_end - rx_buf_.data() : 0;
+
+    if (result.status == kStreamCancelled) {
+        status = kFibreCancelled;
+    } else if (result.status != kStreamOk) {
+        FIBRE_LOG(W) << "bulk operation failed with " << result.status;
+        status = kFibreHostUnreachable;
+    } else if (!n_received) {
+        // Firmware doesn't support MULTI_ENDPOINT_ID
+        status = kFibreInvalidArgument;
+    } else {
+        size_t n_processed = std::min((size_t)rx_buf_[0], n_pending_);
+
+        if (!write_) {
+            cbufptr_t values = cbufptr_t{rx_buf_.data(), n_received}.skip(1);
+            size_t offset = calc_value_offset(n_done_);
+            size_t n_values = calc_value_offset(n_done_ + n_processed) - offset;
+            if (values.size() < n_values) {
+                FIBRE_LOG(W) << "bulk response too short";
+                n_processed = 0;
+            } else {
+                std::copy_n(values.begin(), n_values, values_read_.begin() + offset);
+            }
+        }
+
+        n_done_ += n_processed;
+
+        if (n_processed < n_pending_) {
+            FIBRE_LOG(W) << "remote failed at property " << n_done_;
+            status = kFibreInvalidArgument;
+        } else if (n_done_ < properties_.size()) {
+            start_next_operation();
+            return;
+        }
+    }
+
+    callback_.invoke(this, status);
+    delete this;
+}
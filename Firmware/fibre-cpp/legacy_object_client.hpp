@@ -10,8 +10,6 @@
 #include <fibre/cpp_utils.hpp> // std::variant and std::optional C++ backport
 #include <fibre/fibre.hpp>
 
-struct json_value;
-
 namespace fibre {
 
 struct EndpointOperationResult {
@@ -54,6 +52,7 @@ struct LegacyFunction : Function {
 
 struct FibreInterface;
 class LegacyObjectClient;
+struct JsonReader;
 
 struct LegacyFibreAttribute {
     std::shared_ptr<LegacyObject> object;
@@ -117,12 +116,43 @@ struct LegacyCallContext {
     std::variant<ContinueWithApp, ContinueWithProtocol, InternalError> get_next_task(std::variant<ResultFromApp, ResultFromProtocol> continue_from);
 };
 
+/**
+ * @brief Reads or writes a list of properties of one remote device with as few
+ * endpoint operations as possible (see MULTI_ENDPOINT_ID).
+ *
+ * The values are in the protocol encoding and are concatenated in the order of
+ * the properties.
+ */
+struct LegacyBulkOperation {
+    LegacyProtocolPacketBased* protocol_;
+    std::vector<LegacyObject*> properties_;
+    std::vector<size_t> sizes_; // protocol size of each property
+    bool write_;
+    cbufptr_t values_to_write_;
+    bufptr_t values_read_;
+    Callback<void, LegacyBulkOperation*, Status> callback_;
+
+    size_t n_done_ = 0; // number of properties that were successfully read or written
+    std::vector<uint8_t> tx_buf_;
+    std::vector<uint8_t> rx_buf_;
+    size_t n_pending_ = 0; // number of properties in the ongoing endpoint operation
+    EndpointOperationHandle op_handle_ = 0;
+
+    static std::optional<LegacyBulkOperation*> start(std::vector<LegacyObject*> properties, bool write, cbufptr_t values_to_write, bufptr_t values_read, Callback<void, LegacyBulkOperation*, Status> callback);
+
+private:
+    void start_next_operation();
+    size_t calc_value_offset(size_t idx);
+    void on_operation_finished(EndpointOperationResult result);
+};
+
 class LegacyObjectClient {
 public:
     LegacyObjectClient(LegacyProtocolPacketBased* protocol) : protocol_(protocol) {}
 
     void start(Callback<void, LegacyObjectClient*, std::shared_ptr<LegacyObject>> on_found_root_object, Callback<void, LegacyObjectClient*, std::shared_ptr<LegacyObject>> on_lost_root_object);
     bool transcode(cbufptr_t src, bufptr_t dst, std::string src_codec, std::string dst_codec);
+    std::shared_ptr<LegacyObject> load_interface(cbufptr_t json);
 
     // For direct access by LegacyProtocolPacketBased and libfibre.cpp
     uint16_t json_crc_ = 0;
@@ -130,16 +160,22 @@ public:
     std::shared_ptr<LegacyObject> root_obj_;
     std::vector<std::shared_ptr<LegacyObject>> objects_;
     void* user_data_; // used by libfibre to store the libfibre context pointer
+    Callback<void, const uint8_t*, size_t> on_telemetry_; // invoked with the payload of each telemetry packet (see TELEMETRY_ENDPOINT_ID)
     LegacyProtocolPacketBased* protocol_;
 
 private:
     std::shared_ptr<FibreInterface> get_property_interfaces(std::string codec, bool write);
-    std::shared_ptr<LegacyObject> load_object(json_value list_val);
+    std::shared_ptr<LegacyObject> load_object(JsonReader& reader);
+    void load_member(JsonReader& reader, LegacyObject* obj);
+    void on_received_version_id(EndpointOperationResult result);
     void receive_more_json();
     void on_received_json(EndpointOperationResult result);
+    bool load_json();
 
     Callback<void, LegacyObjectClient*, std::shared_ptr<LegacyObject>> on_found_root_object_;
     uint8_t tx_buf_[4] = {0xff, 0xff, 0xff, 0xff};
+    uint8_t version_id_buf_[4];
+    std::optional<uint32_t> json_version_id_; // key of the JSON in the interface cache (see json_cache_path())
     EndpointOperationHandle op_handle_ = 0;
     std::vector<uint8_t> json_;
     //std::vector<LegacyCallContext*> pending_calls_;
@@ -317,6 +317,62 @@ bool fibre::endpoint0_handler(fibre::cbufptr_t* input_buffer, fibre::bufptr_t* o
     }
 }
 
+/**
+ * @brief Runs several endpoint operations in one request.
+ *
+ * The request is a sequence of entries:
+ *  - Read: a 16 bit endpoint ID.
+ *  - Write: a 16 bit endpoint ID with the MSB set, followed by the 8 bit
+ *    length of the value and the value itself.
+ *
+ * The response starts with an 8 bit count of the entries that were processed
+ * successfully, followed by the concatenated values of all read entries.
+ * Processing stops at the first entry that fails, for instance because the
+ * endpoint doesn't exist or because its value doesn't fit into the response
+ * anymore.
+ */
+bool fibre::multi_endpoint_handler(fibre::cbufptr_t* input_buffer, fibre::bufptr_t* output_buffer) {
+    if (!output_buffer->size()) {
+        return false;
+    }
+
+    uint8_t& n_processed = *output_buffer->begin();
+    n_processed = 0;
+    *output_buffer = output_buffer->skip(1);
+
+    while (input_buffer->size()) {
+        std::optional<uint16_t> endpoint_id = read_le<uint16_t>(input_buffer);
+        if (!endpoint_id.has_value()) {
+            break;
+        }
+
+        if (*endpoint_id & 0x8000) {
+            std::optional<uint8_t> length = read_le<uint8_t>(input_buffer);
+            if (!length.has_value() || *length > input_buffer->size()) {
+                break;
+            }
+            fibre::cbufptr_t value = input_buffer->take(*length);
+            *input_buffer = input_buffer->skip(*length);
+
+            // Writes are exchange operations but the old value is not returned
+            uint8_t old_value[8];
+            fibre::bufptr_t discard = old_value;
+            if (!fibre::endpoint_handler(*endpoint_id & 0x7fff, &value, &discard)) {
+                break;
+            }
+        } else {
+            fibre::cbufptr_t no_input;
+            if (!fibre::endpoint_handler(*endpoint_id, &no_input, output_buffer)) {
+                break;
+            }
+        }
+
+        n_processed++;
+    }
+
+    return true;
+}
+
 #endif
 
 void LegacyProtocolPacketBased::on_write_finished(WriteResult result) {
@@ -443,6 +499,17 @@ void LegacyProtocolPacketBased::on_read_finished(ReadResult result) {
         FIBRE_LOG(W) << "received ack but client support is not compiled in";
 #endif
 
+#if FIBRE_ENABLE_CLIENT
+    } else if (rx_buf.size() >= 6 && ((rx_buf[0] | (rx_buf[1] << 8)) & 0x7fff) == TELEMETRY_ENDPOINT_ID) {
+        // Telemetry samples pushed by the remote server
+        uint16_t trailer = *(rx_buf.end() - 2) | (*(rx_buf.end() - 1) << 8);
+        if (trailer != client_.json_crc_) {
+            FIBRE_LOG(D) << "trailer mismatch for telemetry: expected " << as_hex(client_.json_crc_) << ", got " << as_hex(trailer);
+        } else {
+            client_.on_telemetry_.invoke(rx_buf.begin() + 4, rx_buf.size() - 6);
+        }
+#endif
+
     } else {
 
 #if FIBRE_ENABLE_SERVER
@@ -489,7 +556,11 @@ void LegacyProtocolPacketBased::on_read_finished(ReadResult result) {
 
         fibre::cbufptr_t input_buffer{rx_buf.begin(), rx_buf.end() - 2};
         fibre::bufptr_t output_buffer{tx_buf_ + 2, expected_response_length};
-        fibre::endpoint_handler(endpoint_id, &input_buffer, &output_buffer);
+        if (endpoint_id == MULTI_ENDPOINT_ID) {
+            fibre::multi_endpoint_handler(&input_buffer, &output_buffer);
+        } else {
+            fibre::endpoint_handler(endpoint_id, &input_buffer, &output_buffer);
+        }
 
         // Send response
         if (expect_response) {
@@ -29,6 +29,16 @@ constexpr uint8_t CANONICAL_PREFIX = 0xAA;
 
 constexpr uint16_t PROTOCOL_VERSION = 1;
 
+// Endpoint ID that is reserved for bulk operations on multiple endpoints (see
+// multi_endpoint_handler()). Firmware versions that don't know this endpoint
+// return an empty response.
+constexpr uint16_t MULTI_ENDPOINT_ID = 0x7fff;
+
+// Endpoint ID under which a server pushes telemetry samples to the client.
+// These packets look like requests that don't expect a response. Clients
+// hand their payload to LegacyObjectClient::on_telemetry_.
+constexpr uint16_t TELEMETRY_ENDPOINT_ID = 0x7ffe;
+
 
 class PacketWrapper : public AsyncStreamSink {
 public:
@@ -549,6 +549,60 @@ LibFibreStatus libfibre_call(LibFibreFunction* func, LibFibreCallContext** handl
     }
 }
 
+static LibFibreStatus start_bulk_operation(LibFibreObject* const* properties, size_t n_properties,
+        bool write, fibre::cbufptr_t tx_buf, fibre::bufptr_t rx_buf,
+        libfibre_bulk_cb_t callback, void* cb_ctx) {
+    if (!properties || !n_properties || !callback) {
+        FIBRE_LOG(E) << "invalid argument";
+        return kFibreInvalidArgument;
+    }
+
+    std::vector<fibre::LegacyObject*> objects;
+    for (size_t i = 0; i < n_properties; ++i) {
+        objects.push_back(reinterpret_cast<fibre::LegacyObject*>(properties[i]));
+    }
+
+    struct Ctx { libfibre_bulk_cb_t callback; void* ctx; };
+    struct Ctx* ctx = new Ctx{callback, cb_ctx};
+
+    fibre::Callback<void, fibre::LegacyBulkOperation*, fibre::Status> cb{
+        [](void* ctx_, fibre::LegacyBulkOperation* op, fibre::Status status) {
+            auto ctx = reinterpret_cast<Ctx*>(ctx_);
+            ctx->callback(ctx->ctx, to_c(status), op->n_done_);
+            delete ctx;
+    }, ctx};
+
+    if (!fibre::LegacyBulkOperation::start(objects, write, tx_buf, rx_buf, cb).has_value()) {
+        delete ctx;
+        return kFibreInvalidArgument;
+    }
+
+    return kFibreBusy;
+}
+
+LibFibreStatus libfibre_read_properties(LibFibreObject* const* properties, size_t n_properties,
+        unsigned char* rx_buf, size_t rx_len,
+        libfibre_bulk_cb_t callback, void* cb_ctx) {
+    return start_bulk_operation(properties, n_properties, false, {}, {rx_buf, rx_len}, callback, cb_ctx);
+}
+
+LibFibreStatus libfibre_write_properties(LibFibreObject* const* properties, size_t n_properties,
+        const unsigned char* tx_buf, size_t tx_len,
+        libfibre_bulk_cb_t callback, void* cb_ctx) {
+    return start_bulk_operation(properties, n_properties, true, {tx_buf, tx_len}, {}, callback, cb_ctx);
+}
+
+LibFibreStatus libfibre_set_telemetry_callback(LibFibreObject* obj,
+        libfibre_telemetry_cb_t callback, void* cb_ctx) {
+    if (!obj) {
+        return kFibreInvalidArgument;
+    }
+
+    fibre::LegacyObject* obj_cast = reinterpret_cast<fibre::LegacyObject*>(obj);
+    obj_cast->client->on_telemetry_ = {callback, cb_ctx};
+    return kFibreOk;
+}
+
 void libfibre_start_tx(LibFibreTxStream* tx_stream,
         const uint8_t* tx_buf, size_t tx_len, on_tx_completed_cb_t on_completed,
         void* ctx) {
@@ -5,14 +5,23 @@
 #include <sys/epoll.h>
 #include <sys/types.h>
 #include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include <unistd.h>
 #include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <algorithm>
 
 using namespace fibre;
 
 DEFINE_LOG_TOPIC(EVENT_LOOP);
 USE_LOG_TOPIC(EVENT_LOOP);
 
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
 
 bool EpollEventLoop::start(Callback<void> on_started) {
     if (epoll_fd_ >= 0) {
@@ -28,6 +37,11 @@ bool EpollEventLoop::start(Callback<void> on_started) {
 
     bool ok = true;
 
+    for (size_t i = 0; i < kPostPoolSize; ++i) {
+        post_pool_[i].next_free.store(i + 1 < kPostPoolSize ? i + 2 : 0, std::memory_order_relaxed);
+    }
+    free_posts_.store(1, std::memory_order_release);
+
     post_fd_ = eventfd(0, 0);
 
     bool post_fd_ok = (post_fd_ >= 0)
@@ -39,9 +53,20 @@ bool EpollEventLoop::start(Callback<void> on_started) {
         ok = false;
     }
 
-    // Run for as long as there are callbacks pending posted or there's at least
-    // one file descriptor other than post_fd_ registerd.
-    while (pending_callbacks_.size() || (context_map_.size() > 1)) {
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+
+    bool timer_fd_ok = (timer_fd_ >= 0)
+            && register_event(timer_fd_, EPOLLIN, MEMBER_CB(this, run_timers));
+
+    if (!timer_fd_ok) {
+        FIBRE_LOG(E) << "failed to create an event for timers";
+        ok = false;
+    }
+
+    // Run for as long as there are callbacks pending posted, timers pending or
+    // there's at least one file descriptor other than post_fd_ and timer_fd_
+    // registerd.
+    while (pending_posts_.load() || n_timers_ || (context_map_.size() > 2)) {
         iterations_++;
 
         do {
@@ -85,6 +110,24 @@ bool EpollEventLoop::start(Callback<void> on_started) {
     }
     post_fd_ = -1;
 
+    if ((timer_fd_ >= 0) && !deregister_event(timer_fd_)) {
+        FIBRE_LOG(E) << "deregister_event() failed";
+        ok = false;
+    }
+
+    if ((timer_fd_ >= 0) && close(timer_fd_) != 0) {
+        FIBRE_LOG(E) << "close() failed: " << sys_err();
+        ok = false;
+    }
+    timer_fd_ = -1;
+    armed_tick_ = UINT64_MAX;
+
+    while (free_timers_) {
+        EventLoopTimer* timer = free_timers_;
+        free_timers_ = timer->next;
+        delete timer;
+    }
+
     if (close(epoll_fd_) != 0) {
         FIBRE_LOG(E) << "close() failed: " << sys_err();
         ok = false;
@@ -100,9 +143,17 @@ bool EpollEventLoop::post(Callback<void> callback) {
         return false;
     }
 
-    {
-        std::unique_lock<std::mutex> lock(pending_callbacks_mutex_);
-        pending_callbacks_.push_back(callback);
+    PostNode* node = alloc_post_node();
+    node->callback = callback;
+    PostNode* head = pending_posts_.load(std::memory_order_relaxed);
+    do {
+        node->next = head;
+    } while (!pending_posts_.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+
+    // Only the post that makes the list non-empty needs to wake up the event
+    // loop. Later posts are picked up by the same run_callbacks().
+    if (head) {
+        return true;
     }
 
     const uint64_t val = 1;
@@ -175,13 +226,54 @@ bool EpollEventLoop::deregister_event(int event_fd) {
 }
 
 struct EventLoopTimer* EpollEventLoop::call_later(float delay, Callback<void> callback) {
-    FIBRE_LOG(E) << "not implemented"; // TODO: implement
-    return nullptr;
+    if (timer_fd_ < 0) {
+        FIBRE_LOG(E) << "not started";
+        return nullptr;
+    }
+
+    uint64_t now = now_ns();
+    uint64_t delay_ns = delay > 0.0f ? (uint64_t)((double)delay * 1e9) : 0;
+
+    if (!n_timers_) {
+        // The wheel is empty so it can jump forward to the current time.
+        // This keeps new timers on the lowest possible level.
+        wheel_tick_ = now / 1000000;
+    }
+
+    EventLoopTimer* timer = free_timers_;
+    if (timer) {
+        free_timers_ = timer->next;
+    } else {
+        timer = new EventLoopTimer();
+    }
+
+    // Round up so that the timer never fires early. Timers that expire before
+    // the next tick of the wheel are postponed to that tick.
+    timer->expiry = std::max((now + delay_ns + 999999) / 1000000, wheel_tick_ + 1);
+    timer->callback = callback;
+    insert_timer(timer);
+    n_timers_++;
+
+    if (timer->expiry < armed_tick_) {
+        arm_timer_fd();
+    }
+
+    return timer;
 }
 
 bool EpollEventLoop::cancel_timer(EventLoopTimer* timer) {
-    FIBRE_LOG(E) << "not implemented"; // TODO: implement
-    return false;
+    if (!timer || timer->level == kTimerListFree) {
+        FIBRE_LOG(E) << "timer not running";
+        return false;
+    }
+
+    // timer_fd_ is not rearmed here. If this was the next timer to expire, the
+    // wakeup is spurious and run_timers() rearms the timer for the next one.
+    unlink_timer(timer);
+    n_timers_--;
+    push_timer(&free_timers_, timer, kTimerListFree, 0);
+    timer->callback = nullptr;
+    return true;
 }
 
 void EpollEventLoop::run_callbacks(uint32_t) {
@@ -191,14 +283,225 @@ void EpollEventLoop::run_callbacks(uint32_t) {
         FIBRE_LOG(E) << "failed to read from post file descriptor";
     }
 
-    std::vector<Callback<void>> pending_callbacks;
+    // Callbacks that are posted from here on wake up the event loop again.
+    PostNode* node = pending_posts_.exchange(nullptr, std::memory_order_acquire);
+
+    // Restore the order in which the callbacks were posted
+    PostNode* first = nullptr;
+    while (node) {
+        PostNode* next = node->next;
+        node->next = first;
+        first = node;
+        node = next;
+    }
+
+    while (first) {
+        PostNode* next = first->next;
+        Callback<void> callback = first->callback;
+        free_post_node(first);
+        callback.invoke();
+        first = next;
+    }
+}
+
+/**
+ * @brief Takes a node from the pool. Can be called from any thread.
+ *
+ * Falls back to the heap if more than kPostPoolSize callbacks are pending.
+ */
+EpollEventLoop::PostNode* EpollEventLoop::alloc_post_node() {
+    uint64_t head = free_posts_.load(std::memory_order_acquire);
+    for (;;) {
+        uint32_t index = (uint32_t)head;
+        if (!index) {
+            return new PostNode();
+        }
+        PostNode* node = &post_pool_[index - 1];
+        uint64_t next = ((head >> 32) + 1) << 32 | node->next_free.load(std::memory_order_relaxed);
+        if (free_posts_.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire)) {
+            return node;
+        }
+    }
+}
+
+/**
+ * @brief Returns a node to the pool. Only called on the event loop thread.
+ */
+void EpollEventLoop::free_post_node(PostNode* node) {
+    if (node < post_pool_ || node >= post_pool_ + kPostPoolSize) {
+        delete node;
+        return;
+    }
+
+    uint32_t index = (uint32_t)(node - post_pool_) + 1;
+    uint64_t head = free_posts_.load(std::memory_order_relaxed);
+    uint64_t next;
+    do {
+        node->next_free.store((uint32_t)head, std::memory_order_relaxed);
+        next = ((head >> 32) + 1) << 32 | index;
+    } while (!free_posts_.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void EpollEventLoop::run_timers(uint32_t) {
+    uint64_t val;
+    if (read(timer_fd_, &val, sizeof(val)) != sizeof(val)) {
+        // Happens if the timer was rearmed after it had already expired.
+        FIBRE_LOG(D) << "spurious timer event";
+    }
+    armed_tick_ = UINT64_MAX;
+
+    advance_timers(now_ns() / 1000000);
+
+    // Callbacks can start new timers but those are never due before the next
+    // tick so this loop terminates.
+    while (due_timers_) {
+        EventLoopTimer* timer = due_timers_;
+        Callback<void> callback = timer->callback;
+        unlink_timer(timer);
+        n_timers_--;
+        push_timer(&free_timers_, timer, kTimerListFree, 0);
+        timer->callback = nullptr;
+        callback.invoke();
+    }
+
+    arm_timer_fd();
+}
+
+void EpollEventLoop::insert_timer(EventLoopTimer* timer) {
+    if (timer->expiry <= wheel_tick_) {
+        push_timer(&due_timers_, timer, kTimerListDue, 0);
+        return;
+    }
+
+    // Use the lowest level on which the timer expires within the current
+    // rotation. All higher bits of expiry and wheel_tick_ are equal.
+    uint64_t diff = timer->expiry ^ wheel_tick_;
+    for (uint8_t level = 0; level < kTimerWheelLevels; ++level) {
+        unsigned shift = level * kTimerWheelBits;
+        if (!(diff >> (shift + kTimerWheelBits))) {
+            uint8_t slot = (timer->expiry >> shift) & (kTimerWheelSlots - 1);
+            push_timer(&timer_wheel_[level][slot], timer, level, slot);
+            timer_wheel_occupied_[level] |= (uint64_t)1 << slot;
+            return;
+        }
+    }
+
+    push_timer(&overflow_timers_, timer, kTimerListOverflow, 0);
+}
+
+void EpollEventLoop::unlink_timer(EventLoopTimer* timer) {
+    *timer->pprev = timer->next;
+    if (timer->next) {
+        timer->next->pprev = timer->pprev;
+    }
+    if (timer->level < kTimerWheelLevels && !timer_wheel_[timer->level][timer->slot]) {
+        timer_wheel_occupied_[timer->level] &= ~((uint64_t)1 << timer->slot);
+    }
+}
+
+void EpollEventLoop::push_timer(EventLoopTimer** list, EventLoopTimer* timer, uint8_t level, uint8_t slot) {
+    timer->next = *list;
+    if (timer->next) {
+        timer->next->pprev = &timer->next;
+    }
+    timer->pprev = list;
+    timer->level = level;
+    timer->slot = slot;
+    *list = timer;
+}
+
+/**
+ * @brief Returns the tick at which the wheel has to do work next, that is
+ * either a level 0 slot expires or a slot on a higher level (or the overflow
+ * list) must be moved down.
+ *
+ * Returns UINT64_MAX if there are no timers on the wheel.
+ */
+uint64_t EpollEventLoop::next_timer_tick() {
+    // All occupied slots are ahead of the wheel's current position on their
+    // level and the slots of a lower level come before those of a higher level.
+    for (unsigned level = 0; level < kTimerWheelLevels; ++level) {
+        if (timer_wheel_occupied_[level]) {
+            unsigned shift = level * kTimerWheelBits;
+            uint64_t slot = __builtin_ctzll(timer_wheel_occupied_[level]);
+            return ((wheel_tick_ >> (shift + kTimerWheelBits)) << (shift + kTimerWheelBits)) | (slot << shift);
+        }
+    }
+
+    if (overflow_timers_) {
+        unsigned shift = kTimerWheelLevels * kTimerWheelBits;
+        return ((wheel_tick_ >> shift) + 1) << shift;
+    }
+
+    return UINT64_MAX;
+}
+
+/**
+ * @brief Moves the wheel forward to `now` and moves all timers that expired
+ * up to then to the due list.
+ *
+ * The wheel only stops at ticks where there's work to do so the cost doesn't
+ * depend on how much time has passed.
+ */
+void EpollEventLoop::advance_timers(uint64_t now) {
+    for (;;) {
+        uint64_t tick = next_timer_tick();
+        if (tick > now) {
+            break;
+        }
+        wheel_tick_ = tick;
+
+        // Cascade from high to low so that timers which move down several
+        // levels are handled within the same tick.
+        unsigned shift = kTimerWheelLevels * kTimerWheelBits;
+        if (!(tick & (((uint64_t)1 << shift) - 1))) {
+            EventLoopTimer* timer = overflow_timers_;
+            overflow_timers_ = nullptr;
+            while (timer) {
+                EventLoopTimer* next = timer->next;
+                insert_timer(timer);
+                timer = next;
+            }
+        }
+
+        for (unsigned level = kTimerWheelLevels; level-- > 0;) {
+            shift = level * kTimerWheelBits;
+            if (tick & (((uint64_t)1 << shift) - 1)) {
+                continue;
+            }
+            uint8_t slot = (tick >> shift) & (kTimerWheelSlots - 1);
+            EventLoopTimer* timer = timer_wheel_[level][slot];
+            timer_wheel_[level][slot] = nullptr;
+            timer_wheel_occupied_[level] &= ~((uint64_t)1 << slot);
+            while (timer) {
+                EventLoopTimer* next = timer->next;
+                insert_timer(timer); // goes to a lower level or the due list
+                timer = next;
+            }
+        }
+    }
+
+    if (now > wheel_tick_) {
+        wheel_tick_ = now;
+    }
+}
+
+void EpollEventLoop::arm_timer_fd() {
+    uint64_t tick = due_timers_ ? wheel_tick_ : next_timer_tick();
+    if (tick == armed_tick_) {
+        return;
+    }
 
-    {
-        std::unique_lock<std::mutex> lock(pending_callbacks_mutex_);
-        std::swap(pending_callbacks, pending_callbacks_);
+    // An all-zero value disarms the timer. A tick in the past fires immediately.
+    struct itimerspec spec = {};
+    if (tick != UINT64_MAX) {
+        spec.it_value.tv_sec = tick / 1000;
+        spec.it_value.tv_nsec = (tick % 1000) * 1000000;
     }
 
-    for (auto& cb: pending_callbacks) {
-        cb.invoke();
+    if (timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
+        FIBRE_LOG(E) << "timerfd_settime() failed: " << sys_err();
+        return;
     }
+    armed_tick_ = tick;
 }
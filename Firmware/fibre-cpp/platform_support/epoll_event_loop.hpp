@@ -5,13 +5,28 @@
 #include <sys/epoll.h>
 #include <unordered_map>
 #include <vector>
-#include <mutex>
+#include <atomic>
 //#include <algorithm>
 
 #include <fibre/event_loop.hpp>
 
 namespace fibre {
 
+/**
+ * @brief Timer of EpollEventLoop.
+ *
+ * Timers are kept in intrusive lists so that starting and cancelling a timer
+ * takes constant time. Timer objects are recycled by the event loop.
+ */
+struct EventLoopTimer {
+    EventLoopTimer* next;
+    EventLoopTimer** pprev; // next pointer of the previous timer or list head
+    uint64_t expiry; // [ms] on CLOCK_MONOTONIC
+    uint8_t level; // wheel level or one of EpollEventLoop::kTimerList*
+    uint8_t slot;
+    Callback<void> callback;
+};
+
 /**
  * @brief Event loop based on the Linux-specific `epoll()` infrastructure.
  * 
@@ -20,6 +35,8 @@ namespace fibre {
  * loop, that means register_event() and deregister_event() can be called from
  * within an event callback (which executes on the event loop thread), provided
  * those calls are properly synchronized with calls from other threads.
+ * The exception is post() which can be called from any number of threads
+ * concurrently once the event loop is running.
  */
 class EpollEventLoop : public EventLoop {
 public:
@@ -45,10 +62,44 @@ private:
         Callback<void, uint32_t> callback;
     };
 
+    struct PostNode {
+        PostNode* next; // next node in pending_posts_
+        std::atomic<uint32_t> next_free; // 1 + index of the next node in free_posts_, 0 at the end
+        Callback<void> callback;
+    };
+
     void run_callbacks(uint32_t);
+    PostNode* alloc_post_node();
+    void free_post_node(PostNode* node);
+
+    void run_timers(uint32_t);
+    void insert_timer(EventLoopTimer* timer);
+    void unlink_timer(EventLoopTimer* timer);
+    void push_timer(EventLoopTimer** list, EventLoopTimer* timer, uint8_t level, uint8_t slot);
+    uint64_t next_timer_tick();
+    void advance_timers(uint64_t now);
+    void arm_timer_fd();
+
+    // Timers are sorted into a hierarchical timer wheel with a resolution of
+    // 1 ms. Level 0 holds the timers that expire within the current 64 ms,
+    // level 1 the ones within the current 4096 ms and so on. When the wheel
+    // reaches the start of a slot on a higher level, the timers in that slot
+    // are moved down. Timers beyond the top level (about 4.6 hours) wait in a
+    // separate list.
+    static constexpr unsigned kTimerWheelBits = 6;
+    static constexpr unsigned kTimerWheelSlots = 1 << kTimerWheelBits;
+    static constexpr unsigned kTimerWheelLevels = 4;
+    static constexpr uint8_t kTimerListOverflow = kTimerWheelLevels;
+    static constexpr uint8_t kTimerListDue = kTimerWheelLevels + 1;
+    static constexpr uint8_t kTimerListFree = kTimerWheelLevels + 2;
+
+    // Number of posted callbacks that can be pending without allocating
+    // memory
+    static constexpr size_t kPostPoolSize = 256;
 
     int epoll_fd_ = -1;
     int post_fd_ = -1;
+    int timer_fd_ = -1;
     unsigned int iterations_ = 0;
 
     std::unordered_map<int, EventContext*> context_map_; // required to deregister callbacks
@@ -57,11 +108,25 @@ private:
     int n_triggered_events_ = 0;
     struct epoll_event triggered_events_[max_triggered_events_];
 
-    // List of callbacks that were submitted through post().
-    std::vector<Callback<void>> pending_callbacks_;
+    // Callbacks that were submitted through post(), newest first. Producers
+    // push with compare-and-swap, the event loop takes the whole list at once.
+    std::atomic<PostNode*> pending_posts_{nullptr};
+
+    // Unused nodes of post_pool_. The lower 32 bits hold 1 + the index of the
+    // first node (0 if empty), the upper 32 bits a counter that is incremented
+    // on every change so that a producer can't pop a node based on a stale
+    // next_free (ABA problem).
+    std::atomic<uint64_t> free_posts_{0};
+    PostNode post_pool_[kPostPoolSize];
 
-    // Mutex to protect pending_callbacks_
-    std::mutex pending_callbacks_mutex_;
+    uint64_t wheel_tick_ = 0; // [ms] all timers up to this time were moved to the due list
+    uint64_t armed_tick_ = UINT64_MAX; // [ms] expiry of timer_fd_, UINT64_MAX if disarmed
+    size_t n_timers_ = 0; // number of timers that were started and have not yet run or been cancelled
+    EventLoopTimer* timer_wheel_[kTimerWheelLevels][kTimerWheelSlots] = {};
+    uint64_t timer_wheel_occupied_[kTimerWheelLevels] = {}; // bit i is set if timer_wheel_[level][i] is not empty
+    EventLoopTimer* overflow_timers_ = nullptr;
+    EventLoopTimer* due_timers_ = nullptr;
+    EventLoopTimer* free_timers_ = nullptr;
 };
 
 }
@@ -21,9 +21,9 @@ using namespace fibre;
 DEFINE_LOG_TOPIC(USB);
 USE_LOG_TOPIC(USB);
 
-// This probably has no noteworthy effect since we automatically restart
-// timed out operations anyway.
-constexpr unsigned int kBulkTimeoutMs = 10000;
+// Number of transfers that are kept in flight per bulk endpoint unless
+// overridden by the "queue_depth" key of the discovery specs.
+constexpr size_t kDefaultQueueDepth = 4;
 
 // Only relevant for platforms don't support hotplug detection and thus
 // need polling.
@@ -150,6 +150,13 @@ bool LibusbDiscoverer::deinit(int stage) {
         device_polling_timer_ = nullptr;
     }
 
+    // A pending libusb timeout would otherwise keep the event loop running
+    // and fire after libusb_ctx_ is gone.
+    if (event_loop_timer_) {
+        event_loop_->cancel_timer(event_loop_timer_);
+        event_loop_timer_ = nullptr;
+    }
+
     if (stage > 2 && !run_internal_event_loop_) {
         // Deregister libusb events from our event loop.
         const struct libusb_pollfd** pollfds = libusb_get_pollfds(libusb_ctx_);
@@ -226,6 +233,7 @@ void LibusbDiscoverer::start_channel_discovery(Domain* domain, const char* specs
     try_parse_key(specs, specs + specs_len, "bInterfaceClass", &interface_specs.interface_class);
     try_parse_key(specs, specs + specs_len, "bInterfaceSubClass", &interface_specs.interface_subclass);
     try_parse_key(specs, specs + specs_len, "bInterfaceProtocol", &interface_specs.interface_protocol);
+    try_parse_key(specs, specs + specs_len, "queue_depth", &interface_specs.queue_depth);
 
     MyChannelDiscoveryContext* subscription = new MyChannelDiscoveryContext{};
     subscription->interface_specs = interface_specs;
@@ -293,7 +301,7 @@ void LibusbDiscoverer::on_event_loop_iteration() {
         float timeout_sec = (float)timeout.tv_sec + (float)timeout.tv_usec * 1e-6;
         FIBRE_LOG(D) << "setting event loop timeout to " << timeout_sec << " s";
         event_loop_timer_ = event_loop_->call_later(timeout_sec,
-            MEMBER_CB(this, on_event_loop_iteration));
+            MEMBER_CB(this, on_event_loop_timer));
     }
 }
 
@@ -499,9 +507,11 @@ void LibusbDiscoverer::consider_device(struct libusb_device *device, MyChannelDi
                 }
 
                 size_t mtu = SIZE_MAX;
+                size_t queue_depth = subscription->interface_specs.queue_depth > 0 ?
+                                     (size_t)subscription->interface_specs.queue_depth : kDefaultQueueDepth;
 
                 LibusbBulkInEndpoint* ep_in = new LibusbBulkInEndpoint();
-                if (libusb_ep_in && ep_in->init(this, my_dev.handle, libusb_ep_in->bEndpointAddress)) {
+                if (libusb_ep_in && ep_in->init(this, my_dev.handle, libusb_ep_in->bEndpointAddress, libusb_ep_in->wMaxPacketSize, queue_depth)) {
                     my_dev.ep_in.push_back(ep_in);
                     mtu = std::min(mtu, (size_t)libusb_ep_in->wMaxPacketSize);
                 } else {
@@ -510,7 +520,7 @@ void LibusbDiscoverer::consider_device(struct libusb_device *device, MyChannelDi
                 }
 
                 LibusbBulkOutEndpoint* ep_out = new LibusbBulkOutEndpoint();
-                if (libusb_ep_out && ep_out->init(this, my_dev.handle, libusb_ep_out->bEndpointAddress)) {
+                if (libusb_ep_out && ep_out->init(this, my_dev.handle, libusb_ep_out->bEndpointAddress, libusb_ep_out->wMaxPacketSize, queue_depth)) {
                     my_dev.ep_out.push_back(ep_out);
                     mtu = std::min(mtu, (size_t)libusb_ep_out->wMaxPacketSize);
                 } else {
@@ -531,11 +541,56 @@ void LibusbDiscoverer::consider_device(struct libusb_device *device, MyChannelDi
 /* LibusbBulkEndpoint --------------------------------------------------------*/
 
 template<typename TRes>
-bool LibusbBulkEndpoint<TRes>::init(LibusbDiscoverer* parent, libusb_device_handle* handle, uint8_t endpoint_id) {
+void LibusbBulkEndpoint<TRes>::Slot::on_finished() {
+    if (ep) {
+        ep->on_transfer_finished(this);
+    } else {
+        libusb_free_transfer(transfer);
+        delete this;
+    }
+}
+
+template<typename TRes>
+bool LibusbBulkEndpoint<TRes>::init(LibusbDiscoverer* parent, libusb_device_handle* handle, uint8_t endpoint_id, size_t max_packet_size, size_t queue_depth) {
     parent_ = parent;
     handle_ = handle;
-    transfer_ = libusb_alloc_transfer(0);
     endpoint_id_ = endpoint_id;
+
+    auto direct_callback = [](struct libusb_transfer* transfer){
+        ((Slot*)transfer->user_data)->on_finished();
+    };
+
+    // This callback is used if we start our own libusb thread
+    // separate from the application's event loop thread
+    auto indirect_callback = [](struct libusb_transfer* transfer){
+        auto slot = (Slot*)transfer->user_data;
+        if (slot->ep) {
+            slot->ep->parent_->event_loop_->post(MEMBER_CB(slot, on_finished));
+        } else {
+            slot->on_finished();
+        }
+    };
+
+    for (size_t i = 0; i < std::max(queue_depth, (size_t)1); ++i) {
+        struct libusb_transfer* transfer = libusb_alloc_transfer(0);
+        if (!transfer) {
+            FIBRE_LOG(E) << "libusb_alloc_transfer() failed";
+            deinit();
+            return false;
+        }
+
+        Slot* slot = new Slot{this, transfer, std::vector<uint8_t>(max_packet_size), false, kStreamOk, 0};
+
+        // No timeout: A transfer that times out would be resubmitted behind
+        // the other transfers in flight and thereby change the order of the data.
+        libusb_fill_bulk_transfer(transfer, handle_, endpoint_id_,
+            slot->buffer.data(), 0,
+            parent_->using_sparate_libusb_thread_ ? indirect_callback : direct_callback,
+            slot, 0);
+
+        slots_.push_back(slot);
+    }
+
     return true;
 }
 
@@ -545,8 +600,21 @@ bool LibusbBulkEndpoint<TRes>::deinit() {
         FIBRE_LOG(E) << "Transfer on EP " << as_hex(endpoint_id_) << " still in progress. This is gonna be messy.";
     }
 
-    libusb_free_transfer(transfer_);
-    transfer_ = nullptr;
+    // Transfers that are still in flight are freed when they finish.
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        Slot* slot = this->slot(i);
+        if (i < n_active_ && !slot->finished) {
+            slot->ep = nullptr;
+            libusb_cancel_transfer(slot->transfer);
+        } else {
+            libusb_free_transfer(slot->transfer);
+            delete slot;
+        }
+    }
+
+    slots_.clear();
+    head_ = 0;
+    n_active_ = 0;
     return true;
 }
 
@@ -562,31 +630,20 @@ void LibusbBulkEndpoint<TRes>::start_transfer(bufptr_t buffer, TransferHandle* h
         return;
     }
 
-    if (!handle_) {
+    if (!handle_ && !n_active_ && error_ == kStreamOk) {
         FIBRE_LOG(E) << "device not open";
         completer.invoke({kStreamError, nullptr});
         return;
     }
 
-    auto direct_callback = [](struct libusb_transfer* transfer){
-        ((LibusbBulkEndpoint<TRes>*)transfer->user_data)->on_transfer_finished();
-    };
-
-    // This callback is used if we start our own libusb thread
-    // separate from the application's event loop thread
-    auto indirect_callback = [](struct libusb_transfer* transfer){
-        auto ep = (LibusbBulkEndpoint<TRes>*)transfer->user_data;
-        ep->parent_->event_loop_->post(MEMBER_CB(ep, on_transfer_finished));
-    };
-
     //FIBRE_LOG(D) << "transfer of size " << buffer.size();
-    libusb_fill_bulk_transfer(transfer_, handle_, endpoint_id_,
-        buffer.begin(), buffer.size(),
-        parent_->using_sparate_libusb_thread_ ? indirect_callback : direct_callback,
-        this, kBulkTimeoutMs);
-    
+    buffer_ = buffer;
     completer_ = completer;
-    submit_transfer();
+
+    if (is_in()) {
+        fill_read_ahead();
+    }
+    deliver();
 }
 
 template<typename TRes>
@@ -596,40 +653,153 @@ void LibusbBulkEndpoint<TRes>::cancel_transfer(TransferHandle transfer_handle) {
         return;
     }
 
-    libusb_cancel_transfer(transfer_);
+    if (!is_in()) {
+        // A pending write only waits for a free transfer. The transfers in
+        // flight belong to earlier writes that were already reported as
+        // successful so they are left alone.
+        completer_.invoke_and_clear({kStreamCancelled, buffer_.begin()});
+        return;
+    }
+
+    // A pending read always waits for the oldest transfer so the completer
+    // is invoked once that transfer comes back cancelled.
+    stop();
 }
 
+/**
+ * @brief Submits the first idle slot with the given length.
+ */
 template<typename TRes>
-void LibusbBulkEndpoint<TRes>::submit_transfer() {
-    int result = libusb_submit_transfer(transfer_);
+StreamStatus LibusbBulkEndpoint<TRes>::submit_transfer(size_t length) {
+    Slot* slot = this->slot(n_active_);
+    slot->transfer->length = (int)length;
+    slot->finished = false;
+    slot->offset = 0;
+
+    int result = libusb_submit_transfer(slot->transfer);
     if (LIBUSB_SUCCESS == result) {
         // ok
         FIBRE_LOG(T) << "started USB transfer on EP " << as_hex(endpoint_id_);
+        n_active_++;
+        return kStreamOk;
     } else if (LIBUSB_ERROR_NO_DEVICE == result) {
         FIBRE_LOG(W) << "couldn't start USB transfer on EP " << as_hex(endpoint_id_) << ": " << libusb_error_name(result);
-        completer_.invoke_and_clear({kStreamClosed, nullptr});
+        return kStreamClosed;
     } else {
         FIBRE_LOG(W) << "couldn't start USB transfer on EP " << as_hex(endpoint_id_) << ": " << libusb_error_name(result);
-        completer_.invoke_and_clear({kStreamError, nullptr});
+        return kStreamError;
     }
 }
 
 template<typename TRes>
-void LibusbBulkEndpoint<TRes>::on_transfer_finished() {
-    // We ignore timeouts here and just retry. If the application wishes to have
-    // a timeout on the transfer it can just call cancel_transfer() after a while.
-    if (transfer_->status == LIBUSB_TRANSFER_TIMED_OUT) {
-        submit_transfer();
+void LibusbBulkEndpoint<TRes>::release_head() {
+    slot(0)->finished = false;
+    head_ = (head_ + 1) % slots_.size();
+    n_active_--;
+
+    if (!n_active_) {
+        stopping_ = false;
+        discard_ = false;
+    }
+}
+
+/**
+ * @brief Cancels all transfers in flight and stops submitting new ones until
+ * all of them finished.
+ */
+template<typename TRes>
+void LibusbBulkEndpoint<TRes>::stop() {
+    stopping_ = true;
+    for (size_t i = 0; i < n_active_; ++i) {
+        if (!slot(i)->finished) {
+            libusb_cancel_transfer(slot(i)->transfer);
+        }
+    }
+}
+
+template<typename TRes>
+void LibusbBulkEndpoint<TRes>::fill_read_ahead() {
+    while (!stopping_ && handle_ && n_active_ < slots_.size()) {
+        StreamStatus status = submit_transfer(slot(n_active_)->buffer.size());
+        if (status != kStreamOk) {
+            if (!n_active_) {
+                error_ = status;
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Completes the pending operation if possible.
+ *
+ * The completer is invoked at the very end so that it can start the next
+ * operation right away.
+ */
+template<typename TRes>
+void LibusbBulkEndpoint<TRes>::deliver() {
+    if (!completer_) {
         return;
     }
-    
-    libusb_device* dev = libusb_get_device(handle_);
+
+    StreamStatus status;
+    unsigned char* end = buffer_.begin();
+
+    if (error_ != kStreamOk && !(is_in() && n_active_)) {
+        status = error_;
+        error_ = kStreamOk;
+
+    } else if (is_in()) {
+        if (!n_active_ || !slot(0)->finished) {
+            return;
+        }
+
+        Slot* slot = this->slot(0);
+        status = slot->status;
+
+        if (status == kStreamOk) {
+            size_t n_copy = std::min(buffer_.size(), (size_t)slot->transfer->actual_length - slot->offset);
+            memcpy(buffer_.begin(), slot->buffer.data() + slot->offset, n_copy);
+            slot->offset += n_copy;
+            end += n_copy;
+            if (slot->offset >= (size_t)slot->transfer->actual_length) {
+                release_head();
+                fill_read_ahead();
+            }
+        } else {
+            // Whatever was received after a failed transfer is dropped.
+            release_head();
+            discard_ = n_active_ > 0;
+            while (discard_ && this->slot(0)->finished) {
+                release_head();
+            }
+        }
+
+    } else {
+        if (n_active_ == slots_.size()) {
+            return; // wait for the oldest transfer
+        }
+
+        size_t n_copy = std::min(buffer_.size(), slot(n_active_)->buffer.size());
+        memcpy(slot(n_active_)->buffer.data(), buffer_.begin(), n_copy);
+        status = submit_transfer(n_copy);
+        if (status == kStreamOk) {
+            end += n_copy;
+        }
+    }
+
+    completer_.invoke_and_clear({status, end});
+}
+
+template<typename TRes>
+void LibusbBulkEndpoint<TRes>::on_transfer_finished(Slot* slot) {
+    libusb_device* dev = libusb_get_device(slot->transfer->dev_handle);
 
     StreamStatus status;
 
-    if (transfer_->status == LIBUSB_TRANSFER_COMPLETED) {
+    if (slot->transfer->status == LIBUSB_TRANSFER_COMPLETED) {
         status = kStreamOk;
-    } else if (transfer_->status == LIBUSB_TRANSFER_CANCELLED) {
+    } else if (slot->transfer->status == LIBUSB_TRANSFER_CANCELLED) {
         status = kStreamCancelled;
     } else {
         // The error that we get on device removal tends to be inaccurate.
@@ -664,21 +834,59 @@ void LibusbBulkEndpoint<TRes>::on_transfer_finished() {
     }
 
     (status == kStreamError ? FIBRE_LOG(W) : FIBRE_LOG(T))
-        << "USB transfer on EP " << as_hex(endpoint_id_) << " finished with " << libusb_error_name(transfer_->status);
+        << "USB transfer on EP " << as_hex(endpoint_id_) << " finished with " << libusb_error_name(slot->transfer->status);
 
     if (status == kStreamClosed) {
         handle_ = nullptr; // Ensure that no new transfer is started
+        device_left_ = true;
+    }
+
+    slot->status = status;
+    slot->finished = true;
+
+    if (is_in() && status != kStreamOk && !stopping_) {
+        stop();
+    }
+
+    if (is_in()) {
+        while (discard_ && this->slot(0)->finished) {
+            release_head();
+        }
+        if (completer_) {
+            fill_read_ahead();
+        }
+    } else {
+        // Writes were already reported as successful so only the first error
+        // is kept for the next write. Cancellations are not errors of the
+        // stream.
+        while (n_active_ && this->slot(0)->finished) {
+            StreamStatus slot_status = this->slot(0)->status;
+            if (slot_status != kStreamOk && slot_status != kStreamCancelled && error_ == kStreamOk) {
+                error_ = slot_status;
+            }
+            release_head();
+        }
     }
 
-    uint8_t* end = std::max(transfer_->buffer + transfer_->actual_length, transfer_->buffer);
-    completer_.invoke_and_clear({status, end});
-    
     // If libusb does hotplug detection itself then we don't need to handle
     // device removal here. Libusb will call the corresponding hotplug callback.
-    if (status == kStreamClosed && !parent_->hotplug_callback_handle_) {
+    // Otherwise we wait until no transfers are left in flight.
+    bool device_left = device_left_ && !n_active_ && !parent_->hotplug_callback_handle_;
+    if (device_left) {
+        device_left_ = false;
+    }
+
+    deliver();
+
+    if (device_left) {
         if (!parent_->using_sparate_libusb_thread_) {
             FIBRE_LOG(E) << "It's not a good idea to unref the device from within this callback. This will probably hang.";
         }
         parent_->on_hotplug(dev, LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT);
     }
 }
+
+// Explicit instantiation so that the endpoints can also be used from other
+// translation units
+template class fibre::LibusbBulkEndpoint<fibre::ReadResult>;
+template class fibre::LibusbBulkEndpoint<fibre::WriteResult>;
@@ -28,6 +28,7 @@ public:
         int interface_class = -1; // -1 to ignore
         int interface_subclass = -1; // -1 to ignore
         int interface_protocol = -1; // -1 to ignore
+        int queue_depth = -1; // number of transfers in flight per endpoint, -1 for the default
     };
 
     struct MyChannelDiscoveryContext : ChannelDiscoveryContext {
@@ -56,6 +57,7 @@ private:
     void internal_event_loop();
     void on_event_loop_iteration();
     void on_event_loop_iteration2(uint32_t) { on_event_loop_iteration(); }
+    void on_event_loop_timer() { event_loop_timer_ = nullptr; on_event_loop_iteration(); }
     void on_add_pollfd(int fd, short events);
     void on_remove_pollfd(int fd);
     int on_hotplug(struct libusb_device *dev, libusb_hotplug_event event);
@@ -68,16 +70,30 @@ private:
     libusb_hotplug_callback_handle hotplug_callback_handle_ = 0;
     bool run_internal_event_loop_ = false;
     std::thread* internal_event_loop_thread_;
-    EventLoopTimer* device_polling_timer_;
+    EventLoopTimer* device_polling_timer_ = nullptr;
     EventLoopTimer* event_loop_timer_ = nullptr;
     std::unordered_map<uint16_t, Device> known_devices_; // key: bus_number << 8 | dev_number
     std::vector<MyChannelDiscoveryContext*> subscriptions_;
 };
 
+/**
+ * @brief Bulk endpoint with a queue of pre-allocated transfers.
+ *
+ * To keep the bus busy, up to `queue_depth` transfers of one packet each are
+ * in flight at the same time:
+ *  - IN endpoints read ahead as soon as the first read was started. Received
+ *    packets are buffered and passed to start_read() in the order in which
+ *    they arrived.
+ *  - OUT endpoints copy the data of start_write() into a free transfer and
+ *    complete the write right away. Only when all transfers are in flight,
+ *    the write completes once the oldest transfer finished. If a transfer
+ *    fails, the error is reported to the next write. cancel_write() only
+ *    affects such a waiting write, transfers in flight are not cancelled.
+ */
 template<typename TRes>
 class LibusbBulkEndpoint {
 public:
-    bool init(LibusbDiscoverer* parent, struct libusb_device_handle* handle, uint8_t endpoint_id);
+    bool init(LibusbDiscoverer* parent, struct libusb_device_handle* handle, uint8_t endpoint_id, size_t max_packet_size, size_t queue_depth);
     bool deinit();
 
 protected:
@@ -85,13 +101,40 @@ protected:
     void cancel_transfer(TransferHandle transfer_handle);
 
 private:
-    void submit_transfer();
-    void on_transfer_finished();
+    struct Slot {
+        LibusbBulkEndpoint* ep; // nullptr if the endpoint was deinited while the transfer was in flight
+        struct libusb_transfer* transfer;
+        std::vector<uint8_t> buffer;
+        bool finished; // set if the transfer finished but its result was not yet processed
+        StreamStatus status;
+        size_t offset; // number of bytes of a received packet that were already read
+        void on_finished();
+    };
+
+    bool is_in() { return (endpoint_id_ & 0x80) == LIBUSB_ENDPOINT_IN; }
+    Slot* slot(size_t i) { return slots_[(head_ + i) % slots_.size()]; }
+    StreamStatus submit_transfer(size_t length);
+    void release_head();
+    void stop();
+    void fill_read_ahead();
+    void deliver();
+    void on_transfer_finished(Slot* slot);
 
     LibusbDiscoverer* parent_ = nullptr;
     struct libusb_device_handle* handle_ = nullptr;
     uint8_t endpoint_id_ = 0;
-    struct libusb_transfer* transfer_ = nullptr;
+
+    // Ring of transfers. The slots [head_, head_ + n_active_) are in flight or
+    // hold a result that was not yet processed, in the order of submission.
+    std::vector<Slot*> slots_;
+    size_t head_ = 0;
+    size_t n_active_ = 0;
+    bool stopping_ = false; // IN only: no new transfers are submitted until all slots are idle
+    bool discard_ = false; // results behind a failed IN transfer are dropped
+    StreamStatus error_ = kStreamOk; // error that is reported to the next operation
+    bool device_left_ = false;
+
+    bufptr_t buffer_;
     Callback<void, TRes> completer_ = nullptr;
 };
 
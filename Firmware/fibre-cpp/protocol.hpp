@@ -16,6 +16,7 @@ see protocol.md for the protocol specification
 #include <fibre/cpp_utils.hpp>
 #include <fibre/bufptr.hpp>
 #include <fibre/simple_serdes.hpp>
+#include <fibre/number_format.hpp>
 
 
 typedef struct {
@@ -23,6 +24,14 @@ typedef struct {
     uint16_t endpoint_id;
 } endpoint_ref_t;
 
+// Fixed size block of floats, used to transfer bulk data in a single endpoint
+// operation. 15 floats are the most that fit into one USB packet.
+typedef struct {
+    float values[15];
+} float32x15_t;
+
+class Introspectable;
+
 
 namespace fibre {
 // These symbols are defined in the autogenerated endpoints.hpp
@@ -32,8 +41,10 @@ extern const uint16_t json_crc_;
 extern const uint32_t json_version_id_;
 bool endpoint_handler(int idx, cbufptr_t* input_buffer, bufptr_t* output_buffer);
 bool endpoint0_handler(cbufptr_t* input_buffer, bufptr_t* output_buffer);
+bool multi_endpoint_handler(cbufptr_t* input_buffer, bufptr_t* output_buffer);
 bool is_endpoint_ref_valid(endpoint_ref_t endpoint_ref);
 bool set_endpoint_from_float(endpoint_ref_t endpoint_ref, float value);
+bool get_float_readable_endpoint(endpoint_ref_t endpoint_ref, Introspectable* property);
 }
 
 
@@ -110,6 +121,27 @@ template<> struct Codec<endpoint_ref_t> {
             && SimpleSerializer<uint16_t, false>::write(value.json_crc, &(buffer->begin()), buffer->end());
     }
 };
+template<> struct Codec<float32x15_t> {
+    static std::optional<float32x15_t> decode(cbufptr_t* buffer) {
+        float32x15_t value;
+        for (float& val: value.values) {
+            std::optional<float> decoded = Codec<float>::decode(buffer);
+            if (!decoded.has_value()) {
+                return std::nullopt;
+            }
+            val = *decoded;
+        }
+        return value;
+    }
+    static bool encode(float32x15_t value, bufptr_t* buffer) {
+        for (float val: value.values) {
+            if (!Codec<float>::encode(val, buffer)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
 }
 
 
@@ -122,101 +154,38 @@ template<> struct Codec<endpoint_ref_t> {
 */
 
 template<typename T>
-struct format_traits_t;
+using enable_if_number_t = std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value>;
 
-// template<> struct format_traits_t<float> { using type = void;
-//     static constexpr const char * fmt = "%f";
-//     static constexpr const char * fmtp = "%f";
-// };
-template<> struct format_traits_t<long long> { using type = void;
-    static constexpr const char * fmt = "%lld";
-    static constexpr const char * fmtp = "%lld";
-};
-template<> struct format_traits_t<unsigned long long> { using type = void;
-    static constexpr const char * fmt = "%llu";
-    static constexpr const char * fmtp = "%llu";
-};
-template<> struct format_traits_t<long> { using type = void;
-    static constexpr const char * fmt = "%ld";
-    static constexpr const char * fmtp = "%ld";
-};
-template<> struct format_traits_t<unsigned long> { using type = void;
-    static constexpr const char * fmt = "%lu";
-    static constexpr const char * fmtp = "%lu";
-};
-template<> struct format_traits_t<int> { using type = void;
-    static constexpr const char * fmt = "%d";
-    static constexpr const char * fmtp = "%d";
-};
-template<> struct format_traits_t<unsigned int> { using type = void;
-    static constexpr const char * fmt = "%ud";
-    static constexpr const char * fmtp = "%ud";
-};
-template<> struct format_traits_t<short> { using type = void;
-    static constexpr const char * fmt = "%hd";
-    static constexpr const char * fmtp = "%hd";
-};
-template<> struct format_traits_t<unsigned short> { using type = void;
-    static constexpr const char * fmt = "%hu";
-    static constexpr const char * fmtp = "%hu";
-};
-template<> struct format_traits_t<char> { using type = void;
-    static constexpr const char * fmt = "%hhd";
-    static constexpr const char * fmtp = "%d";
-};
-template<> struct format_traits_t<unsigned char> { using type = void;
-    static constexpr const char * fmt = "%hhu";
-    static constexpr const char * fmtp = "%u";
-};
-
-template<typename T, typename = typename format_traits_t<T>::type>
+template<typename T, typename = enable_if_number_t<T>>
 static bool to_string(const T& value, char * buffer, size_t length, int) {
-    snprintf(buffer, length, format_traits_t<T>::fmtp, value);
-    return true;
+    return fibre::format_number(value, buffer, length) > 0;
 }
-// Special case for float because printf promotes float to double, and we get warnings
 template<typename T = float>
 static bool to_string(const float& value, char * buffer, size_t length, int) {
-    snprintf(buffer, length, "%f", (double)value);
-    return true;
+    return fibre::format_number(value, buffer, length) > 0;
 }
 template<typename T = bool>
 static bool to_string(const bool& value, char * buffer, size_t length, int) {
-    buffer[0] = value ? '1' : '0';
-    buffer[1] = 0;
-    return true;
+    return fibre::format_number(value, buffer, length) > 0;
 }
 template<typename T>
 static bool to_string(const T& value, char * buffer, size_t length, ...) {
     return false;
 }
 
-template<typename T, typename = typename format_traits_t<T>::type>
+// The buffer is parsed up to the first null character or up to `length`
+// characters, whichever comes first.
+template<typename T, typename = enable_if_number_t<T>>
 static bool from_string(const char * buffer, size_t length, T* property, int) {
-    // Note for T == uint8_t: Even though we supposedly use the correct format
-    // string sscanf treats our pointer as pointer-to-int instead of
-    // pointer-to-uint8_t. To avoid an unexpected memory access we first read
-    // into a union.
-    union { T t; int i; } val;
-    if (sscanf(buffer, format_traits_t<T>::fmt, &val.t) == 1) {
-        *property = val.t;
-        return true;
-    } else {
-        return false;
-    }
+    return fibre::parse_number(buffer, buffer + strnlen(buffer, length), property);
 }
-// Special case for float because printf promotes float to double, and we get warnings
 template<typename T = float>
 static bool from_string(const char * buffer, size_t length, float* property, int) {
-    return sscanf(buffer, "%f", property) == 1;
+    return fibre::parse_number(buffer, buffer + strnlen(buffer, length), property);
 }
 template<typename T = bool>
 static bool from_string(const char * buffer, size_t length, bool* property, int) {
-    int val;
-    if (sscanf(buffer, "%d", &val) != 1)
-        return false;
-    *property = val;
-    return true;
+    return fibre::parse_number(buffer, buffer + strnlen(buffer, length), property);
 }
 template<typename T>
 static bool from_string(const char * buffer, size_t length, T* property, ...) {
@@ -251,6 +220,27 @@ template<typename T>
 bool set_from_float(float value, T* property) {
     return set_from_float_ex<T>(value, property, 0);
 }
+
+template<typename T>
+bool get_as_float_ex(float value, float* result, int) {
+    return *result = value, true;
+}
+template<typename T>
+bool get_as_float_ex(bool value, float* result, int) {
+    return *result = value ? 1.0f : 0.0f, true;
+}
+template<typename T, typename = std::enable_if_t<std::is_integral<T>::value>>
+bool get_as_float_ex(T value, float* result, int) {
+    return *result = static_cast<float>(value), true;
+}
+template<typename T>
+bool get_as_float_ex(const T& value, float* result, ...) {
+    return false;
+}
+template<typename T>
+bool get_as_float(const T& value, float* result) {
+    return get_as_float_ex<T>(value, result, 0);
+}
 }
 
 
@@ -172,6 +172,7 @@ value_types = OrderedDict({
     'int32': {'builtin': True, 'fullname': 'int32', 'name': 'int32', 'c_name': 'int32_t', 'py_type': 'int'},
     'int64': {'builtin': True, 'fullname': 'int64', 'name': 'int64', 'c_name': 'int64_t', 'py_type': 'int'},
     'endpoint_ref': {'builtin': True, 'fullname': 'endpoint_ref', 'name': 'endpoint_ref', 'c_name': 'endpoint_ref_t', 'py_type': '[not implemented]'},
+    'float32x15': {'builtin': True, 'fullname': 'float32x15', 'name': 'float32x15', 'c_name': 'float32x15_t', 'py_type': 'list'},
 })
 
 enums = OrderedDict()
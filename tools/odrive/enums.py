@@ -27,9 +27,39 @@ STREAM_PROTOCOL_TYPE_ASCII               = 1
 STREAM_PROTOCOL_TYPE_STDOUT              = 2
 STREAM_PROTOCOL_TYPE_ASCII_AND_STDOUT    = 3
 
+# ODrive.Oscilloscope.CaptureState
+CAPTURE_STATE_IDLE                       = 0
+CAPTURE_STATE_PRE_TRIGGER                = 1
+CAPTURE_STATE_WAIT_FOR_TRIGGER           = 2
+CAPTURE_STATE_POST_TRIGGER               = 3
+CAPTURE_STATE_DONE                       = 4
+
+# ODrive.Oscilloscope.TriggerMode
+TRIGGER_MODE_IMMEDIATE                   = 0
+TRIGGER_MODE_MANUAL                      = 1
+TRIGGER_MODE_RISING_EDGE                 = 2
+TRIGGER_MODE_FALLING_EDGE                = 3
+TRIGGER_MODE_ABOVE_LEVEL                 = 4
+TRIGGER_MODE_BELOW_LEVEL                 = 5
+TRIGGER_MODE_ERROR                       = 6
+
 # ODrive.Can.Protocol
 PROTOCOL_SIMPLE                          = 0x00000001
 
+# ODrive.Can.CyclicTrigger
+CYCLIC_TRIGGER_NONE                      = 0
+CYCLIC_TRIGGER_CONTROL_LOOP              = 1
+CYCLIC_TRIGGER_SYNC                      = 2
+
+# ODrive.Can.CyclicSignalType
+CYCLIC_SIGNAL_TYPE_FLOAT32               = 0
+CYCLIC_SIGNAL_TYPE_INT32                 = 1
+CYCLIC_SIGNAL_TYPE_UINT32                = 2
+CYCLIC_SIGNAL_TYPE_INT16                 = 3
+CYCLIC_SIGNAL_TYPE_UINT16                = 4
+CYCLIC_SIGNAL_TYPE_INT8                  = 5
+CYCLIC_SIGNAL_TYPE_UINT8                 = 6
+
 # ODrive.Axis.AxisState
 AXIS_STATE_UNDEFINED                     = 0
 AXIS_STATE_IDLE                          = 1
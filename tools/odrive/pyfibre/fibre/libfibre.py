@@ -100,6 +100,8 @@ OnFunctionRemovedSignature = CFUNCTYPE(None, c_void_p, c_void_p)
 OnCallCompletedSignature = CFUNCTYPE(c_int, c_void_p, c_int, c_void_p, c_void_p, POINTER(c_void_p), POINTER(c_size_t), POINTER(c_void_p), POINTER(c_size_t))
 OnTxCompletedSignature = CFUNCTYPE(None, c_void_p, c_void_p, c_int, c_void_p)
 OnRxCompletedSignature = CFUNCTYPE(None, c_void_p, c_void_p, c_int, c_void_p)
+OnBulkCompletedSignature = CFUNCTYPE(None, c_void_p, c_int, c_size_t)
+OnTelemetrySignature = CFUNCTYPE(None, c_void_p, c_void_p, c_size_t)
 
 kFibreOk = 0
 kFibreBusy = 1
@@ -189,6 +191,22 @@ libfibre_cancel_rx = lib.libfibre_cancel_rx
 libfibre_cancel_rx.argtypes = [c_void_p]
 libfibre_cancel_rx.restype = None
 
+# Bulk property access is not available in older libfibre binaries
+libfibre_read_properties = getattr(lib, 'libfibre_read_properties', None)
+if not libfibre_read_properties is None:
+    libfibre_read_properties.argtypes = [POINTER(c_void_p), c_size_t, c_void_p, c_size_t, OnBulkCompletedSignature, c_void_p]
+    libfibre_read_properties.restype = c_int
+
+libfibre_write_properties = getattr(lib, 'libfibre_write_properties', None)
+if not libfibre_write_properties is None:
+    libfibre_write_properties.argtypes = [POINTER(c_void_p), c_size_t, c_void_p, c_size_t, OnBulkCompletedSignature, c_void_p]
+    libfibre_write_properties.restype = c_int
+
+libfibre_set_telemetry_callback = getattr(lib, 'libfibre_set_telemetry_callback', None)
+if not libfibre_set_telemetry_callback is None:
+    libfibre_set_telemetry_callback.argtypes = [c_void_p, OnTelemetrySignature, c_void_p]
+    libfibre_set_telemetry_callback.restype = c_int
+
 
 # libfibre wrapper ------------------------------------------------------------#
 
@@ -264,6 +282,7 @@ codecs = {
     'uint64': StructCodec("<Q", int),
     'bool': StructCodec("<?", bool),
     'float': StructCodec("<f", float),
+    'float32x15': StructCodec("<15f", list),
     'object_ref': ObjectPtrCodec()
 }
 
@@ -736,6 +755,120 @@ class RemoteObject(object):
         on_lost.set_result(True)
 
 
+async def _bulk_access(properties, values):
+    libfibre = properties[0]._libfibre
+    write = not values is None
+    funcs = [(type(prop).exchange if write else type(prop).read) for prop in properties]
+    codecs = [(func._inputs[-1][2] if write else func._outputs[0][2]) for func in funcs]
+    results = []
+
+    c_func = libfibre_write_properties if write else libfibre_read_properties
+    if not c_func is None and all(isinstance(codec, StructCodec) for codec in codecs):
+        if any(prop._obj_handle is None for prop in properties):
+            raise ObjectLostError()
+        handles = (c_void_p * len(properties))(*(prop._obj_handle for prop in properties))
+        if write:
+            buf = create_string_buffer(b''.join(codec.serialize(libfibre, val) for codec, val in zip(codecs, values)))
+            buf_len = len(buf) - 1 # without the trailing null byte
+        else:
+            buf_len = sum(codec.get_length() for codec in codecs)
+            buf = create_string_buffer(buf_len)
+
+        future = libfibre.loop.create_future()
+        op_id = insert_with_new_id(libfibre._bulk_ops, future)
+        status = c_func(handles, len(properties), buf, buf_len, libfibre.c_on_bulk_completed, op_id)
+        if status == kFibreBusy:
+            status, n_completed = await future
+        else:
+            libfibre._bulk_ops.pop(op_id)
+            n_completed = 0
+
+        # kFibreInvalidArgument means that the remote device rejected the
+        # request (e.g. because its firmware is too old). The remaining
+        # properties are then accessed one by one below.
+        if status != kFibreOk and status != kFibreInvalidArgument:
+            raise _get_exception(status)
+
+        if not write:
+            pos = 0
+            for codec in codecs[:n_completed]:
+                results.append(codec.deserialize(libfibre, buf.raw[pos:pos + codec.get_length()]))
+                pos += codec.get_length()
+    else:
+        n_completed = 0
+
+    for i in range(n_completed, len(properties)):
+        if write:
+            await funcs[i](properties[i], values[i])
+        else:
+            results.append(await funcs[i](properties[i]))
+
+    return None if write else results
+
+def read_properties(properties):
+    """
+    Reads several properties of the same remote device in as few round-trips
+    as possible. Returns a list with the values of the properties.
+
+    The properties are property objects such as
+    `odrv0.axis0.encoder._pos_estimate_property`.
+
+    If this function is called from the Fibre thread then it is nonblocking and
+    returns an asyncio.Future. If it is called from another thread then it
+    blocks until all properties are read.
+    """
+    properties = list(properties)
+    if len(properties) == 0:
+        return []
+    if threading.current_thread() != libfibre_thread:
+        return run_coroutine_threadsafe(properties[0]._libfibre.loop, lambda: read_properties(properties))
+    return asyncio.ensure_future(_bulk_access(properties, None), loop=properties[0]._libfibre.loop)
+
+def write_properties(properties, values):
+    """
+    Writes several properties of the same remote device in as few round-trips
+    as possible. The properties are written in the order in which they are
+    listed.
+
+    See also read_properties().
+    """
+    properties = list(properties)
+    values = list(values)
+    if len(properties) != len(values):
+        raise TypeError("expected {} values but have {}".format(len(properties), len(values)))
+    if len(properties) == 0:
+        return
+    if threading.current_thread() != libfibre_thread:
+        return run_coroutine_threadsafe(properties[0]._libfibre.loop, lambda: write_properties(properties, values))
+    return asyncio.ensure_future(_bulk_access(properties, values), loop=properties[0]._libfibre.loop)
+
+def set_telemetry_callback(obj, callback):
+    """
+    Sets a function that is called with the payload (bytes) of every telemetry
+    packet that the device of `obj` pushes to the host. The callback runs on
+    the Fibre thread. Pass None to remove the callback.
+
+    Returns False if the libfibre binary doesn't support telemetry.
+    """
+    if libfibre_set_telemetry_callback is None:
+        return False
+    if threading.current_thread() != libfibre_thread:
+        return run_coroutine_threadsafe(obj._libfibre.loop, lambda: set_telemetry_callback(obj, callback))
+
+    libfibre = obj._libfibre
+    if callback is None:
+        c_callback = None
+        libfibre._telemetry_callbacks.pop(obj._obj_handle, None)
+    else:
+        c_callback = OnTelemetrySignature(lambda ctx, buf, length: callback(string_at(buf, length)))
+        libfibre._telemetry_callbacks[obj._obj_handle] = c_callback # keep the function object alive
+
+    status = libfibre_set_telemetry_callback(obj._obj_handle, c_callback, None)
+    if status != kFibreOk:
+        raise _get_exception(status)
+    return True
+
+
 class LibFibre():
     def __init__(self):
         self.loop = asyncio.get_event_loop()
@@ -755,6 +888,7 @@ class LibFibre():
         self.c_on_function_added = OnFunctionAddedSignature(self._on_function_added)
         self.c_on_function_removed = OnFunctionRemovedSignature(self._on_function_removed)
         self.c_on_call_completed = OnCallCompletedSignature(self._on_call_completed)
+        self.c_on_bulk_completed = OnBulkCompletedSignature(self._on_bulk_completed)
         
         self.timer_map = {}
         self.eventfd_map = {}
@@ -762,6 +896,8 @@ class LibFibre():
         self.discovery_processes = {} # key: ID, value: python dict
         self._objects = {} # key: libfibre handle, value: python class
         self._calls = {} # key: libfibre handle, value: Call object
+        self._bulk_ops = {} # key: ID, value: asyncio.Future
+        self._telemetry_callbacks = {} # key: libfibre handle, value: ctypes function object
 
         event_loop = LibFibreEventLoop()
         event_loop.post = self.c_post
@@ -890,6 +1026,9 @@ class LibFibre():
 
         return kFibreBusy
 
+    def _on_bulk_completed(self, ctx, status, n_completed):
+        self._bulk_ops.pop(ctx).set_result((status, n_completed))
+
 class Discovery():
     """
     All public members of this class are thread-safe.
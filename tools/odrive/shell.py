@@ -66,6 +66,7 @@ def launch_shell(args, logger):
         'dump_errors': dump_errors,
         'benchmark': benchmark,
         'oscilloscope_dump': oscilloscope_dump,
+        'start_telemetry': start_telemetry,
         'dump_interrupts': dump_interrupts,
         'dump_threads': dump_threads,
         'dump_dma': dump_dma,
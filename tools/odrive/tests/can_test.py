@@ -38,6 +38,8 @@ command_set = {
     'reboot': (0x016, []), # tested
     'get_vbus_voltage': (0x017, [('vbus_voltage', 'f', 1)]), # tested
     'clear_errors': (0x018, []), # partially tested
+    'set_linear_count': (0x019, [('position', 'i', 1)]), # untested
+    'set_multi_axis_input': (0x01a, [('axis0_input', 'f', 1), ('axis1_input', 'f', 1)]), # tested
 }
 
 def command(bus, node_id_, extended_id, cmd_name, **kwargs):
@@ -205,6 +207,12 @@ class TestSimpleCAN():
         fence()
         test_assert_eq(axis.controller.input_torque, 0.1, range=0.01)
 
+        odrive.handle.axis1.controller.config.control_mode = CONTROL_MODE_VELOCITY_CONTROL
+        my_cmd('set_multi_axis_input', axis0_input=0.2, axis1_input=-3.5)
+        fence()
+        test_assert_eq(axis.controller.input_torque, 0.2, range=0.01)
+        test_assert_eq(odrive.handle.axis1.controller.input_vel, -3.5, range=0.01)
+
         my_cmd('set_velocity_limit', velocity_limit=2.345678)
         fence()
         test_assert_eq(axis.controller.config.vel_limit, 2.345678, range=0.001)
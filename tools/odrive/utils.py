@@ -126,12 +126,85 @@ def dump_errors(odrv, clear=False, printfunc = print):
     if clear:
         odrv.clear_errors()
 
-def oscilloscope_dump(odrv, num_vals, filename='oscilloscope.csv'):
+def oscilloscope_read(odrv, num_vals=None):
+    """
+    Reads the current recording of the oscilloscope and returns it as a list
+    of rows with one value per channel.
+    """
+    osc = odrv.oscilloscope
+    n_channels = max(osc.n_channels, 1)
+    if num_vals is None:
+        num_vals = osc.length
+    vals = []
+    while len(vals) < num_vals:
+        vals += osc.get_block(len(vals))
+    vals = vals[:num_vals]
+    return [vals[i:i+n_channels] for i in range(0, len(vals), n_channels)]
+
+def oscilloscope_dump(odrv, num_vals=None, filename='oscilloscope.csv'):
     with open(filename, 'w') as f:
-        for x in range(num_vals):
-            f.write(str(odrv.oscilloscope.get_val(x)))
+        for row in oscilloscope_read(odrv, num_vals):
+            f.write(','.join(str(val) for val in row))
             f.write('\n')
 
+def start_telemetry(odrv, properties, callback, period=8):
+    """
+    Samples the specified properties in the control loop of the ODrive and
+    streams them to the host.
+
+    properties: Up to 8 property objects, for instance
+                [odrv0.axis0.encoder._pos_estimate_property, odrv0._vbus_voltage_property]
+    callback: Called as callback(timestamp, values) for every sample from a
+              background thread. The timestamp is the value of
+              n_evt_control_loop at which the sample was taken.
+    period: Take one sample every N-th control loop iteration (8 means 1kHz
+            on ODrive v3).
+
+    Returns a cancellation token. Set it to stop the telemetry.
+
+    If the firmware or libfibre doesn't support push telemetry the properties
+    are polled instead, which is much slower.
+    """
+    import fibre
+    import struct
+
+    cancellation_token = Event()
+    telemetry = odrv.telemetry if hasattr(odrv, 'telemetry') else None
+
+    def on_packet(payload):
+        n_channels = payload[0]
+        sample_format = '<I{}f'.format(n_channels)
+        sample_size = struct.calcsize(sample_format)
+        for pos in range(1, len(payload) - sample_size + 1, sample_size):
+            timestamp, *values = struct.unpack_from(sample_format, payload, pos)
+            callback(timestamp, values)
+
+    if not telemetry is None:
+        for i in range(8):
+            setattr(telemetry.config, 'channel' + str(i), properties[i] if i < len(properties) else None)
+        telemetry.config.period = period
+
+        if fibre.libfibre.set_telemetry_callback(odrv, on_packet):
+            if not telemetry.start():
+                fibre.libfibre.set_telemetry_callback(odrv, None)
+                raise Exception("the ODrive can't sample these properties")
+            def stop():
+                telemetry.stop()
+                fibre.libfibre.set_telemetry_callback(odrv, None)
+            cancellation_token.subscribe(stop)
+            return cancellation_token
+
+    # Fallback: poll the properties together with the timestamp
+    def poll():
+        control_loop_hz = 8000
+        while not cancellation_token.is_set():
+            timestamp, *values = fibre.read_properties([odrv._n_evt_control_loop_property] + list(properties))
+            callback(timestamp, values)
+            time.sleep(period / control_loop_hz)
+
+    threading.Thread(target=poll, daemon=True).start()
+    return cancellation_token
+
 data_rate = 200
 plot_rate = 10
 num_samples = 500
@@ -316,13 +389,10 @@ def print_drv_regs(name, motor):
     print("Control Reg 2: " + str(ctrl_reg_2) + " (" + format(ctrl_reg_2, '#09b') + ")")
 
 def show_oscilloscope(odrv):
-    size = 18000
-    values = []
-    for i in range(size):
-        values.append(odrv.oscilloscope.get_val(i))
+    rows = oscilloscope_read(odrv)
 
     import matplotlib.pyplot as plt
-    plt.plot(values)
+    plt.plot(rows)
     plt.show()
 
 def rate_test(device):
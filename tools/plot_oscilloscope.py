@@ -3,7 +3,7 @@ from matplotlib import pyplot as plt
 import sys
 
 with open(sys.argv[1]) as f:
-    data = list(map(float, f))
+    data = [list(map(float, line.split(','))) for line in f]
 
 plt.plot(data)
 plt.show()
\ No newline at end of file